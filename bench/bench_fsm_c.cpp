@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "fsm.h"
+#include "fsm_table.h"
+}
+
+// C状态机分发：三个状态循环转换，每个状态有n个转换，事件总是命中最后一个
+// （FSM_handleEvent线性查找转换数组，表驱动版本按[状态][事件]直接索引）
+
+static unsigned long g_sink;
+
+static void countAction(struct event* event)
+{
+    g_sink += (unsigned long)event->type + 1;
+}
+
+static void BM_FSM_HandleEvent(benchmark::State& st)
+{
+    int n = (int)st.range(0);
+    struct state states[3] = {};
+    std::vector<struct transition> transitions(3 * n);
+
+    for (int s = 0; s < 3; ++s) {
+        for (int e = 0; e < n; ++e) {
+            struct transition& t = transitions[s * n + e];
+            t.eventType = e;
+            t.nextState = &states[(s + 1) % 3];
+            t.action = countAction;
+        }
+        states[s].name = "S";
+        states[s].transitions = &transitions[s * n];
+        states[s].numTransitions = n;
+    }
+
+    struct StateMachine m;
+    struct event event = { n - 1, NULL };
+    FSM_init(&m, &states[0]);
+
+    for (auto _ : st) {
+        benchmark::DoNotOptimize(FSM_handleEvent(&m, &event));
+    }
+    benchmark::DoNotOptimize(g_sink);
+    st.SetItemsProcessed(st.iterations());
+}
+BENCHMARK(BM_FSM_HandleEvent)->Arg(1)->Arg(8)->Arg(32);
+
+static void BM_FSM_TableHandleEvent(benchmark::State& st)
+{
+    int n = (int)st.range(0);
+    std::string text = "state S0\nstate S1\nstate S2\n";
+    char line[128];
+
+    for (int e = 0; e < n; ++e) {
+        snprintf(line, sizeof(line), "event E%d\n", e);
+        text += line;
+    }
+    for (int s = 0; s < 3; ++s) {
+        for (int e = 0; e < n; ++e) {
+            snprintf(line, sizeof(line), "trans S%d E%d S%d count\n", s, e, (s + 1) % 3);
+            text += line;
+        }
+    }
+
+    struct fsm_action_entry registry[] = { { "count", countAction }, { NULL, NULL } };
+    void* blob = NULL;
+    size_t size = 0;
+    char err[256];
+    struct fsm_table table;
+
+    if (fsm_table_compile(text.c_str(), text.size(), registry, 0, &blob, &size, err, sizeof(err)) != 0 ||
+        fsm_table_open(&table, blob, size, registry, err, sizeof(err)) != 0) {
+        st.SkipWithError(err);
+        free(blob);
+        return;
+    }
+
+    struct fsm_table_machine m;
+    struct event event = { n - 1, NULL };
+    fsm_table_machine_init(&m, &table);
+
+    for (auto _ : st) {
+        benchmark::DoNotOptimize(fsm_table_handle_event(&m, &event));
+    }
+    benchmark::DoNotOptimize(g_sink);
+    st.SetItemsProcessed(st.iterations());
+
+    fsm_table_close(&table);
+    free(blob);
+}
+BENCHMARK(BM_FSM_TableHandleEvent)->Arg(1)->Arg(8)->Arg(32);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,107 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <vector>
+
+#include "fsm.h"
+
+// C++状态机分发：三个状态循环转换，每个状态有n个转换，事件总是命中最后一个
+
+static unsigned long g_sink;
+
+static void countAction(const Event& event)
+{
+    g_sink += (unsigned long)event.getType() + 1;
+}
+
+static void payloadAction(const Event& event)
+{
+    g_sink += event.get<unsigned long>();
+}
+
+// 模拟日志类动作，用于对比同步执行与延迟批量执行
+static void logAction(const Event& event)
+{
+    char line[128];
+    int len = snprintf(line, sizeof(line), "event=%d payload=%lu", event.getType(), event.get<unsigned long>());
+    g_sink += (unsigned long)len + (unsigned char)line[len / 2];
+}
+
+static bool alwaysGuard(const Event& event)
+{
+    return event.getType() >= 0;
+}
+
+struct Ring {
+    explicit Ring(int n) : a("A"), b("B"), c("C") {
+        State* s[3] = { &a, &b, &c };
+        for (int i = 0; i < 3; ++i) {
+            for (int e = 0; e < n; ++e) {
+                s[i]->addTransition(e, s[(i + 1) % 3], countAction);
+            }
+        }
+    }
+
+    State a, b, c;
+};
+
+static void BM_FSM_HandleEvent(benchmark::State& st)
+{
+    int n = (int)st.range(0);
+    Ring ring(n);
+    StateMachine machine(&ring.a);
+    Event event(n - 1);
+
+    for (auto _ : st) {
+        benchmark::DoNotOptimize(machine.handleEvent(event));
+    }
+    benchmark::DoNotOptimize(g_sink);
+    st.SetItemsProcessed(st.iterations());
+}
+BENCHMARK(BM_FSM_HandleEvent)->Arg(1)->Arg(8)->Arg(32);
+
+// 带类型负载和guard的转换
+static void BM_FSM_HandleEventPayload(benchmark::State& st)
+{
+    State a("A"), b("B"), c("C");
+    a.addTransition<unsigned long>(0, &b, payloadAction, alwaysGuard);
+    b.addTransition<unsigned long>(0, &c, payloadAction, alwaysGuard);
+    c.addTransition<unsigned long>(0, &a, payloadAction, alwaysGuard);
+    StateMachine machine(&a);
+    unsigned long i = 0;
+
+    for (auto _ : st) {
+        Event event(0, i++);
+        benchmark::DoNotOptimize(machine.handleEvent(event));
+    }
+    benchmark::DoNotOptimize(g_sink);
+    st.SetItemsProcessed(st.iterations());
+}
+BENCHMARK(BM_FSM_HandleEventPayload);
+
+// 动作同步执行（batch=0）或写入ActionBuffer批量执行
+static void BM_FSM_ActionBuffer(benchmark::State& st)
+{
+    size_t batch = (size_t)st.range(0);
+    State a("A"), b("B"), c("C");
+    a.addTransition<unsigned long>(0, &b, logAction);
+    b.addTransition<unsigned long>(0, &c, logAction);
+    c.addTransition<unsigned long>(0, &a, logAction);
+    StateMachine machine(&a);
+    ActionBuffer buffer(batch ? batch : 1);
+    if (batch) {
+        machine.setActionBuffer(&buffer);
+    }
+    unsigned long i = 0;
+
+    for (auto _ : st) {
+        Event event(0, i++);
+        benchmark::DoNotOptimize(machine.handleEvent(event));
+    }
+    buffer.drain();
+    benchmark::DoNotOptimize(g_sink);
+    st.SetItemsProcessed(st.iterations());
+}
+BENCHMARK(BM_FSM_ActionBuffer)->Arg(0)->Arg(64)->Arg(1024);
+
+BENCHMARK_MAIN();
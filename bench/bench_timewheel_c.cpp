@@ -0,0 +1,583 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+extern "C" {
+#include "timer_wheel.h"
+#include "chunk_wheel.h"
+}
+
+// C时间轮：insert/refresh/remove/roll，定时器数量1K~10M
+// 定时器的超时时间分布在[1, MAX_TIMER_SLOTS - 1)之间
+
+static std::vector<timer_entry_t> g_entries;
+static uint32_t g_now;
+
+static void noop(timer_entry_t*)
+{
+}
+
+static void initEntries(size_t n)
+{
+    unsigned seed = 1;
+
+    g_entries.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        timer_wheel_entry_init(&g_entries[i]);
+        // 回调中以新的now重新加入时，超时为MAX_TIMER_SLOTS - 1的定时器会落回正在处理的slot，
+        // roll会一直处理同一个slot，因此超时最大取MAX_TIMER_SLOTS - 2
+        g_entries[i].timeout = 1 + rand_r(&seed) % (MAX_TIMER_SLOTS - 2);
+    }
+}
+
+static timer_wheel_t* newWheel(size_t n, timer_wheel_expire_fct cb)
+{
+    timer_wheel_t* w = new timer_wheel_t;
+    timer_wheel_init(w);
+    timer_wheel_start(w, 1);
+    g_now = 1;
+    initEntries(n);
+    for (size_t i = 0; i < n; ++i) {
+        timer_wheel_entry_start(w, &g_entries[i], cb, g_entries[i].timeout, g_now);
+    }
+    return w;
+}
+
+#define WHEEL_SIZES ->Arg(1000)->Arg(10000)->Arg(100000)->Arg(1000000)->Arg(10000000)
+
+// 每次迭代把n个定时器全部加入空时间轮
+static void BM_CWheel_Insert(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    timer_wheel_t* w = new timer_wheel_t;
+    timer_wheel_init(w);
+    initEntries(n);
+
+    for (auto _ : st) {
+        st.PauseTiming();
+        timer_wheel_destroy(w);
+        timer_wheel_init(w);
+        st.ResumeTiming();
+        for (size_t i = 0; i < n; ++i) {
+            timer_wheel_entry_start(w, &g_entries[i], noop, g_entries[i].timeout, 1);
+        }
+    }
+    st.SetItemsProcessed(st.iterations() * n);
+    timer_wheel_destroy(w);
+    delete w;
+}
+BENCHMARK(BM_CWheel_Insert) WHEEL_SIZES ->Unit(benchmark::kMillisecond);
+
+// 在n个定时器中随机刷新一个
+static void BM_CWheel_Refresh(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    timer_wheel_t* w = newWheel(n, noop);
+    size_t i = 0;
+
+    for (auto _ : st) {
+        timer_wheel_entry_refresh(w, &g_entries[i % n], 2);
+        i += 1000003;
+    }
+    st.SetItemsProcessed(st.iterations());
+    timer_wheel_destroy(w);
+    delete w;
+}
+BENCHMARK(BM_CWheel_Refresh) WHEEL_SIZES;
+
+// 在n个定时器中随机删除一个再重新加入，保持定时器数量不变
+static void BM_CWheel_RemoveInsert(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    timer_wheel_t* w = newWheel(n, noop);
+    size_t i = 0;
+
+    for (auto _ : st) {
+        timer_entry_t* e = &g_entries[i % n];
+        timer_wheel_entry_remove(w, e);
+        timer_wheel_entry_start(w, e, noop, e->timeout, 1);
+        i += 1000003;
+    }
+    st.SetItemsProcessed(st.iterations());
+    timer_wheel_destroy(w);
+    delete w;
+}
+BENCHMARK(BM_CWheel_RemoveInsert) WHEEL_SIZES;
+
+// 稳态下每次roll推进一个slot，到期的定时器以相同超时重新加入
+static void BM_CWheel_Roll(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    timer_wheel_t* w = newWheel(n, noop);
+    uint64_t expired = 0;
+
+    // 回调中重新加入需要时间轮指针
+    static timer_wheel_t* current;
+    current = w;
+    struct Rearm {
+        static void fn(timer_entry_t* e) {
+            timer_wheel_entry_start(current, e, fn, e->timeout, g_now);
+        }
+    };
+    for (size_t i = 0; i < n; ++i) {
+        timer_wheel_entry_set_callback(&g_entries[i], Rearm::fn);
+    }
+
+    for (auto _ : st) {
+        g_now++;
+        expired += timer_wheel_roll(w, g_now);
+    }
+    st.counters["expired/roll"] = benchmark::Counter((double)expired / st.iterations());
+    st.counters["timers/s"] = benchmark::Counter((double)expired, benchmark::Counter::kIsRate);
+    st.SetItemsProcessed(st.iterations());
+    timer_wheel_destroy(w);
+    delete w;
+}
+BENCHMARK(BM_CWheel_Roll) WHEEL_SIZES;
+
+// 与BM_CWheel_Roll相同的负载（超时分布、回调中重新加入），slot换成chunk_wheel_t的定长数组块。
+// 对比两者的timers/s：链表要逐个追next指针，数组块顺序扫描并提前预取后面的定时器
+static std::vector<chunk_entry_t> g_chunkEntries;
+static chunk_wheel_t* g_chunkWheel;
+
+static void chunkRearm(chunk_entry_t* e)
+{
+    chunk_wheel_entry_start(g_chunkWheel, e, chunkRearm, e->timeout, g_now);
+}
+
+static void BM_CChunk_Roll(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    chunk_wheel_t* w = new chunk_wheel_t;
+    uint64_t expired = 0;
+    unsigned seed = 1;
+
+    chunk_wheel_init(w);
+    if (chunk_wheel_reserve(w, (uint32_t)n) != 0) {
+        st.SkipWithError("out of memory");
+        delete w;
+        return;
+    }
+    chunk_wheel_start(w, 1);
+    g_chunkWheel = w;
+    g_now = 1;
+    g_chunkEntries.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        chunk_wheel_entry_init(&g_chunkEntries[i]);
+        // 与initEntries相同的种子和分布
+        uint32_t timeout = 1 + rand_r(&seed) % (MAX_TIMER_SLOTS - 2);
+        chunk_wheel_entry_start(w, &g_chunkEntries[i], chunkRearm, timeout, g_now);
+    }
+
+    for (auto _ : st) {
+        g_now++;
+        expired += chunk_wheel_roll(w, g_now);
+    }
+    if (chunk_wheel_count(w) != n) {
+        st.SkipWithError("timer lost");
+    }
+    st.counters["expired/roll"] = benchmark::Counter((double)expired / st.iterations());
+    st.counters["timers/s"] = benchmark::Counter((double)expired, benchmark::Counter::kIsRate);
+    st.SetItemsProcessed(st.iterations());
+    chunk_wheel_destroy(w);
+    delete w;
+    std::vector<chunk_entry_t>().swap(g_chunkEntries);
+}
+BENCHMARK(BM_CChunk_Roll) WHEEL_SIZES;
+
+// 周期定时器：n个定时器周期为100个tick（1ms一个tick即100ms），相位均匀分布。
+// 每次迭代推进step个tick（step > 1模拟tick线程醒得晚）。
+// Periodic由时间轮按计划到期时间移到下一个slot；Restart是旧做法，在回调中以当前now重新start，
+// 晚到的时间会累积成漂移，fires/expected反映按计划应触发的次数中实际触发了多少。
+static const uint16_t PERIOD = 100;
+static timer_wheel_t* g_periodicWheel;
+
+static int periodicTick(timer_entry_t*)
+{
+    return DTIMER_OK;
+}
+
+static void restartTick(timer_entry_t* e)
+{
+    timer_wheel_entry_start(g_periodicWheel, e, restartTick, PERIOD, g_now);
+}
+
+template <bool periodic>
+static void BM_CWheel_Periodic(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    uint32_t step = (uint32_t)st.range(1);
+    timer_wheel_t* w = new timer_wheel_t;
+    uint64_t fired = 0, ticks = 0;
+
+    timer_wheel_init(w);
+    timer_wheel_start(w, PERIOD);
+    g_periodicWheel = w;
+    g_now = PERIOD;
+    g_entries.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        timer_entry_t* e = &g_entries[i];
+        timer_wheel_entry_init(e);
+        // 以不同的起始时间加入，使每个tick到期的定时器数相同
+        uint32_t phase = (uint32_t)(i % PERIOD);
+        if (periodic) {
+            timer_wheel_entry_start_periodic(w, e, periodicTick, PERIOD, phase);
+        } else {
+            timer_wheel_entry_start(w, e, restartTick, PERIOD, phase);
+        }
+    }
+
+    for (auto _ : st) {
+        g_now += step;
+        fired += timer_wheel_roll(w, g_now);
+        ticks += step;
+    }
+
+    st.counters["fires/roll"] = benchmark::Counter((double)fired / st.iterations());
+    st.counters["fires/expected"] = benchmark::Counter((double)fired / ((double)n * ticks / PERIOD));
+    st.SetItemsProcessed(fired);
+    timer_wheel_destroy(w);
+    delete w;
+}
+BENCHMARK_TEMPLATE(BM_CWheel_Periodic, true)->ArgNames({"timers", "step"})
+    ->Args({1000000, 1})->Args({1000000, 3});
+BENCHMARK_TEMPLATE(BM_CWheel_Periodic, false)->ArgNames({"timers", "step"})
+    ->Args({1000000, 1})->Args({1000000, 3});
+
+// 会话超时：100K个流，1M包/秒，1ms一个tick即每个tick 1000个数据包，随机落在各个流上，
+// 超时1000个tick（1s），平均每个流在超时时间内收到10个包。
+// Eager每个包调用refresh，立即移到新的slot；Lazy每个包只调用touch记录时间，
+// 原来的slot到期时才按最后一次活动时间移动，每个活跃流每个超时周期只移动一次。
+// 超时的流以新流的身份重新加入，两种方式的超时判定相同，expired/s应当接近。
+static const size_t FLOWS = 100000;
+static const uint32_t PKTS_PER_TICK = 1000;
+static const uint16_t FLOW_TIMEOUT = 1000;
+static timer_wheel_t* g_flowWheel;
+
+static void flowExpired(timer_entry_t* e)
+{
+    timer_wheel_entry_start(g_flowWheel, e, flowExpired, FLOW_TIMEOUT, g_now);
+}
+
+template <bool lazy>
+static void BM_CWheel_Flows(benchmark::State& st)
+{
+    timer_wheel_t* w = new timer_wheel_t;
+    uint64_t expired = 0, ticks = 0;
+    uint32_t x = 2463534242u;
+
+    timer_wheel_init(w);
+    timer_wheel_start(w, 1);
+    g_flowWheel = w;
+    g_now = 1;
+    g_entries.resize(FLOWS);
+    for (size_t i = 0; i < FLOWS; ++i) {
+        timer_wheel_entry_init(&g_entries[i]);
+        timer_wheel_entry_start(w, &g_entries[i], flowExpired, FLOW_TIMEOUT, g_now);
+    }
+
+    for (auto _ : st) {
+        g_now++;
+        expired += timer_wheel_roll(w, g_now);
+        for (uint32_t p = 0; p < PKTS_PER_TICK; ++p) {
+            // xorshift32，比rand_r快，不干扰测量
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            timer_entry_t* e = &g_entries[x % FLOWS];
+            if (lazy) {
+                timer_wheel_entry_touch(e, g_now);
+            } else {
+                timer_wheel_entry_refresh(w, e, g_now);
+            }
+        }
+        ticks++;
+    }
+
+    if (timer_wheel_count(w) != FLOWS) {
+        st.SkipWithError("flows lost");
+    }
+    st.counters["expired/s"] = benchmark::Counter((double)expired * 1000 / ticks);
+    st.SetItemsProcessed(st.iterations() * PKTS_PER_TICK);
+    timer_wheel_destroy(w);
+    delete w;
+}
+BENCHMARK_TEMPLATE(BM_CWheel_Flows, false);
+BENCHMARK_TEMPLATE(BM_CWheel_Flows, true);
+
+// 同时到期：1M个定时器落在同一个slot（例如扫描之后的大批会话超时），回调模拟释放会话约100ns的工作。
+// workers为0时回调在roll中串行执行；否则交给线程池，wait为1时roll等所有回调执行完才返回。
+// tick_ms为roll本身的耗时，late_*为回调开始执行时相对slot到期时间的延迟（按批记录）。
+static std::vector<uint64_t> g_sessions;
+static uint64_t g_fired;
+
+static void releaseSession(timer_entry_t* e)
+{
+    uint64_t& v = g_sessions[e - &g_entries[0]];
+    for (int i = 0; i < 32; ++i) {
+        v = v * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    __atomic_add_fetch(&g_fired, 1, __ATOMIC_RELAXED);
+}
+
+static void BM_CWheel_ParallelExpiry(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    unsigned workers = (unsigned)st.range(1);
+    bool wait = st.range(2) != 0;
+    timer_wheel_t* w = new timer_wheel_t;
+    wheel_metrics_t* metrics = wheel_metrics_create("bench");
+    wheel_pool_t* pool = workers ? wheel_pool_create(workers) : NULL;
+
+    timer_wheel_init(w);
+    // tick_ns为1：slot本身的延迟（1个tick）忽略不计，只统计回调排队和执行造成的延迟
+    timer_wheel_set_metrics(w, metrics, 1);
+    timer_wheel_set_pool(w, pool, wait);
+    timer_wheel_start(w, 1);
+    g_now = 1;
+    g_entries.resize(n);
+    g_sessions.assign(n, 0);
+
+    for (auto _ : st) {
+        st.PauseTiming();
+        g_fired = 0;
+        for (size_t i = 0; i < n; ++i) {
+            timer_wheel_entry_init(&g_entries[i]);
+            timer_wheel_entry_start(w, &g_entries[i], releaseSession, 1, g_now);
+        }
+        // 在now + 1到期，roll处理now之前的slot
+        g_now += 2;
+        st.ResumeTiming();
+
+        timer_wheel_roll(w, g_now);
+
+        st.PauseTiming();
+        // 不等待时在这里等回调执行完，下一轮才能重新使用这些定时器
+        timer_wheel_set_pool(w, pool, wait);
+        if (g_fired != n || timer_wheel_count(w) != 0) {
+            st.SkipWithError("not all timers expired");
+            break;
+        }
+        st.ResumeTiming();
+    }
+
+    wheel_metrics_snapshot_t* snap = new wheel_metrics_snapshot_t;
+    wheel_metrics_snapshot(metrics, snap);
+    const wheel_hist_t* late = &snap->hists[WHEEL_HIST_LATENESS];
+    const wheel_hist_t* tick = &snap->hists[WHEEL_HIST_TICK];
+    st.counters["tick_ms"] = tick->count ? (double)tick->sum / tick->count / 1e6 : 0;
+    st.counters["late_p50_ms"] = wheel_hist_percentile(late, 50) / 1e6;
+    st.counters["late_p99_ms"] = wheel_hist_percentile(late, 99) / 1e6;
+    st.counters["late_max_ms"] = late->max / 1e6;
+    st.SetItemsProcessed(st.iterations() * n);
+    delete snap;
+
+    timer_wheel_set_pool(w, NULL, false);
+    wheel_pool_destroy(pool);
+    wheel_metrics_destroy(metrics);
+    timer_wheel_destroy(w);
+    delete w;
+}
+BENCHMARK(BM_CWheel_ParallelExpiry)->ArgNames({"timers", "workers", "wait"})
+    ->Args({1000000, 0, 1})
+    ->Args({1000000, 1, 1})->Args({1000000, 4, 1})->Args({1000000, 16, 1})
+    ->Args({1000000, 1, 0})->Args({1000000, 4, 0})->Args({1000000, 16, 0})
+    ->Iterations(5)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// 定时器slack：1M个空闲超时定时器，1ms一个tick，超时分布在[500, 2500)个tick之间，到期后以相同超时重新加入。
+// 调用方不再每个tick都roll，而是用timer_wheel_next_roll()睡到下一个有定时器的slot再roll，每次roll算一次唤醒。
+// slack取超时的0%、5%、20%；每次迭代模拟1秒，Time为处理这1秒的CPU时间，
+// wakeups/s为每秒唤醒次数，delay_ms为slack造成的平均推迟。
+static const size_t IDLE_TIMERS = 1000000;
+static timer_wheel_t* g_slackWheel;
+static uint64_t g_slackDelay;
+
+static void idleExpired(timer_entry_t* e)
+{
+    // 这次roll只处理了g_now - 1这一个slot，与应到期时间的差就是推迟的时间
+    g_slackDelay += (uint16_t)(0 - timer_wheel_entry_get_life(e, g_now - 1));
+    timer_wheel_entry_start(g_slackWheel, e, idleExpired, e->timeout, g_now);
+}
+
+static void BM_CWheel_Slack(benchmark::State& st)
+{
+    int pct = (int)st.range(0);
+    timer_wheel_t* w = new timer_wheel_t;
+    uint64_t expired = 0, wakeups = 0;
+    unsigned seed = 1;
+
+    timer_wheel_init(w);
+    timer_wheel_start(w, 1);
+    g_slackWheel = w;
+    g_slackDelay = 0;
+    g_now = 1;
+    g_entries.resize(IDLE_TIMERS);
+    for (size_t i = 0; i < IDLE_TIMERS; ++i) {
+        uint16_t timeout = 500 + rand_r(&seed) % 2000;
+        timer_wheel_entry_init(&g_entries[i]);
+        timer_wheel_entry_set_slack(&g_entries[i], timeout * pct / 100);
+        timer_wheel_entry_start(w, &g_entries[i], idleExpired, timeout, g_now);
+    }
+
+    for (auto _ : st) {
+        uint32_t end = g_now + 1000;
+        for (;;) {
+            uint32_t next = timer_wheel_next_roll(w);
+            if (next > end) {
+                break;
+            }
+            g_now = next;
+            expired += timer_wheel_roll(w, g_now);
+            wakeups++;
+        }
+        g_now = end;
+    }
+
+    if (timer_wheel_count(w) != IDLE_TIMERS) {
+        st.SkipWithError("timers lost");
+    }
+    st.counters["wakeups/s"] = benchmark::Counter((double)wakeups / st.iterations());
+    st.counters["expired/s"] = benchmark::Counter((double)expired / st.iterations());
+    st.counters["delay_ms"] = expired ? (double)g_slackDelay / expired : 0;
+    timer_wheel_destroy(w);
+    delete w;
+}
+BENCHMARK(BM_CWheel_Slack)->ArgName("slack_pct")->Arg(0)->Arg(5)->Arg(20)->Unit(benchmark::kMillisecond);
+
+// 大页：16384个slot的时间轮加4M个定时器（定时器池约160MB），超时在[1, 16383)之间随机。
+// hugepage=1时slot数组和定时器池都用wheel_mem_alloc(WHEEL_MEM_HUGEPAGE)分配，label为实际拿到的内存
+// （hugetlb/thp/4k），huge_mb为/proc/self/smaps_rollup中的AnonHugePages。
+// Insert每次迭代把4M个定时器加入空时间轮；Roll为回调中重新加入的稳态，每次迭代推进1个tick。
+// dtlb_miss/timer为每个定时器的dTLB读缺失，只在perf_event_open可用时输出。
+static const size_t MEM_TIMERS = 4000000;
+static const uint32_t MEM_SLOTS = 16384;
+static timer_wheel_t* g_memWheel;
+
+// 本线程用户态dTLB读缺失计数
+struct TlbCounter {
+    int fd;
+    TlbCounter()
+    {
+        struct perf_event_attr a;
+        memset(&a, 0, sizeof(a));
+        a.size = sizeof(a);
+        a.type = PERF_TYPE_HW_CACHE;
+        a.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        a.exclude_kernel = 1;
+        a.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+    }
+    ~TlbCounter()
+    {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    uint64_t read() const
+    {
+        uint64_t v = 0;
+        if (fd < 0 || ::read(fd, &v, sizeof(v)) != (ssize_t)sizeof(v)) {
+            return 0;
+        }
+        return v;
+    }
+};
+
+static double anonHugeMb()
+{
+    FILE* f = fopen("/proc/self/smaps_rollup", "r");
+    char line[256];
+    double kb = 0;
+
+    if (f == NULL) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "AnonHugePages: %lf kB", &kb) == 1) {
+            break;
+        }
+    }
+    fclose(f);
+    return kb / 1024;
+}
+
+static void memRearm(timer_entry_t* e)
+{
+    timer_wheel_entry_start(g_memWheel, e, memRearm, e->timeout, g_now);
+}
+
+template <bool roll>
+static void BM_CWheel_HugePage(benchmark::State& st)
+{
+    unsigned flags = st.range(0) ? WHEEL_MEM_HUGEPAGE : 0;
+    size_t poolSize = MEM_TIMERS * sizeof(timer_entry_t);
+    int poolKind;
+    timer_entry_t* pool = (timer_entry_t*)wheel_mem_alloc(poolSize, flags, -1, &poolKind);
+    timer_wheel_attr_t attr = { MEM_SLOTS, flags, -1 };
+    timer_wheel_t* w = new timer_wheel_t;
+    TlbCounter tlb;
+    uint64_t misses = 0, timers = 0;
+    unsigned seed = 1;
+
+    if (pool == NULL || timer_wheel_init_attr(w, &attr) != 0) {
+        st.SkipWithError("out of memory");
+        wheel_mem_free(pool, poolSize, poolKind);
+        delete w;
+        return;
+    }
+    for (size_t i = 0; i < MEM_TIMERS; ++i) {
+        timer_wheel_entry_init(&pool[i]);
+        pool[i].timeout = 1 + rand_r(&seed) % (MEM_SLOTS - 2);
+    }
+    g_memWheel = w;
+    g_now = 1;
+    timer_wheel_start(w, g_now);
+    if (roll) {
+        for (size_t i = 0; i < MEM_TIMERS; ++i) {
+            timer_wheel_entry_start(w, &pool[i], memRearm, pool[i].timeout, g_now);
+        }
+    }
+
+    for (auto _ : st) {
+        if (!roll) {
+            st.PauseTiming();
+            timer_wheel_destroy(w);
+            timer_wheel_init_attr(w, &attr);
+            timer_wheel_start(w, g_now);
+            st.ResumeTiming();
+        }
+        uint64_t before = tlb.read();
+        if (roll) {
+            g_now++;
+            timers += timer_wheel_roll(w, g_now);
+        } else {
+            for (size_t i = 0; i < MEM_TIMERS; ++i) {
+                timer_wheel_entry_start(w, &pool[i], noop, pool[i].timeout, g_now);
+            }
+            timers += MEM_TIMERS;
+        }
+        misses += tlb.read() - before;
+    }
+
+    st.SetLabel(wheel_mem_kind_name(poolKind));
+    st.counters["timers/s"] = benchmark::Counter((double)timers, benchmark::Counter::kIsRate);
+    st.counters["huge_mb"] = anonHugeMb();
+    if (tlb.fd >= 0 && timers) {
+        st.counters["dtlb_miss/timer"] = (double)misses / timers;
+    }
+    timer_wheel_destroy(w);
+    delete w;
+    wheel_mem_free(pool, poolSize, poolKind);
+}
+BENCHMARK_TEMPLATE(BM_CWheel_HugePage, false)->ArgName("hugepage")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_CWheel_HugePage, true)->ArgName("hugepage")->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
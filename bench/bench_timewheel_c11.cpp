@@ -0,0 +1,458 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstring>
+#include <malloc.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "timeWheel.h"
+
+// CTimeWheel会话更新与统计查询：不同会话数、不同线程数
+//
+// 所有时间轮共享全局keyMap：sharedWheel()中的会话在整个进程中一直保留，
+// 另建时间轮的测试必须使用与sessionKeys()不重叠的五元组，否则会命中sharedWheel()的会话；
+// sessionCount()返回keyMap的大小，包含其它时间轮的会话，只能看差值。
+// sharedWheel()使用外部时钟模式且从不推进，测试期间会话不会超时。
+
+static CTimeWheel* newQuietWheel()
+{
+    // 进程退出析构时间轮时不逐个打印会话
+    CTimeWheel::verbose = false;
+    return new CTimeWheel(3600, NULL, CTimeWheel::CLOCK_EXTERNAL);
+}
+
+static CTimeWheel* sharedWheel()
+{
+    static std::unique_ptr<CTimeWheel> wheel(newQuietWheel());
+    return wheel.get();
+}
+
+// 第i个会话的五元组，会话数递增的测试复用前面已经加入的会话
+static const std::vector<Sessionkey>& sessionKeys(size_t n)
+{
+    static std::vector<Sessionkey> keys;
+    char src[32], dst[32];
+
+    while (keys.size() < n) {
+        size_t i = keys.size();
+        snprintf(src, sizeof(src), "10.%u.%u.%u", (unsigned)(i >> 16) & 0xff,
+                 (unsigned)(i >> 8) & 0xff, (unsigned)i & 0xff);
+        snprintf(dst, sizeof(dst), "192.168.%u.%u", (unsigned)(i % 7), 1 + (unsigned)(i % 200));
+        keys.push_back(Sessionkey(dst, src, 80 + (int)(i % 4), 1024 + (int)(i % 60000), 6));
+    }
+    return keys;
+}
+
+static void populate(benchmark::State& st, size_t flows)
+{
+    if (st.thread_index() == 0) {
+        const std::vector<Sessionkey>& keys = sessionKeys(flows);
+        for (size_t i = 0; i < flows; ++i) {
+            sharedWheel()->UpdateSession(keys[i], true, 64, 1);
+        }
+    }
+}
+
+static void BM_C11_UpdateSession(benchmark::State& st)
+{
+    size_t flows = (size_t)st.range(0);
+    populate(st, flows);
+    const std::vector<Sessionkey>& keys = sessionKeys(flows);
+    CTimeWheel* wheel = sharedWheel();
+    size_t i = (size_t)st.thread_index() * 7919;
+
+    for (auto _ : st) {
+        // 奇数次迭代使用反向五元组，覆盖反向查找路径
+        const Sessionkey& k = keys[i % flows];
+        if (i & 1) {
+            wheel->UpdateSession(Sessionkey(k.srcIp, k.dstIp, k.srcPort, k.dstPort, k.protocol), false, 1400, 1);
+        } else {
+            wheel->UpdateSession(k, true, 64, 1);
+        }
+        i += 40503;
+    }
+    st.SetItemsProcessed(st.iterations());
+}
+BENCHMARK(BM_C11_UpdateSession)->Arg(1000)->Arg(10000)->Arg(100000)->ThreadRange(1, 4)->UseRealTime();
+
+static void BM_C11_GetSessionStats(benchmark::State& st)
+{
+    size_t flows = (size_t)st.range(0);
+    populate(st, flows);
+    const std::vector<Sessionkey>& keys = sessionKeys(flows);
+    CTimeWheel* wheel = sharedWheel();
+    size_t i = (size_t)st.thread_index() * 7919;
+    SessionStats stats;
+
+    for (auto _ : st) {
+        benchmark::DoNotOptimize(wheel->GetSessionStats(keys[i % flows], stats));
+        i += 40503;
+    }
+    st.SetItemsProcessed(st.iterations());
+}
+BENCHMARK(BM_C11_GetSessionStats)->Arg(1000)->Arg(10000)->Arg(100000)->ThreadRange(1, 4)->UseRealTime();
+
+// 会话超时：100K个流，1M包/秒，外部时钟一个tick记为100ms，即每个tick 100K个数据包随机落在各个流上，
+// 超时10个tick（1s）。Eager每个tick第一次刷新会话时在bucket之间移动，Lazy只记录tick，
+// 所在bucket到期时才移动。使用独立的时间轮和不同于上面测试的五元组，超时的会话会重新创建。
+static const size_t FLOWS = 100000;
+static const size_t PKTS_PER_TICK = 100000;
+
+template <bool lazy>
+static void BM_C11_Flows(benchmark::State& st)
+{
+    static std::vector<Sessionkey> keys;
+    char src[32];
+    while (keys.size() < FLOWS) {
+        size_t i = keys.size();
+        snprintf(src, sizeof(src), "172.16.%u.%u", (unsigned)(i >> 8) & 0xff, (unsigned)i & 0xff);
+        keys.push_back(Sessionkey("10.255.0.1", src, 443, 1024 + (int)(i >> 16), 6));
+    }
+
+    CTimeWheel::verbose = false;
+    CTimeWheel* wheel = new CTimeWheel(10, NULL, CTimeWheel::CLOCK_EXTERNAL);
+    wheel->setLazyRefresh(lazy);
+    uint64_t tick = 1;
+    wheel->start(tick);
+    for (size_t i = 0; i < FLOWS; ++i) {
+        wheel->UpdateSession(keys[i], true, 64, 1);
+    }
+
+    uint64_t expired = 0;
+    uint32_t x = 2463534242u;
+    for (auto _ : st) {
+        expired += wheel->advance(++tick);
+        for (size_t p = 0; p < PKTS_PER_TICK; ++p) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            wheel->UpdateSession(keys[x % FLOWS], true, 64, 1);
+        }
+    }
+
+    st.counters["expired/tick"] = benchmark::Counter((double)expired / st.iterations());
+    st.SetItemsProcessed(st.iterations() * PKTS_PER_TICK);
+    delete wheel;
+}
+BENCHMARK_TEMPLATE(BM_C11_Flows, false)->Iterations(40)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_C11_Flows, true)->Iterations(40)->Unit(benchmark::kMillisecond);
+
+// 会话表扩容：流数从0涨到10M，每个新流后跟3个已有流的数据包，逐包计时（查找，未命中时插入）。
+// 0: 一次性rehash（setRehashStep(0)），1: 渐进式rehash，2: 渐进式且按10M预先分配（reserve）。
+// 为了在普通机器上跑到10M，键是紧凑的IPv4五元组而不是带字符串的Sessionkey，值与会话表相同为weak_ptr。
+// p50/p99/p999/max为每包延迟（ns），直方图误差12.5%；max即扩容时最长的停顿。
+static const size_t RAMP_FLOWS = 10000000;
+static const size_t RAMP_HITS = 3;
+
+struct RampKey {
+    uint32_t sip, dip;
+    uint16_t sport, dport;
+    uint8_t proto;
+    uint8_t pad[3];
+
+    bool operator==(const RampKey& o) const {
+        return sip == o.sip && dip == o.dip && sport == o.sport && dport == o.dport && proto == o.proto;
+    }
+};
+
+struct RampKeyHash {
+    size_t operator()(const RampKey& k) const {
+        return (size_t)hash_bytes(&k, sizeof(k), 0);
+    }
+};
+
+static RampKey rampKey(size_t i)
+{
+    RampKey k;
+    memset(&k, 0, sizeof(k));
+    k.sip = 0x0a000000u + (uint32_t)(i >> 4);
+    k.dip = 0xc0a80001u + (uint32_t)(i % 251);
+    k.sport = (uint16_t)(1024 + (i & 0xf) * 3001);
+    k.dport = 443;
+    k.proto = 6;
+    return k;
+}
+
+static void BM_C11_TableRamp(benchmark::State& st)
+{
+    int mode = (int)st.range(0);
+    std::vector<wheel_hist_t> latency(1);
+    uint64_t packets = 0;
+    uint32_t x = 2463534242u;
+
+    wheel_clock_source();
+    for (auto _ : st) {
+        SessionTable<RampKey, weakEntryPtr, RampKeyHash>* table =
+            new SessionTable<RampKey, weakEntryPtr, RampKeyHash>();
+        if (mode == 0) {
+            table->setRehashStep(0);
+        } else if (mode == 2) {
+            table->reserve(RAMP_FLOWS);
+        }
+        memset(&latency[0], 0, sizeof(latency[0]));
+
+        for (size_t flow = 0; flow < RAMP_FLOWS; ++flow) {
+            for (size_t p = 0; p <= RAMP_HITS; ++p) {
+                // 第一个包属于新流，其余落在已有的流上
+                x ^= x << 13;
+                x ^= x >> 17;
+                x ^= x << 5;
+                RampKey k = rampKey(p == 0 ? flow : x % (flow + 1));
+                uint64_t t0 = wheel_clock_ns();
+                if (table->find(k) == NULL) {
+                    table->insert(k, weakEntryPtr());
+                }
+                wheel_hist_record_n(&latency[0], wheel_clock_ns() - t0, 1);
+            }
+        }
+        packets += RAMP_FLOWS * (RAMP_HITS + 1);
+
+        st.PauseTiming();
+        delete table;
+        st.ResumeTiming();
+    }
+
+    const wheel_hist_t* h = &latency[0];
+    st.SetLabel(mode == 0 ? "stop-the-world" : mode == 1 ? "incremental" : "incremental+reserve");
+    st.counters["p50_ns"] = (double)wheel_hist_percentile(h, 50);
+    st.counters["p99_ns"] = (double)wheel_hist_percentile(h, 99);
+    st.counters["p999_ns"] = (double)wheel_hist_percentile(h, 99.9);
+    st.counters["max_ns"] = (double)h->max;
+    st.SetItemsProcessed(packets);
+}
+BENCHMARK(BM_C11_TableRamp)->Arg(0)->Arg(1)->Arg(2)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+// 主机/前缀索引，10M个会话：会话表（按10M预先分配）与TableRamp相同用紧凑的键，
+// 625K个客户端（10.0.0.0/12，每个16个流）访问251个服务端（192.168.0.x）。
+// 0: 只有会话表，查询只能遍历全部会话；1: 同时维护HostIndex。
+// insert_ns/expire_ns为每个会话建立和超时（含索引维护）的平均耗时，heap_MB为建立10M个会话后的堆增量，
+// host_us/prefix24_us/server_us为查询一个客户端（16个会话）、一个/24（4096个）、一个服务端（约40K个）的耗时，
+// remove16_ms为删除10.1.0.0/16的全部会话（1M个）的耗时。遍历用的是连续的数组，比遍历哈希表快，对0有利。
+struct IndexedFlow {
+    RampKey key;
+    HostIndex<IndexedFlow>::Links* links;
+};
+
+typedef SessionTable<RampKey, IndexedFlow*, RampKeyHash> IndexedTable;
+
+static double elapsedUs(uint64_t t0)
+{
+    return (double)(wheel_clock_ns() - t0) / 1000.0;
+}
+
+static size_t scanPrefix(const std::vector<IndexedFlow>& flows, const HostPrefix& p, std::vector<IndexedFlow*>* out)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < flows.size(); ++i) {
+        const IndexedFlow& f = flows[i];
+        if (f.key.proto != 0 && (p.contains(HostAddr::fromIpv4(f.key.sip)) || p.contains(HostAddr::fromIpv4(f.key.dip)))) {
+            if (out != NULL) {
+                out->push_back(const_cast<IndexedFlow*>(&f));
+            }
+            n++;
+        }
+    }
+    return n;
+}
+
+static void BM_C11_HostIndex(benchmark::State& st)
+{
+    bool indexed = st.range(0) != 0;
+    const char* queries[] = { "10.0.1.2", "10.0.1.0/24", "192.168.0.1" };
+    const char* names[] = { "host_us", "prefix24_us", "server_us" };
+
+    wheel_clock_source();
+    for (auto _ : st) {
+        std::vector<IndexedFlow> flows(RAMP_FLOWS);
+        IndexedTable* table = new IndexedTable(RAMP_FLOWS);
+        HostIndex<IndexedFlow> index;
+        size_t heap0 = mallinfo2().uordblks;
+
+        uint64_t t0 = wheel_clock_ns();
+        for (size_t i = 0; i < RAMP_FLOWS; ++i) {
+            IndexedFlow& f = flows[i];
+            f.key = rampKey(i);
+            f.links = NULL;
+            table->insert(f.key, &f);
+            if (indexed) {
+                f.links = index.link(&f, HostAddr::fromIpv4(f.key.sip), HostAddr::fromIpv4(f.key.dip));
+            }
+        }
+        st.counters["insert_ns"] = (double)(wheel_clock_ns() - t0) / RAMP_FLOWS;
+        st.counters["heap_MB"] = (double)(mallinfo2().uordblks - heap0) / (1 << 20);
+
+        for (int q = 0; q < 3; ++q) {
+            HostPrefix p;
+            HostPrefix::parse(queries[q], p);
+            t0 = wheel_clock_ns();
+            size_t n = indexed ? index.forEach(p, [](IndexedFlow* f) { benchmark::DoNotOptimize(f); })
+                               : scanPrefix(flows, p, NULL);
+            st.counters[names[q]] = elapsedUs(t0);
+            st.counters[std::string(names[q], strchr(names[q], '_')) + "_sessions"] = (double)n;
+        }
+
+        // 批量删除：先收集匹配的会话再逐个删除
+        HostPrefix p;
+        HostPrefix::parse("10.1.0.0/16", p);
+        std::vector<IndexedFlow*> matched;
+        t0 = wheel_clock_ns();
+        if (indexed) {
+            index.forEach(p, [&matched](IndexedFlow* f) { matched.push_back(f); });
+        } else {
+            scanPrefix(flows, p, &matched);
+        }
+        for (size_t i = 0; i < matched.size(); ++i) {
+            if (indexed) {
+                index.unlink(matched[i]->links);
+            }
+            table->erase(matched[i]->key);
+            matched[i]->key.proto = 0;
+        }
+        st.counters["remove16_ms"] = elapsedUs(t0) / 1000.0;
+        st.counters["removed"] = (double)matched.size();
+
+        // 其余的会话超时
+        size_t expired = 0;
+        t0 = wheel_clock_ns();
+        for (size_t i = 0; i < RAMP_FLOWS; ++i) {
+            IndexedFlow& f = flows[i];
+            if (f.key.proto == 0) {
+                continue;
+            }
+            if (indexed) {
+                index.unlink(f.links);
+            }
+            table->erase(f.key);
+            expired++;
+        }
+        st.counters["expire_ns"] = (double)(wheel_clock_ns() - t0) / expired;
+
+        st.PauseTiming();
+        delete table;
+        st.ResumeTiming();
+    }
+    st.SetLabel(indexed ? "indexed" : "table-only");
+}
+BENCHMARK(BM_C11_HostIndex)->Arg(0)->Arg(1)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+// CTimeWheel中维护索引的开销：1M个新会话经UpdateSession建立，含解析地址字符串。
+// 源地址与sessionKeys()相同（10.1.0.0/16内65536个会话），目的地址和端口不同，不会命中sharedWheel()的会话
+static void BM_C11_IndexedInsert(benchmark::State& st)
+{
+    static std::vector<Sessionkey> keys;
+    char src[32], dst[32];
+    while (keys.size() < 1000000) {
+        size_t i = keys.size();
+        snprintf(src, sizeof(src), "10.%u.%u.%u", (unsigned)(i >> 16) & 0xff,
+                 (unsigned)(i >> 8) & 0xff, (unsigned)i & 0xff);
+        snprintf(dst, sizeof(dst), "192.0.2.%u", 1 + (unsigned)(i % 200));
+        keys.push_back(Sessionkey(dst, src, 8080, 1024 + (int)(i % 60000), 6));
+    }
+
+    for (auto _ : st) {
+        st.PauseTiming();
+        CTimeWheel::verbose = false;
+        CTimeWheel* wheel = new CTimeWheel(10, NULL, CTimeWheel::CLOCK_EXTERNAL);
+        wheel->start(1);
+        wheel->reserveSessions(keys.size());
+        if (st.range(0)) {
+            wheel->enableHostIndex();
+        }
+        size_t sessions0 = wheel->sessionCount();
+        st.ResumeTiming();
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+            wheel->UpdateSession(keys[i], true, 64, 1);
+        }
+
+        st.PauseTiming();
+        if (wheel->sessionCount() - sessions0 != keys.size()) {
+            st.SkipWithError("keys overlap sessions of another wheel");
+            delete wheel;
+            break;
+        }
+        uint64_t t0 = wheel_clock_ns();
+        size_t n = wheel->forEachSession("10.1.0.0/16", [](const Sessionkey& k) { benchmark::DoNotOptimize(&k); });
+        st.counters["prefix16_us"] = elapsedUs(t0);
+        st.counters["prefix16_sessions"] = (double)n;
+        delete wheel;
+        st.ResumeTiming();
+    }
+    st.SetLabel(st.range(0) ? "indexed" : "no-index");
+    st.SetItemsProcessed(st.iterations() * 1000000);
+}
+BENCHMARK(BM_C11_IndexedInsert)->Arg(0)->Arg(1)->Iterations(3)->Unit(benchmark::kMillisecond);
+
+// 会话准入过滤：每个tick（1s）100K个数据包，一半是扫描（每个包一个新五元组，1M个五元组循环使用，
+// 再次出现时原来的会话早已超时），一半随机落在20K个正常的流上，方向随机。超时10个tick。
+// 0: 不过滤，每个扫描包创建一个会话；1: setAdmission()默认配置（双向或4个包转正，试用2s）。
+// sessions为本时间轮最后的会话数（keyMap中不含之前测试留下的会话），heap_MB为推进前后malloc占用的增量（含试用表），admitted/rejected为过滤统计。
+static const size_t SCAN_KEYS = 1000000;
+static const size_t LEGIT_FLOWS = 20000;
+static const size_t MIX_PKTS_PER_TICK = 100000;
+
+static void BM_C11_Admission(benchmark::State& st)
+{
+    static std::vector<Sessionkey> scan, legit, legitRev;
+    char ip[32];
+    while (scan.size() < SCAN_KEYS) {
+        size_t i = scan.size();
+        snprintf(ip, sizeof(ip), "198.18.%u.%u", (unsigned)(i >> 8) & 0xff, (unsigned)i & 0xff);
+        scan.push_back(Sessionkey(ip, "203.0.113.7", 1 + (int)(i >> 16), 40000, 6));
+    }
+    while (legit.size() < LEGIT_FLOWS) {
+        size_t i = legit.size();
+        snprintf(ip, sizeof(ip), "100.64.%u.%u", (unsigned)(i >> 8) & 0xff, (unsigned)i & 0xff);
+        legit.push_back(Sessionkey("10.255.0.2", ip, 443, 1024 + (int)(i % 50000), 6));
+        const Sessionkey& k = legit.back();
+        legitRev.push_back(Sessionkey(k.srcIp, k.dstIp, k.srcPort, k.dstPort, k.protocol));
+    }
+
+    CTimeWheel::verbose = false;
+    CTimeWheel* wheel = new CTimeWheel(10, NULL, CTimeWheel::CLOCK_EXTERNAL);
+    if (st.range(0)) {
+        wheel->setAdmission(AdmissionConfig());
+    }
+    uint64_t tick = 1;
+    wheel->start(tick);
+    size_t heap0 = mallinfo2().uordblks;
+    size_t sessions0 = wheel->sessionCount();
+
+    size_t nextScan = 0;
+    uint32_t x = 2463534242u;
+    for (auto _ : st) {
+        wheel->advance(++tick);
+        for (size_t p = 0; p < MIX_PKTS_PER_TICK; ++p) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            if (x & 1) {
+                wheel->UpdateSession(scan[nextScan], true, 60, 1);
+                nextScan = (nextScan + 1) % SCAN_KEYS;
+            } else if (x & 2) {
+                wheel->UpdateSession(legit[(x >> 2) % LEGIT_FLOWS], true, 200, 1);
+            } else {
+                wheel->UpdateSession(legitRev[(x >> 2) % LEGIT_FLOWS], false, 1400, 1);
+            }
+        }
+    }
+
+    size_t heap = mallinfo2().uordblks;
+    AdmissionStats as;
+    st.SetLabel(st.range(0) ? "admission" : "direct");
+    st.counters["sessions"] = (double)(wheel->sessionCount() - sessions0);
+    st.counters["heap_MB"] = (double)(heap - heap0) / (1 << 20);
+    if (wheel->admissionStats(as)) {
+        st.counters["admitted"] = (double)as.admitted;
+        st.counters["rejected"] = (double)as.rejected;
+        st.counters["evicted"] = (double)as.evicted;
+        st.counters["filter_MB"] = (double)as.memoryBytes / (1 << 20);
+    }
+    st.SetItemsProcessed(st.iterations() * MIX_PKTS_PER_TICK);
+    delete wheel;
+}
+BENCHMARK(BM_C11_Admission)->Arg(0)->Arg(1)->Iterations(40)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
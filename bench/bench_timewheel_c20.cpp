@@ -0,0 +1,144 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+#include <vector>
+
+#include "coroWheel.h"
+
+// C++20协程接口：1M个协程同时挂在sleep_for上，每个协程循环sleep_for(1~1000ms)，1ms一个tick。
+// 每次迭代推进1个tick并恢复到期的协程。resumes/s为每秒恢复的协程数；
+// frame_bytes/waiter为每个协程帧的大小（operator new统计），等待对象和定时器节点都在帧中，
+// heap_bytes/waiter为创建协程前后堆的增量（含malloc的开销），wait_allocs为进入稳态后每次等待分配内存的次数（应为0）。
+// BM_C20_Callback为同样负载下直接用C时间轮回调重新加入，作为协程层开销的对照。
+
+static size_t g_allocs;
+static size_t g_allocBytes;
+
+// 替换全局operator new只为计数；gcc把内联后的malloc/free误判为不匹配
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(size_t n)
+{
+    g_allocs++;
+    g_allocBytes += n;
+    void* p = malloc(n);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+static const size_t WAITERS = 1000000;
+static const uint32_t MAX_SLEEP = 1000;
+
+// 测试函数会被调用多次，后几次复用前一次释放的内存，RSS不再增长，因此统计堆的使用量
+static size_t heapBytes()
+{
+    return mallinfo2().uordblks;
+}
+
+static CoroTask<> sleeper(CoroWheel& wheel, uint32_t period, uint64_t* resumes)
+{
+    for (;;) {
+        co_await wheel.sleep_for(std::chrono::milliseconds(period));
+        (*resumes)++;
+    }
+}
+
+static void BM_C20_Sleep(benchmark::State& st)
+{
+    CoroWheel wheel(1, 1024);
+    std::vector<CoroTask<>> tasks;
+    uint64_t resumes = 0, resumed = 0;
+    unsigned seed = 1;
+    uint32_t now = 1;
+
+    tasks.reserve(WAITERS);
+    size_t heap0 = heapBytes(), bytes0 = g_allocBytes, allocs0 = g_allocs;
+    for (size_t i = 0; i < WAITERS; ++i) {
+        tasks.push_back(sleeper(wheel, 1 + rand_r(&seed) % MAX_SLEEP, &resumes));
+        tasks.back().start();
+    }
+    size_t frameBytes = g_allocBytes - bytes0, frames = g_allocs - allocs0;
+    size_t heap = heapBytes() - heap0;
+
+    // 先跑一圈，让每个协程都至少重新等待过一次
+    for (uint32_t i = 0; i < MAX_SLEEP; ++i) {
+        wheel.tick(++now);
+    }
+    size_t allocs1 = g_allocs;
+    uint64_t resumes1 = resumes;
+
+    for (auto _ : st) {
+        resumed += wheel.tick(++now);
+    }
+
+    if (wheel.pending() != WAITERS || resumed != resumes - resumes1) {
+        st.SkipWithError("lost waiters");
+    }
+    st.counters["resumes/s"] = benchmark::Counter((double)resumed, benchmark::Counter::kIsRate);
+    st.counters["resumes/tick"] = (double)resumed / st.iterations();
+    st.counters["frame_bytes/waiter"] = (double)frameBytes / WAITERS;
+    st.counters["frames/waiter"] = (double)frames / WAITERS;
+    st.counters["heap_bytes/waiter"] = (double)heap / WAITERS;
+    st.counters["wait_allocs"] = resumed ? (double)(g_allocs - allocs1) / resumed : 0;
+    tasks.clear();
+}
+BENCHMARK(BM_C20_Sleep)->Unit(benchmark::kMicrosecond);
+
+// 对照：同样的周期分布，timer_entry_t放在数组中，回调中直接重新加入
+static timer_wheel_t* g_wheel;
+static uint32_t g_now;
+static uint64_t g_fired;
+
+static void rearm(timer_entry_t* e)
+{
+    g_fired++;
+    timer_wheel_entry_start(g_wheel, e, rearm, e->timeout, g_now);
+}
+
+static void BM_C20_Callback(benchmark::State& st)
+{
+    timer_wheel_attr_t attr = { 1024, 0, -1 };
+    timer_wheel_t w;
+    std::vector<timer_entry_t> entries(WAITERS);
+    unsigned seed = 1;
+    uint64_t fired0;
+
+    timer_wheel_init_attr(&w, &attr);
+    g_wheel = &w;
+    g_now = 1;
+    timer_wheel_start(&w, g_now);
+    for (size_t i = 0; i < WAITERS; ++i) {
+        timer_wheel_entry_init(&entries[i]);
+        timer_wheel_entry_start(&w, &entries[i], rearm, 1 + rand_r(&seed) % MAX_SLEEP, g_now);
+    }
+    for (uint32_t i = 0; i < MAX_SLEEP; ++i) {
+        timer_wheel_roll(&w, ++g_now);
+    }
+    fired0 = g_fired;
+
+    for (auto _ : st) {
+        timer_wheel_roll(&w, ++g_now);
+    }
+
+    st.counters["resumes/s"] = benchmark::Counter((double)(g_fired - fired0), benchmark::Counter::kIsRate);
+    st.counters["resumes/tick"] = (double)(g_fired - fired0) / st.iterations();
+    st.counters["frame_bytes/waiter"] = (double)sizeof(timer_entry_t);
+    timer_wheel_destroy(&w);
+}
+BENCHMARK(BM_C20_Callback)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
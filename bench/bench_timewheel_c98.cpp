@@ -0,0 +1,207 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <stdint.h>
+#include <unistd.h>
+#include <vector>
+
+#include "timerWheel.h"
+
+// C++98单层时间轮：addTimer与tick，不启动工作线程，由测试直接驱动tick()
+
+static const int kWheelSize = 512;
+
+// 到期后以相同延迟重新加入，时间轮中的定时器数量保持不变
+struct Rearm {
+    TimerWheel* wheel;
+    int delayMs;
+    unsigned long fired;
+};
+
+static void rearm(void* arg)
+{
+    Rearm* r = (Rearm*)arg;
+    r->fired++;
+    r->wheel->addTimer(r->delayMs, rearm, r);
+}
+
+static void noop(void*)
+{
+}
+
+// 每次迭代向空时间轮加入n个定时器，延迟分布在4圈以内
+static void BM_C98_AddTimer(benchmark::State& st)
+{
+    int n = (int)st.range(0);
+    std::vector<int> delays(n);
+    unsigned seed = 1;
+    for (int i = 0; i < n; ++i) {
+        delays[i] = 1 + rand_r(&seed) % (4 * kWheelSize);
+    }
+
+    for (auto _ : st) {
+        st.PauseTiming();
+        TimerWheel* wheel = new TimerWheel(kWheelSize, 1);
+        st.ResumeTiming();
+
+        for (int i = 0; i < n; ++i) {
+            wheel->addTimer(delays[i], noop, NULL);
+        }
+
+        st.PauseTiming();
+        delete wheel;
+        st.ResumeTiming();
+    }
+    st.SetItemsProcessed(st.iterations() * n);
+}
+BENCHMARK(BM_C98_AddTimer)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+// 稳态下每个tick的耗时：n个定时器，到期即重新加入
+static void BM_C98_Tick(benchmark::State& st)
+{
+    int n = (int)st.range(0);
+    TimerWheel wheel(kWheelSize, 1);
+    std::vector<Rearm> timers(n);
+    unsigned seed = 1;
+
+    for (int i = 0; i < n; ++i) {
+        timers[i].wheel = &wheel;
+        timers[i].delayMs = 1 + rand_r(&seed) % (4 * kWheelSize);
+        timers[i].fired = 0;
+        wheel.addTimer(timers[i].delayMs, rearm, &timers[i]);
+    }
+
+    for (auto _ : st) {
+        wheel.tick();
+    }
+
+    unsigned long fired = 0;
+    for (int i = 0; i < n; ++i) {
+        fired += timers[i].fired;
+    }
+    st.counters["fired/tick"] = benchmark::Counter((double)fired / st.iterations());
+    st.SetItemsProcessed(st.iterations());
+}
+BENCHMARK(BM_C98_Tick)->RangeMultiplier(10)->Range(1000, 1000000);
+
+// 同时到期：1M个定时器在同一个tick到期，回调模拟约100ns的会话释放工作。
+// workers为0时在tick()中串行执行，否则交给线程池；wait为1时tick()等回调全部执行完才返回。
+static std::vector<uint64_t> g_sessions;
+static unsigned long g_fired;
+
+static void releaseSession(void* arg)
+{
+    uint64_t& v = g_sessions[(size_t)arg];
+    for (int i = 0; i < 32; ++i) {
+        v = v * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    __atomic_add_fetch(&g_fired, 1, __ATOMIC_RELAXED);
+}
+
+static void BM_C98_ParallelTick(benchmark::State& st)
+{
+    size_t n = (size_t)st.range(0);
+    unsigned workers = (unsigned)st.range(1);
+    bool wait = st.range(2) != 0;
+    TimerWheel wheel(kWheelSize, 1);
+    wheel_pool_t* pool = workers ? wheel_pool_create(workers) : NULL;
+
+    wheel.setPool(pool, wait);
+    g_sessions.assign(n, 0);
+
+    for (auto _ : st) {
+        st.PauseTiming();
+        g_fired = 0;
+        for (size_t i = 0; i < n; ++i) {
+            wheel.addTimer(1, releaseSession, (void*)i);
+        }
+        // 定时器在下一个slot，先走过当前slot
+        wheel.tick();
+        st.ResumeTiming();
+
+        wheel.tick();
+
+        st.PauseTiming();
+        wheel.setPool(pool, wait);
+        if (g_fired != n) {
+            st.SkipWithError("not all timers expired");
+            break;
+        }
+        st.ResumeTiming();
+    }
+
+    wheel_metrics_snapshot_t* snap = new wheel_metrics_snapshot_t;
+    wheel.snapshot(snap);
+    const wheel_hist_t* late = &snap->hists[WHEEL_HIST_LATENESS];
+    st.counters["late_p99_ms"] = wheel_hist_percentile(late, 99) / 1e6;
+    st.counters["late_max_ms"] = late->max / 1e6;
+    st.SetItemsProcessed(st.iterations() * n);
+    delete snap;
+
+    wheel.setPool(NULL, false);
+    wheel_pool_destroy(pool);
+}
+BENCHMARK(BM_C98_ParallelTick)->ArgNames({"timers", "workers", "wait"})
+    ->Args({1000000, 0, 1})
+    ->Args({1000000, 1, 1})->Args({1000000, 4, 1})->Args({1000000, 16, 1})
+    ->Args({1000000, 1, 0})->Args({1000000, 4, 0})->Args({1000000, 16, 0})
+    ->Iterations(5)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// 定时器slack：1M个空闲超时定时器，1ms一个tick，超时分布在[500, 2500)ms之间，到期后以相同超时重新加入。
+// 启动工作线程，它只在有定时器的槽醒来。slack取超时的0%、5%、20%；每次迭代运行1秒，
+// Time为这1秒内整个进程的CPU时间，wakeups/s为工作线程每秒醒来的次数，late_ms为相对应到期时间的平均推迟。
+static const int kIdleTimers = 1000000;
+
+struct IdleTimer {
+    TimerWheel* wheel;
+    int delayMs;
+    int slackMs;
+    uint64_t dueNs;
+};
+
+static uint64_t g_lateNs;
+static unsigned long g_expired;
+
+static void idleExpired(void* arg)
+{
+    IdleTimer* t = (IdleTimer*)arg;
+    uint64_t now = wheel_clock_ns();
+    g_lateNs += now > t->dueNs ? now - t->dueNs : 0;
+    g_expired++;
+    t->dueNs = now + (uint64_t)t->delayMs * 1000000ULL;
+    t->wheel->addTimer(t->delayMs, idleExpired, t, t->slackMs);
+}
+
+static void BM_C98_Slack(benchmark::State& st)
+{
+    int pct = (int)st.range(0);
+    TimerWheel wheel(4096, 1);
+    std::vector<IdleTimer> timers(kIdleTimers);
+    unsigned seed = 1;
+    uint64_t now = wheel_clock_ns();
+
+    for (int i = 0; i < kIdleTimers; ++i) {
+        timers[i].wheel = &wheel;
+        timers[i].delayMs = 500 + rand_r(&seed) % 2000;
+        timers[i].slackMs = timers[i].delayMs * pct / 100;
+        timers[i].dueNs = now + (uint64_t)timers[i].delayMs * 1000000ULL;
+        wheel.addTimer(timers[i].delayMs, idleExpired, &timers[i], timers[i].slackMs);
+    }
+    g_lateNs = 0;
+    g_expired = 0;
+    wheel.start();
+    uint64_t wakeups = wheel.wakeups();
+
+    for (auto _ : st) {
+        usleep(1000000);
+    }
+
+    wheel.stop();
+    st.counters["wakeups/s"] = benchmark::Counter((double)(wheel.wakeups() - wakeups) / st.iterations());
+    st.counters["expired/s"] = benchmark::Counter((double)g_expired / st.iterations());
+    st.counters["late_ms"] = g_expired ? (double)g_lateNs / g_expired / 1e6 : 0;
+}
+BENCHMARK(BM_C98_Slack)->ArgName("slack_pct")->Arg(0)->Arg(5)->Arg(20)
+    ->Iterations(3)->UseRealTime()->MeasureProcessCPUTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
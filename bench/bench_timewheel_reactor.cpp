@@ -0,0 +1,292 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "timerWheel.h"
+
+// 事件循环集成：epoll回显服务，100K个连接（socketpair，受RLIMIT_NOFILE限制时减少）各有一个空闲定时器。
+// 每次迭代客户端在BATCH个连接上各发一条消息，事件循环回显后客户端读回；只有1/8的连接有数据，其余的一直空闲。
+// 空闲定时器到期时连接在此期间有数据则按剩余时间重新定时，否则记一次空闲超时再定一个周期（保持连接数不变）。
+//   timerfd: 时间轮的timerfd和连接在同一个epoll中，到期处理在事件循环线程上
+//   thread:  时间轮自己的工作线程执行回调，把连接经加锁队列和eventfd交回事件循环线程处理
+// echoes/s为回显吞吐，timer_wakeups为时间轮醒来的次数，handoffs为eventfd唤醒事件循环的次数，
+// cpu_ns/echo为整个进程（含工作线程）每次回显的CPU时间
+
+static const int CONNECTIONS = 100000;
+static const int BATCH = 64;
+static const int MSG = 64;
+static const int ACTIVE_DIV = 8;
+static const int IDLE_MS = 500;
+static const int WHEEL_SLOTS = 1024;
+static const uint64_t IDLE_NS = (uint64_t)IDLE_MS * 1000000ULL;
+
+enum Mode { MODE_TIMERFD, MODE_THREAD };
+
+struct Server;
+
+struct Conn {
+    int fd;                 // 服务端
+    int peer;               // 客户端
+    uint64_t lastActive;
+    Server* server;
+};
+
+struct Server {
+    TimerWheel wheel;
+    Mode mode;
+    int ep;
+    int handoffFd;
+    pthread_mutex_t mtx;
+    std::vector<Conn*> handoff;     // 工作线程交给事件循环的到期连接
+    uint64_t idleTimeouts;
+    uint64_t expired;
+    uint64_t handoffs;
+
+    Server() : wheel(WHEEL_SLOTS, 1), mode(MODE_TIMERFD), ep(-1), handoffFd(-1),
+               idleTimeouts(0), expired(0), handoffs(0)
+    {
+        pthread_mutex_init(&mtx, NULL);
+    }
+
+    ~Server()
+    {
+        pthread_mutex_destroy(&mtx);
+    }
+};
+
+// epoll_event.data.ptr为连接，或以下两个标记
+static char g_timerTag;
+static char g_handoffTag;
+
+static void onIdle(void* arg);
+
+// 在事件循环线程上检查到期的连接
+static void checkIdle(Conn* c)
+{
+    Server* s = c->server;
+    uint64_t now = wheel_clock_ns();
+    uint64_t idle = now - c->lastActive;
+
+    s->expired++;
+    if (idle < IDLE_NS) {
+        s->wheel.addTimer((int)((IDLE_NS - idle) / 1000000ULL), onIdle, c);
+        return;
+    }
+    // 真实的服务在这里关闭连接
+    s->idleTimeouts++;
+    c->lastActive = now;
+    s->wheel.addTimer(IDLE_MS, onIdle, c);
+}
+
+static void onIdle(void* arg)
+{
+    Conn* c = (Conn*)arg;
+    Server* s = c->server;
+
+    if (s->mode == MODE_TIMERFD) {
+        checkIdle(c);
+        return;
+    }
+    // 工作线程不能碰连接的状态，交回事件循环线程
+    pthread_mutex_lock(&s->mtx);
+    bool wake = s->handoff.empty();
+    s->handoff.push_back(c);
+    pthread_mutex_unlock(&s->mtx);
+    if (wake) {
+        uint64_t one = 1;
+        if (write(s->handoffFd, &one, sizeof(one)) < 0) {
+            abort();
+        }
+    }
+}
+
+static void drainHandoff(Server* s)
+{
+    uint64_t n;
+    std::vector<Conn*> ready;
+
+    if (read(s->handoffFd, &n, sizeof(n)) < 0) {
+        return;
+    }
+    s->handoffs++;
+    pthread_mutex_lock(&s->mtx);
+    ready.swap(s->handoff);
+    pthread_mutex_unlock(&s->mtx);
+    for (size_t i = 0; i < ready.size(); ++i) {
+        checkIdle(ready[i]);
+    }
+}
+
+// 运行事件循环直到回显了want条消息，返回epoll_wait返回的次数
+static uint64_t runLoop(Server* s, int want)
+{
+    struct epoll_event evs[256];
+    char buf[MSG];
+    uint64_t waits = 0;
+
+    while (want > 0) {
+        int n = epoll_wait(s->ep, evs, 256, -1);
+        waits++;
+        for (int i = 0; i < n; ++i) {
+            void* p = evs[i].data.ptr;
+            if (p == &g_timerTag) {
+                s->wheel.processExpired(wheel_clock_mono_ns());
+                continue;
+            }
+            if (p == &g_handoffTag) {
+                drainHandoff(s);
+                continue;
+            }
+            Conn* c = (Conn*)p;
+            ssize_t r = read(c->fd, buf, sizeof(buf));
+            if (r > 0) {
+                if (write(c->fd, buf, r) != r) {
+                    abort();
+                }
+                c->lastActive = wheel_clock_ns();
+                want--;
+            }
+        }
+    }
+    return waits;
+}
+
+static uint64_t cpuNs()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ULL +
+           (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+}
+
+// 每个连接占两个fd，按RLIMIT_NOFILE能打开的数量减少连接数
+static int connectionLimit()
+{
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        getrlimit(RLIMIT_NOFILE, &rl);
+        if (rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < (rlim_t)CONNECTIONS * 2 + 64) {
+            return (int)((rl.rlim_cur - 64) / 2);
+        }
+    }
+    return CONNECTIONS;
+}
+
+static void BM_Reactor_Echo(benchmark::State& st)
+{
+    Server s;
+    s.mode = (Mode)st.range(0);
+    int nconn = connectionLimit();
+    std::vector<Conn> conns(nconn);
+    struct epoll_event ev;
+    unsigned seed = 1;
+
+    s.ep = epoll_create1(EPOLL_CLOEXEC);
+    for (int i = 0; i < nconn; ++i) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) != 0) {
+            st.SkipWithError("socketpair failed");
+            for (int j = 0; j < i; ++j) {
+                close(conns[j].fd);
+                close(conns[j].peer);
+            }
+            close(s.ep);
+            return;
+        }
+        conns[i].fd = sv[0];
+        conns[i].peer = sv[1];
+        conns[i].server = &s;
+        conns[i].lastActive = wheel_clock_ns();
+        ev.events = EPOLLIN;
+        ev.data.ptr = &conns[i];
+        epoll_ctl(s.ep, EPOLL_CTL_ADD, sv[0], &ev);
+    }
+
+    if (s.mode == MODE_TIMERFD) {
+        ev.events = EPOLLIN;
+        ev.data.ptr = &g_timerTag;
+        epoll_ctl(s.ep, EPOLL_CTL_ADD, s.wheel.timerFd(), &ev);
+    } else {
+        s.handoffFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        ev.events = EPOLLIN;
+        ev.data.ptr = &g_handoffTag;
+        epoll_ctl(s.ep, EPOLL_CTL_ADD, s.handoffFd, &ev);
+        s.wheel.start();
+    }
+    // 初始的到期时间分散在一个空闲周期内
+    for (int i = 0; i < nconn; ++i) {
+        s.wheel.addTimer(1 + rand_r(&seed) % IDLE_MS, onIdle, &conns[i]);
+    }
+
+    // 按随机顺序轮流使用活跃的连接，一批中的连接互不相同
+    int active = nconn / ACTIVE_DIV;
+    std::vector<int> order(nconn);
+    for (int i = 0; i < nconn; ++i) {
+        order[i] = i;
+    }
+    for (int i = nconn - 1; i > 0; --i) {
+        std::swap(order[i], order[rand_r(&seed) % (i + 1)]);
+    }
+
+    char msg[MSG];
+    memset(msg, 'x', sizeof(msg));
+    size_t next = 0;
+    uint64_t waits = 0, echoes = 0;
+    uint64_t wakeups0 = s.wheel.wakeups(), cpu0 = cpuNs();
+
+    for (auto _ : st) {
+        Conn* batch[BATCH];
+        for (int i = 0; i < BATCH; ++i) {
+            batch[i] = &conns[order[next]];
+            next = (next + 1) % active;
+            if (write(batch[i]->peer, msg, sizeof(msg)) != (ssize_t)sizeof(msg)) {
+                abort();
+            }
+        }
+        waits += runLoop(&s, BATCH);
+        char buf[MSG];
+        for (int i = 0; i < BATCH; ++i) {
+            if (read(batch[i]->peer, buf, sizeof(buf)) != (ssize_t)sizeof(buf)) {
+                abort();
+            }
+        }
+        echoes += BATCH;
+    }
+
+    uint64_t cpu = cpuNs() - cpu0, wakeups = s.wheel.wakeups() - wakeups0;
+    s.wheel.stop();
+    for (int i = 0; i < nconn; ++i) {
+        close(conns[i].fd);
+        close(conns[i].peer);
+    }
+    if (s.handoffFd >= 0) {
+        close(s.handoffFd);
+    }
+    close(s.ep);
+
+    st.SetLabel(s.mode == MODE_TIMERFD ? "timerfd" : "thread");
+    st.counters["connections"] = nconn;
+    st.counters["echoes/s"] = benchmark::Counter((double)echoes, benchmark::Counter::kIsRate);
+    st.counters["expired/s"] = benchmark::Counter((double)s.expired, benchmark::Counter::kIsRate);
+    st.counters["idle_timeouts"] = (double)s.idleTimeouts;
+    st.counters["timer_wakeups"] = (double)wakeups;
+    st.counters["handoffs"] = (double)s.handoffs;
+    st.counters["epoll_waits/batch"] = (double)waits / st.iterations();
+    st.counters["cpu_ns/echo"] = echoes ? (double)cpu / echoes : 0;
+}
+BENCHMARK(BM_Reactor_Echo)->Arg(MODE_TIMERFD)->Arg(MODE_THREAD)->MinTime(2.0)->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,295 @@
+#include "actor.h"
+#include <sched.h>
+#include <time.h>
+
+// 当前线程正在处理的actor
+static __thread unsigned tlsCurrentActor = (unsigned)-1;
+
+// Mailbox类实现
+Mailbox::Mailbox(size_t capacity) : enqueuePos_(0), dequeuePos_(0) {
+    // 容量向上取整为2的幂，用掩码代替取模
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    cells_.resize(size);
+    mask_ = size - 1;
+    for (size_t i = 0; i < size; ++i) {
+        cells_[i].seq = i;
+    }
+}
+
+bool Mailbox::push(const Event& event) {
+    size_t pos = __atomic_load_n(&enqueuePos_, __ATOMIC_RELAXED);
+    Cell* cell;
+    for (;;) {
+        cell = &cells_[pos & mask_];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&enqueuePos_, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;   // 已满
+        } else {
+            pos = __atomic_load_n(&enqueuePos_, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->event = event;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool Mailbox::pop(Event& event) {
+    size_t pos = dequeuePos_;
+    Cell* cell = &cells_[pos & mask_];
+    size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    if (seq != pos + 1) {
+        return false;
+    }
+
+    event = cell->event;
+    __atomic_store_n(&cell->seq, pos + mask_ + 1, __ATOMIC_RELEASE);
+    dequeuePos_ = pos + 1;
+    return true;
+}
+
+bool Mailbox::empty() const {
+    const Cell* cell = &cells_[dequeuePos_ & mask_];
+    return __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != dequeuePos_ + 1;
+}
+
+// ActorRuntime类实现
+ActorRuntime::ActorRuntime(size_t workers, size_t mailboxCapacity, size_t batch)
+    : mailboxCapacity_(mailboxCapacity), batch_(batch ? batch : 1),
+      started_(false), stopping_(0), pending_(0) {
+    if (workers == 0) {
+        workers = 1;
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        Worker* w = new Worker;
+        w->runtime = this;
+        w->index = i;
+        w->stolen = 0;
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->cond, NULL);
+        workers_.push_back(w);
+    }
+}
+
+ActorRuntime::~ActorRuntime() {
+    stop();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        pthread_mutex_destroy(&workers_[i]->lock);
+        pthread_cond_destroy(&workers_[i]->cond);
+        delete workers_[i];
+    }
+    for (size_t i = 0; i < actors_.size(); ++i) {
+        delete actors_[i];
+    }
+}
+
+unsigned ActorRuntime::addMachine(StateMachine* machine) {
+    unsigned id = (unsigned)actors_.size();
+    // Fibonacci哈希，让连续的id均匀分布到各个worker
+    size_t home = (size_t)((id * 2654435761u) >> 8) % workers_.size();
+    actors_.push_back(new Actor(id, machine, home, mailboxCapacity_));
+    return id;
+}
+
+bool ActorRuntime::start() {
+    if (started_) {
+        return true;
+    }
+    stopping_ = 0;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        if (pthread_create(&workers_[i]->thread, NULL, workerThread, workers_[i]) != 0) {
+            std::cout << "create actor worker thread failed!" << std::endl;
+            // 只join已经创建的worker，运行时回到未启动状态
+            joinWorkers(i);
+            return false;
+        }
+    }
+    started_ = true;
+    return true;
+}
+
+void ActorRuntime::stop() {
+    if (!started_) {
+        return;
+    }
+    waitIdle();
+    joinWorkers(workers_.size());
+    started_ = false;
+}
+
+void ActorRuntime::joinWorkers(size_t num) {
+    __atomic_store_n(&stopping_, 1, __ATOMIC_SEQ_CST);
+    for (size_t i = 0; i < num; ++i) {
+        pthread_mutex_lock(&workers_[i]->lock);
+        pthread_cond_broadcast(&workers_[i]->cond);
+        pthread_mutex_unlock(&workers_[i]->lock);
+    }
+    for (size_t i = 0; i < num; ++i) {
+        pthread_join(workers_[i]->thread, NULL);
+    }
+}
+
+bool ActorRuntime::post(unsigned id, const Event& event) {
+    if (id >= actors_.size()) {
+        return false;
+    }
+    Actor* actor = actors_[id];
+    __atomic_add_fetch(&pending_, 1, __ATOMIC_RELAXED);
+    if (!actor->mailbox.push(event)) {
+        __atomic_sub_fetch(&pending_, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    // 与run()中清除scheduled后的检查配对，避免事件留在邮箱中无人处理
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    schedule(actor);
+    return true;
+}
+
+void ActorRuntime::send(unsigned id, const Event& event) {
+    while (!post(id, event)) {
+        if (id >= actors_.size()) {
+            return;
+        }
+        sched_yield();
+    }
+}
+
+void ActorRuntime::waitIdle() {
+    while (__atomic_load_n(&pending_, __ATOMIC_ACQUIRE) > 0) {
+        sched_yield();
+    }
+}
+
+uint64_t ActorRuntime::stolenCount() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        total += __atomic_load_n(&workers_[i]->stolen, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+unsigned ActorRuntime::currentActorId() {
+    return tlsCurrentActor;
+}
+
+void* ActorRuntime::workerThread(void* arg) {
+    Worker* worker = (Worker*)arg;
+    worker->runtime->workerLoop(worker);
+    return NULL;
+}
+
+void ActorRuntime::schedule(Actor* actor) {
+    int expected = 0;
+    if (__atomic_compare_exchange_n(&actor->scheduled, &expected, 1, false,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        enqueue(workers_[actor->home], actor);
+    }
+}
+
+void ActorRuntime::enqueue(Worker* worker, Actor* actor) {
+    pthread_mutex_lock(&worker->lock);
+    bool wasEmpty = worker->runQueue.empty();
+    worker->runQueue.push_back(actor);
+    if (wasEmpty) {
+        pthread_cond_signal(&worker->cond);
+    }
+    pthread_mutex_unlock(&worker->lock);
+}
+
+Actor* ActorRuntime::popLocal(Worker* worker) {
+    Actor* actor = NULL;
+    pthread_mutex_lock(&worker->lock);
+    if (!worker->runQueue.empty()) {
+        actor = worker->runQueue.front();
+        worker->runQueue.pop_front();
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return actor;
+}
+
+Actor* ActorRuntime::steal(Worker* thief) {
+    size_t n = workers_.size();
+    for (size_t i = 1; i < n; ++i) {
+        Worker* victim = workers_[(thief->index + i) % n];
+        if (pthread_mutex_trylock(&victim->lock) != 0) {
+            continue;
+        }
+        Actor* actor = NULL;
+        if (!victim->runQueue.empty()) {
+            // 从尾部窃取，减少与victim本身在队头的竞争
+            actor = victim->runQueue.back();
+            victim->runQueue.pop_back();
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (actor) {
+            __atomic_add_fetch(&thief->stolen, 1, __ATOMIC_RELAXED);
+            return actor;
+        }
+    }
+    return NULL;
+}
+
+void ActorRuntime::run(Worker* worker, Actor* actor) {
+    Event event(0);
+    size_t handled = 0;
+
+    tlsCurrentActor = actor->id;
+    while (handled < batch_ && actor->mailbox.pop(event)) {
+        actor->machine->handleEvent(event);
+        ++handled;
+    }
+    tlsCurrentActor = (unsigned)-1;
+    __atomic_sub_fetch(&pending_, (long)handled, __ATOMIC_RELEASE);
+
+    if (!actor->mailbox.empty()) {
+        // 批次用完但邮箱仍有事件：保持scheduled，放回当前worker队尾
+        enqueue(worker, actor);
+        return;
+    }
+
+    __atomic_store_n(&actor->scheduled, 0, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!actor->mailbox.empty()) {
+        schedule(actor);
+    }
+}
+
+void ActorRuntime::workerLoop(Worker* worker) {
+    for (;;) {
+        Actor* actor = popLocal(worker);
+        if (!actor) {
+            actor = steal(worker);
+        }
+        if (actor) {
+            run(worker, actor);
+            continue;
+        }
+
+        pthread_mutex_lock(&worker->lock);
+        if (worker->runQueue.empty()) {
+            if (__atomic_load_n(&stopping_, __ATOMIC_SEQ_CST)) {
+                pthread_mutex_unlock(&worker->lock);
+                break;
+            }
+            // 限时等待，醒来后重新尝试窃取
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += 1000000;
+            if (ts.tv_nsec >= 1000000000) {
+                ts.tv_sec += 1;
+                ts.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&worker->cond, &worker->lock, &ts);
+        }
+        pthread_mutex_unlock(&worker->lock);
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef ACTOR_H
+#define ACTOR_H
+
+#include "fsm.h"
+#include <deque>
+#include <pthread.h>
+#include <stdint.h>
+
+// 缓存行大小，用于隔离生产者/消费者写入的字段
+#define ACTOR_CACHE_LINE 64
+
+// 有界无锁MPSC邮箱
+// 基于Vyukov有界队列：多个生产者通过CAS抢占入队位置，
+// 唯一的消费者（当前持有该actor的worker）无需CAS即可出队。
+class Mailbox {
+public:
+    explicit Mailbox(size_t capacity);
+
+    // 多生产者入队，邮箱已满时返回false
+    bool push(const Event& event);
+
+    // 单消费者出队，邮箱为空时返回false
+    bool pop(Event& event);
+
+    bool empty() const;
+
+private:
+    struct Cell {
+        Cell() : seq(0), event(0) {}
+        size_t seq;
+        Event event;
+    };
+
+    std::vector<Cell> cells_;
+    size_t mask_;
+    char pad0_[ACTOR_CACHE_LINE];
+    size_t enqueuePos_;     // 生产者竞争写入
+    char pad1_[ACTOR_CACHE_LINE];
+    size_t dequeuePos_;     // 仅消费者写入
+};
+
+class ActorRuntime;
+
+// 一个状态机实例及其邮箱
+// scheduled标志保证同一时刻最多只有一个worker处理该actor，从而保证单个状态机的事件顺序
+struct Actor {
+    Actor(unsigned id, StateMachine* machine, size_t home, size_t mailboxCapacity)
+        : id(id), machine(machine), home(home), scheduled(0), mailbox(mailboxCapacity) {}
+
+    unsigned id;
+    StateMachine* machine;
+    size_t home;        // 通过哈希固定的worker
+    int scheduled;      // 是否已在某个worker的运行队列中或正在被处理
+    Mailbox mailbox;
+};
+
+// 多线程actor运行时
+// 每个状态机按id哈希固定到一个worker；生产者把事件投递到状态机的无锁邮箱，
+// 邮箱由空变为非空时actor进入所属worker的运行队列，worker每次最多批量处理batch个事件。
+// 空闲的worker会从其它worker的运行队列尾部窃取actor，以平衡负载。
+class ActorRuntime {
+public:
+    ActorRuntime(size_t workers, size_t mailboxCapacity = 1024, size_t batch = 64);
+    ~ActorRuntime();
+
+    // 注册状态机，返回actor id；必须在start()之前调用
+    unsigned addMachine(StateMachine* machine);
+
+    // 启动所有worker；创建线程失败时停止已启动的worker并返回false
+    bool start();
+
+    // 等待已投递的事件全部处理完后停止所有worker
+    void stop();
+
+    // 投递事件，邮箱已满时返回false
+    bool post(unsigned id, const Event& event);
+
+    // 投递事件，邮箱已满时让出CPU并重试
+    void send(unsigned id, const Event& event);
+
+    // 等待所有已投递的事件处理完成
+    void waitIdle();
+
+    size_t workerCount() const { return workers_.size(); }
+    size_t machineCount() const { return actors_.size(); }
+
+    // 被其它worker窃取并执行的actor批次数
+    uint64_t stolenCount() const;
+
+    // 当前线程正在处理的actor id，供动作函数识别所属状态机
+    static unsigned currentActorId();
+
+private:
+    struct Worker {
+        ActorRuntime* runtime;
+        size_t index;
+        pthread_t thread;
+        pthread_mutex_t lock;
+        pthread_cond_t cond;
+        std::deque<Actor*> runQueue;
+        uint64_t stolen;
+    };
+
+    static void* workerThread(void* arg);
+    void workerLoop(Worker* worker);
+    void schedule(Actor* actor);
+    void enqueue(Worker* worker, Actor* actor);
+    Actor* popLocal(Worker* worker);
+    Actor* steal(Worker* thief);
+    void run(Worker* worker, Actor* actor);
+    // 通知前num个worker退出并等待它们结束
+    void joinWorkers(size_t num);
+
+    std::vector<Worker*> workers_;
+    std::vector<Actor*> actors_;
+    size_t mailboxCapacity_;
+    size_t batch_;
+    bool started_;
+    volatile int stopping_;
+    long pending_;      // 已投递但尚未处理的事件数
+};
+
+#endif // ACTOR_H
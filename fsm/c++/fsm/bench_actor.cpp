@@ -0,0 +1,153 @@
+#include "actor.h"
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <time.h>
+
+// actor运行时吞吐量测试（随worker数变化）与多生产者下的单状态机顺序校验
+// 用法: cpp-fsm-actor-bench [每个生产者的事件数] [状态机数] [生产者数]
+
+enum ActorBenchEventType {
+    ACTOR_BENCH_PING = 0
+};
+
+// 事件负载：生产者编号及该生产者发给此状态机的序号
+struct OrderPayload {
+    uint32_t producer;
+    uint64_t seq;
+};
+
+static size_t g_producers = 0;
+static std::vector<uint64_t> g_lastSeq;     // [actor * producers + producer]
+static volatile unsigned long g_violations = 0;
+
+static void checkOrderAction(const Event& event) {
+    const OrderPayload& p = event.get<OrderPayload>();
+    uint64_t& last = g_lastSeq[ActorRuntime::currentActorId() * g_producers + p.producer];
+    // 同一个actor只会被一个worker串行处理，这里不需要同步
+    if (p.seq != last + 1) {
+        __atomic_add_fetch(&g_violations, 1, __ATOMIC_RELAXED);
+    }
+    last = p.seq;
+}
+
+struct ProducerArg {
+    ActorRuntime* runtime;
+    size_t index;
+    size_t events;
+    size_t machines;
+    std::vector<uint64_t>* nextSeq;     // 每个actor的下一个序号（仅本生产者使用）
+};
+
+static void* producerThread(void* param) {
+    ProducerArg* arg = (ProducerArg*)param;
+    unsigned seed = (unsigned)(arg->index * 7919 + 1);
+    for (size_t i = 0; i < arg->events; ++i) {
+        unsigned id = (unsigned)(rand_r(&seed) % arg->machines);
+        OrderPayload p;
+        p.producer = (uint32_t)arg->index;
+        p.seq = ++(*arg->nextSeq)[id];
+        arg->runtime->send(id, Event(ACTOR_BENCH_PING, p));
+    }
+    return NULL;
+}
+
+static double nowSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(size_t workers, size_t machines, size_t producers, size_t events) {
+    State ping("PING"), pong("PONG");
+    ping.addTransition<OrderPayload>(ACTOR_BENCH_PING, &pong, checkOrderAction);
+    pong.addTransition<OrderPayload>(ACTOR_BENCH_PING, &ping, checkOrderAction);
+
+    std::vector<StateMachine*> fsms;
+    ActorRuntime runtime(workers, 256, 64);
+    for (size_t i = 0; i < machines; ++i) {
+        fsms.push_back(new StateMachine(&ping));
+        runtime.addMachine(fsms.back());
+    }
+    g_producers = producers;
+    g_lastSeq.assign(machines * producers, 0);
+    if (!runtime.start()) {
+        for (size_t i = 0; i < fsms.size(); ++i) {
+            delete fsms[i];
+        }
+        return;
+    }
+
+    std::vector<pthread_t> threads(producers);
+    std::vector<ProducerArg> args(producers);
+    std::vector<std::vector<uint64_t> > seqs(producers, std::vector<uint64_t>(machines, 0));
+
+    double start = nowSec();
+    for (size_t p = 0; p < producers; ++p) {
+        args[p].runtime = &runtime;
+        args[p].index = p;
+        args[p].events = events;
+        args[p].machines = machines;
+        args[p].nextSeq = &seqs[p];
+        pthread_create(&threads[p], NULL, producerThread, &args[p]);
+    }
+    for (size_t p = 0; p < producers; ++p) {
+        pthread_join(threads[p], NULL);
+    }
+    runtime.waitIdle();
+    double elapsed = nowSec() - start;
+    runtime.stop();
+
+    // 校验每个(actor, 生产者)的事件都已按序处理完
+    unsigned long missing = 0;
+    for (size_t p = 0; p < producers; ++p) {
+        for (size_t m = 0; m < machines; ++m) {
+            if (g_lastSeq[m * producers + p] != seqs[p][m]) {
+                ++missing;
+            }
+        }
+    }
+
+    size_t total = producers * events;
+    printf("workers=%-3lu events=%-10lu %8.2f Mevents/s  stolen=%-8llu violations=%lu missing=%lu\n",
+           (unsigned long)workers, (unsigned long)total, total / elapsed / 1e6,
+           (unsigned long long)runtime.stolenCount(), (unsigned long)g_violations, missing);
+    if (missing) {
+        g_violations += missing;
+    }
+
+    for (size_t i = 0; i < fsms.size(); ++i) {
+        delete fsms[i];
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t events = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    size_t machines = argc > 2 ? strtoul(argv[2], NULL, 10) : 10000;
+    size_t producers = argc > 3 ? strtoul(argv[3], NULL, 10) : 4;
+    if (machines == 0) machines = 1;
+    if (producers == 0) producers = 1;
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+
+    printf("=== actor运行时吞吐量 (状态机=%lu, 生产者=%lu, CPU=%ld) ===\n",
+           (unsigned long)machines, (unsigned long)producers, cores);
+    for (size_t w = 1; ; w *= 2) {
+        run(w, machines, producers, events);
+        if ((long)w >= cores) {
+            break;
+        }
+    }
+
+    // 少量状态机 + 多生产者：制造邮箱竞争和窃取，校验顺序
+    printf("=== 竞争下的顺序校验 (状态机=4) ===\n");
+    run(cores > 1 ? (size_t)cores : 2, 4, producers, events);
+
+    if (g_violations) {
+        printf("顺序校验失败: %lu\n", (unsigned long)g_violations);
+        return 1;
+    }
+    printf("顺序校验通过\n");
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "fsm.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+
+// handleEvent延迟分布测试：同步执行动作 vs 延迟批量执行动作
+// 用法: cpp-fsm-bench [事件数] [批量大小]
+
+enum BenchEventType {
+    BENCH_NEXT = 0
+};
+
+static volatile unsigned long g_sink = 0;
+
+// 模拟日志类动作：格式化一行文本
+static void logAction(const Event& event) {
+    char line[128];
+    int n = snprintf(line, sizeof(line), "event=%d seq=%lu payload=%lu",
+                     event.getType(), (unsigned long)g_sink, event.get<unsigned long>());
+    g_sink += (unsigned long)n + (unsigned char)line[n / 2];
+}
+
+static bool alwaysGuard(const Event& event) {
+    return event.getType() == BENCH_NEXT;
+}
+
+static inline unsigned long long nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void report(const char* name, std::vector<unsigned long long>& samples,
+                   unsigned long long totalNs) {
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    printf("%-24s p50=%5lluns p90=%5lluns p99=%6lluns p999=%7lluns max=%8lluns  total=%.1fns/event\n",
+           name,
+           samples[n * 50 / 100], samples[n * 90 / 100],
+           samples[n * 99 / 100], samples[n * 999 / 1000],
+           samples[n - 1], (double)totalNs / n);
+}
+
+// batch为0表示同步执行动作
+static void run(const char* name, size_t events, size_t batch) {
+    State a("A"), b("B"), c("C");
+    a.addTransition<unsigned long>(BENCH_NEXT, &b, logAction, alwaysGuard);
+    b.addTransition<unsigned long>(BENCH_NEXT, &c, logAction, alwaysGuard);
+    c.addTransition<unsigned long>(BENCH_NEXT, &a, logAction, alwaysGuard);
+
+    StateMachine machine(&a);
+    ActionBuffer buffer(batch ? batch : 1);
+    if (batch) {
+        machine.setActionBuffer(&buffer);
+    }
+
+    std::vector<unsigned long long> samples;
+    samples.reserve(events);
+
+    unsigned long long start = nowNs();
+    for (size_t i = 0; i < events; ++i) {
+        Event event(BENCH_NEXT, (unsigned long)i);
+        unsigned long long t0 = nowNs();
+        machine.handleEvent(event);
+        unsigned long long t1 = nowNs();
+        samples.push_back(t1 - t0);
+        // 缓冲区将满时在分发循环外批量执行，模拟事件循环空闲时drain
+        if (batch && buffer.size() == buffer.capacity()) {
+            buffer.drain();
+        }
+    }
+    buffer.drain();
+    unsigned long long totalNs = nowNs() - start;
+
+    report(name, samples, totalNs);
+
+#ifdef FSM_TRACE
+    State* states[] = { &a, &b, &c };
+    traceDumpStates(std::cout, states, 3);
+#endif
+}
+
+int main(int argc, char* argv[]) {
+    size_t events = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    size_t batch = argc > 2 ? strtoul(argv[2], NULL, 10) : 256;
+    if (events == 0) {
+        events = 1;
+    }
+
+#ifdef FSM_TRACE
+    printf("=== handleEvent 延迟分布 (%lu 事件, 追踪开启) ===\n", (unsigned long)events);
+#else
+    printf("=== handleEvent 延迟分布 (%lu 事件) ===\n", (unsigned long)events);
+#endif
+    run("inline", events, 0);
+    char name[64];
+    snprintf(name, sizeof(name), "deferred(batch=%lu)", (unsigned long)batch);
+    run(name, events, batch);
+
+#ifdef FSM_TRACE
+    traceDump(std::cout, 3);
+#endif
+
+    return g_sink == 0;
+}
@@ -0,0 +1,88 @@
+#include "actor.h"
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+
+// 事件负载入队/分发测试：内联负载 vs 堆分配负载
+// 用法: cpp-fsm-payload-bench [事件数]
+
+enum PayloadBenchEventType {
+    PAYLOAD_BENCH_ORDER = 0
+};
+
+struct Order {
+    uint32_t itemId;
+    uint32_t quantity;
+    double price;
+};
+
+static volatile double g_total = 0;
+
+static void inlineOrderAction(const Event& event) {
+    const Order& order = event.get<Order>();
+    g_total += order.price * order.quantity;
+}
+
+static void heapOrderAction(const Event& event) {
+    Order* order = event.get<Order*>();
+    g_total += order->price * order->quantity;
+    delete order;
+}
+
+static double nowSec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 每批先入队batch个事件，再全部出队分发
+template<typename P>
+static void run(const char* name, size_t events, ActionFunc action, P (*make)(size_t)) {
+    const size_t batch = 1024;
+    State open("OPEN"), filled("FILLED");
+    open.addTransition<P>(PAYLOAD_BENCH_ORDER, &filled, action);
+    filled.addTransition<P>(PAYLOAD_BENCH_ORDER, &open, action);
+    StateMachine machine(&open);
+    Mailbox queue(batch);
+
+    Event event(0);
+    double start = nowSec();
+    for (size_t done = 0; done < events; ) {
+        size_t n = events - done < batch ? events - done : batch;
+        for (size_t i = 0; i < n; ++i) {
+            queue.push(Event(PAYLOAD_BENCH_ORDER, make(done + i)));
+        }
+        while (queue.pop(event)) {
+            machine.handleEvent(event);
+        }
+        done += n;
+    }
+    double elapsed = nowSec() - start;
+
+    printf("%-8s events=%-10lu %7.2f Mevents/s  %6.2f ns/event  sizeof(Event)=%lu\n",
+           name, (unsigned long)events, events / elapsed / 1e6, elapsed * 1e9 / events,
+           (unsigned long)sizeof(Event));
+}
+
+static Order makeInline(size_t i) {
+    Order order;
+    order.itemId = (uint32_t)i;
+    order.quantity = (uint32_t)(i & 7) + 1;
+    order.price = 1.5;
+    return order;
+}
+
+static Order* makeHeap(size_t i) {
+    Order* order = new Order(makeInline(i));
+    return order;
+}
+
+int main(int argc, char* argv[]) {
+    size_t events = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000000;
+
+    printf("=== 事件负载入队/分发 ===\n");
+    run<Order>("inline", events, inlineOrderAction, makeInline);
+    run<Order*>("heap", events, heapOrderAction, makeHeap);
+
+    return g_total == 0;
+}
@@ -2,14 +2,19 @@
 #include <algorithm>
 
 // State类实现
-void State::addTransition(int eventType, State* nextState, void (*action)(const Event&)) {
+void State::addTransition(int eventType, State* nextState, ActionFunc action, GuardFunc guard) {
+    addTransition(eventType, nextState, action, guard, NULL);
+}
+
+void State::addTransition(int eventType, State* nextState, ActionFunc action, GuardFunc guard,
+                          PayloadTypeId payloadType) {
     // 如果已存在该事件类型的转换，先删除旧的
     std::map<int, Transition*>::iterator it = transitions_.find(eventType);
     if (it != transitions_.end()) {
         delete it->second;
     }
     // 添加新的转换
-    transitions_[eventType] = new Transition(eventType, nextState, action);
+    transitions_[eventType] = new Transition(eventType, nextState, action, guard, payloadType);
 }
 
 Transition* State::getTransition(int eventType) {
@@ -20,9 +25,48 @@ Transition* State::getTransition(int eventType) {
     return NULL;
 }
 
+// ActionBuffer类实现
+ActionBuffer::ActionBuffer(size_t capacity)
+    : capacity_(capacity ? capacity : 1), draining_(false) {
+    items_.reserve(capacity_);
+    running_.reserve(capacity_);
+}
+
+void ActionBuffer::push(ActionFunc action, const Event& event) {
+    // drain期间动作再push时只追加，由外层drain接着执行
+    if (items_.size() >= capacity_ && !draining_) {
+        drain();
+    }
+    items_.push_back(Item(action, event));
+}
+
+size_t ActionBuffer::drain() {
+    if (draining_) {
+        return 0;
+    }
+    draining_ = true;
+    size_t n = 0;
+    // 先换到running_再执行：动作中push的新动作进入items_，不会被重复执行，
+    // 也不会在遍历时让正在执行的数组重新分配；两个数组交替使用，各自保留已分配的容量
+    while (!items_.empty()) {
+        running_.swap(items_);
+        for (size_t i = 0; i < running_.size(); ++i) {
+            running_[i].action(running_[i].event);
+        }
+        n += running_.size();
+        running_.clear();
+    }
+    draining_ = false;
+    return n;
+}
+
 // StateMachine类实现
 StateMachine::StateMachine(State* initialState) 
-    : currentState_(initialState), previousState_(NULL) {
+    : currentState_(initialState), previousState_(NULL), actionBuffer_(NULL)
+#ifdef FSM_TRACE
+    , enteredAt_(0)
+#endif
+{
     if (!currentState_) {
         goToErrorState();
     }
@@ -50,15 +94,39 @@ int StateMachine::handleEvent(const Event& event) {
         return STATE_NO_CHANGE;
     }
     
+    // 检查负载类型
+    if (transition->getPayloadType() && transition->getPayloadType() != event.getPayloadType()) {
+        return STATE_ERROR_ARG;
+    }
+    
+    // 检查守卫条件
+    if (transition->getGuard() && !transition->getGuard()(event)) {
+        return STATE_GUARD_REJECTED;
+    }
+    
     // 检查下一个状态
     if (!transition->getNextState()) {
         goToErrorState();
         return STATE_ERROR_REACHED;
     }
     
-    // 执行动作
+#ifdef FSM_TRACE
+    uint64_t now = traceNow();
+    transition->hit();
+    if (enteredAt_) {
+        currentState_->getDwellHistogram().record(now - enteredAt_);
+    }
+    enteredAt_ = now;
+    traceRecord(this, currentState_, transition->getNextState(), event.getType(), now);
+#endif
+    
+    // 执行动作：设置了缓冲区时只入队，由调用方批量执行
     if (transition->getAction()) {
-        transition->getAction()(event);
+        if (actionBuffer_) {
+            actionBuffer_->push(transition->getAction(), event);
+        } else {
+            transition->getAction()(event);
+        }
     }
     
     // 更新状态
@@ -81,6 +149,9 @@ int StateMachine::handleEvent(const Event& event) {
 void StateMachine::reset(State* state) {
     currentState_ = state;
     previousState_ = NULL;
+#ifdef FSM_TRACE
+    enteredAt_ = 0;
+#endif
 }
 
 bool StateMachine::canHandleEvent(int eventType) const {
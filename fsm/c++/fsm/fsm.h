@@ -5,27 +5,90 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <new>
+#include <cassert>
+
+#include "fsm_trace.h"
 
 // 前向声明
 class State;
 class Event;
 class Transition;
 class StateMachine;
+class ActionBuffer;
+
+// 事件负载内联存储的大小（字节）
+#define EVENT_PAYLOAD_SIZE 16
+
+// 负载类型标识：每个负载类型对应一个唯一的静态地址，NULL表示无负载
+typedef const void* PayloadTypeId;
+
+template<typename T>
+struct PayloadType {
+    static const char tag;
+    static PayloadTypeId id() { return &tag; }
+};
+
+template<typename T>
+const char PayloadType<T>::tag = 0;
 
 // 事件基类
+// 负载按值保存在事件内部的固定大小存储中，不做堆分配，
+// 事件可以安全地拷贝进队列、跨越调用方的栈帧。负载必须是POD类型。
 class Event {
 public:
-    Event(int type, void* data = NULL) : type_(type), data_(data) {}
+    explicit Event(int type) : type_(type), payloadType_(NULL) {}
+    
+    template<typename T>
+    Event(int type, const T& payload) : type_(type), payloadType_(PayloadType<T>::id()) {
+        // 编译期检查：负载必须能放进内联存储
+        typedef char payloadTooLarge[(sizeof(T) <= EVENT_PAYLOAD_SIZE) ? 1 : -1]
+            __attribute__((unused));
+        new (storage_.bytes) T(payload);
+    }
+    
     virtual ~Event() {}
     
     int getType() const { return type_; }
-    void* getData() const { return data_; }
+    
+    bool hasPayload() const { return payloadType_ != NULL; }
+    PayloadTypeId getPayloadType() const { return payloadType_; }
+    
+    template<typename T>
+    bool holds() const { return payloadType_ == PayloadType<T>::id(); }
+    
+    // 负载类型不匹配时返回NULL
+    template<typename T>
+    const T* getIf() const {
+        return holds<T>() ? reinterpret_cast<const T*>(storage_.bytes) : NULL;
+    }
+    
+    // 调用方需确保类型匹配（已通过带类型的addTransition注册时由状态机检查）
+    template<typename T>
+    const T& get() const {
+        assert(holds<T>());
+        return *reinterpret_cast<const T*>(storage_.bytes);
+    }
     
 private:
+    union Storage {
+        char bytes[EVENT_PAYLOAD_SIZE];
+        double alignDouble;
+        long long alignLong;
+        void* alignPtr;
+    };
+    
     int type_;
-    void* data_;    //这个data数据是干啥的？
+    PayloadTypeId payloadType_;
+    Storage storage_;
 };
 
+// 动作函数：转换发生时执行
+typedef void (*ActionFunc)(const Event&);
+
+// 守卫函数：返回false时拒绝本次转换，状态保持不变
+typedef bool (*GuardFunc)(const Event&);
+
 // 状态基类
 class State {
 public:
@@ -34,8 +97,16 @@ public:
     
     const std::string& getName() const { return name_; }
     
-    // 添加转换
-    void addTransition(int eventType, State* nextState, void (*action)(const Event&) = NULL);
+    // 添加转换（guard为空表示无条件转换）
+    void addTransition(int eventType, State* nextState, ActionFunc action = NULL,
+                       GuardFunc guard = NULL);
+    
+    // 添加带负载类型的转换：事件负载类型与T不一致时，handleEvent返回STATE_ERROR_ARG
+    template<typename T>
+    void addTransition(int eventType, State* nextState, ActionFunc action = NULL,
+                       GuardFunc guard = NULL) {
+        addTransition(eventType, nextState, action, guard, PayloadType<T>::id());
+    }
     
     // 获取转换
     Transition* getTransition(int eventType);
@@ -43,25 +114,90 @@ public:
     // 获取所有可能的转换
     std::map<int, Transition*>& getTransitions() { return transitions_; }
     
+#ifdef FSM_TRACE
+    // 在该状态的停留时间直方图
+    DwellHistogram& getDwellHistogram() { return dwell_; }
+#endif
+    
 private:
+    void addTransition(int eventType, State* nextState, ActionFunc action,
+                       GuardFunc guard, PayloadTypeId payloadType);
+    
     std::string name_;
     std::map<int, Transition*> transitions_;
+#ifdef FSM_TRACE
+    DwellHistogram dwell_;
+#endif
 };
 
 // 转换类
 class Transition {
 public:
-    Transition(int eventType, State* nextState, void (*action)(const Event&) = NULL)
-        : eventType_(eventType), nextState_(nextState), action_(action) {}
+    Transition(int eventType, State* nextState, ActionFunc action = NULL, GuardFunc guard = NULL,
+               PayloadTypeId payloadType = NULL)
+        : eventType_(eventType), nextState_(nextState), action_(action), guard_(guard),
+          payloadType_(payloadType)
+#ifdef FSM_TRACE
+          , hits_(0)
+#endif
+    {}
     
     int getEventType() const { return eventType_; }
     State* getNextState() const { return nextState_; }
-    void (*getAction() const)(const Event&) { return action_; }
+    ActionFunc getAction() const { return action_; }
+    GuardFunc getGuard() const { return guard_; }
+    
+    // 期望的事件负载类型，NULL表示不检查
+    PayloadTypeId getPayloadType() const { return payloadType_; }
+    
+#ifdef FSM_TRACE
+    // 转换命中次数
+    void hit() { __atomic_add_fetch(&hits_, 1, __ATOMIC_RELAXED); }
+    uint64_t getHits() const { return __atomic_load_n(&hits_, __ATOMIC_RELAXED); }
+#endif
     
 private:
     int eventType_;
     State* nextState_;
-    void (*action_)(const Event&);
+    ActionFunc action_;
+    GuardFunc guard_;
+    PayloadTypeId payloadType_;
+#ifdef FSM_TRACE
+    uint64_t hits_;
+#endif
+};
+
+// 延迟动作缓冲区
+// 状态机只把动作和事件副本入队，状态推进留在分发热路径上，
+// 日志、I/O等耗时动作由调用方在合适的时机通过drain()批量执行。
+// 同一线程上的多个状态机可以共享一个缓冲区（每线程一个），
+// 缓冲区本身不加锁，只能由所属线程push和drain。
+// 事件连同内联负载按值拷贝入队，drain时不依赖调用方的栈帧。
+class ActionBuffer {
+public:
+    explicit ActionBuffer(size_t capacity = 1024);
+    
+    // 动作入队；缓冲区已满时先就地drain一次，保证动作顺序和内存上限
+    void push(ActionFunc action, const Event& event);
+    
+    // 按入队顺序批量执行所有动作（包括执行期间新入队的），返回执行的数量；动作中调用drain()为空操作
+    size_t drain();
+    
+    size_t size() const { return items_.size(); }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return items_.empty(); }
+    
+private:
+    struct Item {
+        Item(ActionFunc a, const Event& e) : action(a), event(e) {}
+        ActionFunc action;
+        Event event;
+    };
+    
+    size_t capacity_;
+    bool draining_;                 // drain()执行动作期间为true
+    std::vector<Item> items_;
+    std::vector<Item> running_;     // drain()正在执行的一批
 };
 
 // 状态机类
@@ -88,6 +224,10 @@ public:
     // 获取当前状态下可用的事件
     std::vector<int> getAvailableEvents() const;
     
+    // 设置延迟动作缓冲区，NULL表示在handleEvent中同步执行动作
+    void setActionBuffer(ActionBuffer* buffer) { actionBuffer_ = buffer; }
+    ActionBuffer* getActionBuffer() const { return actionBuffer_; }
+    
     // 状态机状态
     enum StateMachineResult {
         STATE_ERROR_ARG = -2,
@@ -95,7 +235,8 @@ public:
         STATE_CHANGED,
         STATE_LOOP_SELF,
         STATE_NO_CHANGE,
-        STATE_FINAL_REACHED
+        STATE_FINAL_REACHED,
+        STATE_GUARD_REJECTED    // 守卫条件不满足，状态未改变
     };
     
 private:
@@ -103,6 +244,10 @@ private:
     
     State* currentState_;
     State* previousState_;
+    ActionBuffer* actionBuffer_;
+#ifdef FSM_TRACE
+    uint64_t enteredAt_;    // 进入当前状态的时间戳
+#endif
 };
 
 #endif // FSM_H
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "fsm.h"
+
+#ifdef FSM_TRACE
+
+#include <cstring>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace {
+
+// 每线程环形缓冲区：只有所属线程写入，dump时由其它线程无锁读取
+struct TraceRing {
+    uint64_t head;                      // 已写入的记录总数
+    long tid;
+    TraceRing* next;                    // 全局链表，用于dump时遍历所有线程
+    TraceRecord records[FSM_TRACE_RING_SIZE];
+};
+
+TraceRing* ringList = NULL;
+__thread TraceRing* localRing = NULL;
+
+TraceRing* getLocalRing() {
+    TraceRing* ring = localRing;
+    if (ring) {
+        return ring;
+    }
+
+    ring = new TraceRing;
+    std::memset(ring, 0, sizeof(*ring));
+    ring->tid = (long)syscall(SYS_gettid);
+
+    // 无锁插入全局链表头，环形缓冲区在进程生命周期内不释放
+    ring->next = __atomic_load_n(&ringList, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&ringList, &ring->next, ring, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+
+    localRing = ring;
+    return ring;
+}
+
+const char* stateName(const State* s) {
+    return s ? s->getName().c_str() : "(error)";
+}
+
+} // namespace
+
+void DwellHistogram::record(uint64_t ticks) {
+    int b = ticks ? 63 - __builtin_clzll(ticks) : 0;
+    if (b >= FSM_TRACE_DWELL_BUCKETS) {
+        b = FSM_TRACE_DWELL_BUCKETS - 1;
+    }
+    __atomic_add_fetch(&count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&buckets[b], 1, __ATOMIC_RELAXED);
+}
+
+void traceRecord(const StateMachine* machine, const State* from, const State* to,
+                 int event, uint64_t ts) {
+    TraceRing* ring = getLocalRing();
+    uint64_t head = ring->head;
+    TraceRecord& r = ring->records[head & (FSM_TRACE_RING_SIZE - 1)];
+    r.ts = ts;
+    r.machine = machine;
+    r.from = from;
+    r.to = to;
+    r.event = event;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void traceDump(std::ostream& os, size_t maxPerThread) {
+    std::vector<TraceRecord> copy(FSM_TRACE_RING_SIZE);
+
+    for (TraceRing* ring = __atomic_load_n(&ringList, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        uint64_t end = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t n = end < FSM_TRACE_RING_SIZE ? end : FSM_TRACE_RING_SIZE;
+        if (maxPerThread && n > maxPerThread) {
+            n = maxPerThread;
+        }
+        std::memcpy(&copy[0], ring->records, sizeof(ring->records));
+
+        // 复制期间写线程可能覆盖了最旧的记录，这些记录直接丢弃；写线程先写第after条再推进head，
+        // 第after条所在的槽（即第after - RING_SIZE条）可能正写到一半，也一并丢弃
+        uint64_t after = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t start = end - n;
+        if (after >= FSM_TRACE_RING_SIZE && after - FSM_TRACE_RING_SIZE + 1 > start) {
+            start = after - FSM_TRACE_RING_SIZE + 1;
+        }
+
+        os << "thread " << ring->tid << ": " << end << " transitions" << std::endl;
+        for (uint64_t i = start; i < end; ++i) {
+            const TraceRecord& r = copy[i & (FSM_TRACE_RING_SIZE - 1)];
+            os << "  " << r.ts << " fsm=" << r.machine << " " << stateName(r.from)
+               << " -> " << stateName(r.to) << " event=" << r.event << std::endl;
+        }
+    }
+}
+
+void traceDumpStates(std::ostream& os, State* const* states, size_t num) {
+    for (size_t i = 0; i < num; ++i) {
+        State* s = states[i];
+        const DwellHistogram& dwell = s->getDwellHistogram();
+        os << "state " << s->getName() << ": dwell samples="
+           << __atomic_load_n(&dwell.count, __ATOMIC_RELAXED) << std::endl;
+
+        const std::map<int, Transition*>& transitions = s->getTransitions();
+        for (std::map<int, Transition*>::const_iterator it = transitions.begin();
+             it != transitions.end(); ++it) {
+            os << "  event " << it->first << " -> " << stateName(it->second->getNextState())
+               << ": hits=" << it->second->getHits() << std::endl;
+        }
+        for (int b = 0; b < FSM_TRACE_DWELL_BUCKETS; ++b) {
+            uint64_t c = __atomic_load_n(&dwell.buckets[b], __ATOMIC_RELAXED);
+            if (c) {
+                os << "  dwell [2^" << b << ", 2^" << b + 1 << ") ticks: " << c << std::endl;
+            }
+        }
+    }
+}
+
+#endif // FSM_TRACE
@@ -0,0 +1,73 @@
+#ifndef FSM_TRACE_H
+#define FSM_TRACE_H
+
+// 状态机执行追踪
+// 定义FSM_TRACE时启用：每个线程一个无锁环形缓冲区记录状态转换，
+// 同时统计每个转换的命中次数和每个状态的停留时间直方图。
+// 未定义时所有追踪代码都被编译掉，不产生任何开销。
+
+#include <stdint.h>
+#include <ostream>
+
+#ifdef FSM_TRACE
+
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// 每线程环形缓冲区的记录数（2的幂）
+#define FSM_TRACE_RING_SIZE 4096
+
+// 停留时间直方图的桶数：第i个桶统计[2^i, 2^(i+1))个时钟周期
+#define FSM_TRACE_DWELL_BUCKETS 48
+
+class State;
+class StateMachine;
+
+struct TraceRecord {
+    uint64_t ts;                // 时间戳（traceNow的时钟周期）
+    const StateMachine* machine;
+    const State* from;
+    const State* to;
+    int event;
+};
+
+// 停留时间直方图（计数使用relaxed原子操作，可被多个线程同时更新）
+struct DwellHistogram {
+    DwellHistogram() : count(0) {
+        for (int i = 0; i < FSM_TRACE_DWELL_BUCKETS; ++i) {
+            buckets[i] = 0;
+        }
+    }
+
+    void record(uint64_t ticks);
+
+    uint64_t count;
+    uint64_t buckets[FSM_TRACE_DWELL_BUCKETS];
+};
+
+// 读取时间戳：x86上使用rdtsc，其它平台使用clock_gettime（vDSO）
+inline uint64_t traceNow() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// 记录一次状态转换（写入当前线程的环形缓冲区）
+void traceRecord(const StateMachine* machine, const State* from, const State* to,
+                 int event, uint64_t ts);
+
+// 输出所有线程最近的追踪记录，maxPerThread为0表示输出缓冲区中的全部记录
+void traceDump(std::ostream& os, size_t maxPerThread = 0);
+
+// 输出给定状态的转换命中次数和停留时间直方图
+void traceDumpStates(std::ostream& os, State* const* states, size_t num);
+
+#endif // FSM_TRACE
+
+#endif // FSM_TRACE_H
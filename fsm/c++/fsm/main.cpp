@@ -24,14 +24,18 @@ void selectItemAction(const Event& event) {
 }
 
 void insertCoinAction(const Event& event) {
-    if (event.getData()) {
-        double coinAmount = *(static_cast<double*>(event.getData()));
-        std::cout << "💰 投币 " << coinAmount << " 元" << std::endl;
+    if (const double* coinAmount = event.getIf<double>()) {
+        std::cout << "💰 投币 " << *coinAmount << " 元" << std::endl;
     } else {
         std::cout << "💰 投币成功" << std::endl;
     }
 }
 
+// 守卫函数：投币金额必须为正
+bool validCoinGuard(const Event& event) {
+    return event.get<double>() > 0;
+}
+
 void deliverItemAction(const Event& event) {
     std::cout << "📦 正在出货，请稍候..." << std::endl;
     std::cout << "✅ 商品已出货，交易完成！" << std::endl;
@@ -59,7 +63,7 @@ int main() {
     
     // 配置状态转换
     idleState.addTransition(VENDING_SELECT_ITEM, &itemSelectedState, selectItemAction);
-    itemSelectedState.addTransition(VENDING_INSERT_COIN, &coinInsertedState, insertCoinAction);
+    itemSelectedState.addTransition<double>(VENDING_INSERT_COIN, &coinInsertedState, insertCoinAction, validCoinGuard);
     coinInsertedState.addTransition(VENDING_DELIVER, &dispensingState, deliverItemAction);
     dispensingState.addTransition(VENDING_RESET, &idleState, resetAction);
     
@@ -94,7 +98,7 @@ int main() {
             case '2': {
                 // 投币
                 double coinAmount = 1.0; // 默认投币金额
-                Event event(VENDING_INSERT_COIN, &coinAmount);
+                Event event(VENDING_INSERT_COIN, coinAmount);
                 result = vendingMachine.handleEvent(event);
                 break;
             }
@@ -136,6 +140,12 @@ int main() {
             case StateMachine::STATE_FINAL_REACHED:
                 std::cout << "🏁 到达最终状态" << std::endl;
                 break;
+            case StateMachine::STATE_ERROR_ARG:
+                std::cout << "❌ 事件负载类型错误" << std::endl;
+                break;
+            case StateMachine::STATE_GUARD_REJECTED:
+                std::cout << "🚫 守卫条件不满足" << std::endl;
+                break;
             default:
                 std::cout << "❓ 未知结果: " << result << std::endl;
         }
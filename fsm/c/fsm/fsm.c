@@ -8,6 +8,9 @@ void FSM_init(struct StateMachine *fsm, struct state* initState)
 
    fsm->curState = initState;
    fsm->prevState = NULL;
+#ifdef FSM_TRACE
+   fsm->enteredAt = 0;
+#endif
 }
 
 static void goToErrorState( struct StateMachine *fsm,
@@ -76,7 +79,11 @@ int FSM_handleEvent(struct StateMachine* fsm, struct event* event)
         //成功获取transition的下一个状态
         nextState = transition->nextState;
 
+#ifdef FSM_VERBOSE
         printf("状态转换: %s -> %s\n", fsm->curState->name, nextState->name);
+#endif
+
+        FSM_TRACE_TRANSITION( fsm, transition, fsm->curState, nextState, event->type );
 
         // 执行动作（如果存在）
         if (transition->action) {
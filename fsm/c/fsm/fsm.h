@@ -3,6 +3,12 @@
 
 #include <stdio.h>
 
+#include "fsm_trace.h"
+
+#ifndef unlikely
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#endif
+
 struct event {
     //事件类型
     int type;
@@ -23,6 +29,10 @@ struct transition{
     
     // 动作函数指针（可选）
     void (*action)(struct event* event);
+
+#ifdef FSM_TRACE
+    uint64_t hits; // 转换命中次数
+#endif
 };
 
 //状态
@@ -32,11 +42,19 @@ struct state {
     
     struct transition* transitions; //状态转换数组
     int numTransitions;//状态转换数组大小
+
+#ifdef FSM_TRACE
+    struct fsm_dwell_hist dwell; // 在该状态的停留时间直方图
+#endif
 };
 
 struct StateMachine {
     struct state* curState; //当前状态
     struct state* prevState;//之前状态
+
+#ifdef FSM_TRACE
+    uint64_t enteredAt; // 进入当前状态的时间戳
+#endif
 };
 
 enum stateM_handleEventRetVals
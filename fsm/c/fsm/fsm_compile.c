@@ -0,0 +1,59 @@
+#include <stdlib.h>
+#include <string.h>
+#include "fsm_table.h"
+
+// 状态机定义编译工具：将文本定义校验后编译成可直接mmap的二进制表
+// 用法: c-fsm-compile <定义文件> <输出文件> [--allow-unreachable]
+// 编译时不检查动作注册表，动作在加载时按名称绑定
+
+int main(int argc, char *argv[])
+{
+    char err[256];
+    void *blob;
+    size_t size;
+    unsigned flags = 0;
+
+    if (argc < 3) {
+        fprintf(stderr, "用法: %s <定义文件> <输出文件> [--allow-unreachable]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 3 && strcmp(argv[3], "--allow-unreachable") == 0) {
+        flags |= FSM_TABLE_ALLOW_UNREACHABLE;
+    }
+
+    FILE *fp = fopen(argv[1], "rb");
+    if (!fp) {
+        fprintf(stderr, "无法打开%s\n", argv[1]);
+        return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *text = malloc(len > 0 ? len : 1);
+    if (!text || fread(text, 1, len, fp) != (size_t)len) {
+        fprintf(stderr, "读取%s失败\n", argv[1]);
+        fclose(fp);
+        free(text);
+        return 1;
+    }
+    fclose(fp);
+
+    if (fsm_table_compile(text, len, NULL, flags, &blob, &size, err, sizeof(err)) < 0) {
+        fprintf(stderr, "%s: %s\n", argv[1], err);
+        free(text);
+        return 1;
+    }
+    free(text);
+
+    if (fsm_table_write(argv[2], blob, size) < 0) {
+        fprintf(stderr, "写入%s失败\n", argv[2]);
+        free(blob);
+        return 1;
+    }
+
+    const struct fsm_table_header *hdr = blob;
+    printf("%s: %u 个状态, %u 个事件, %u 个动作, %lu 字节\n", argv[2],
+           hdr->num_states, hdr->num_events, hdr->num_actions, (unsigned long)size);
+    free(blob);
+    return 0;
+}
@@ -0,0 +1,604 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fsm_table.h"
+
+#define FSM_TABLE_MAX_LINE 1024
+
+// 名称集合：按插入顺序编号，开放寻址哈希表加速查找
+struct name_set {
+    char** names;
+    uint32_t count;
+    uint32_t cap;
+    uint32_t* slots;        // 保存编号+1，0表示空槽
+    uint32_t nslots;
+};
+
+struct parsed_trans {
+    uint32_t from;
+    uint32_t event;
+    uint32_t to;
+    uint32_t action;
+    int line;
+};
+
+static void set_error(char* err, size_t errlen, const char* fmt, ...)
+{
+    va_list ap;
+
+    if (!err || !errlen) {
+        return;
+    }
+    va_start(ap, fmt);
+    vsnprintf(err, errlen, fmt, ap);
+    va_end(ap);
+}
+
+static uint32_t name_hash(const char* s)
+{
+    uint32_t h = 2166136261u;   // FNV-1a
+
+    while (*s) {
+        h = (h ^ (uint8_t)*s++) * 16777619u;
+    }
+    return h;
+}
+
+static uint32_t name_find(const struct name_set* ns, const char* name)
+{
+    uint32_t i;
+
+    if (!ns->nslots) {
+        return FSM_TABLE_NONE;
+    }
+    for (i = name_hash(name) & (ns->nslots - 1); ns->slots[i]; i = (i + 1) & (ns->nslots - 1)) {
+        if (strcmp(ns->names[ns->slots[i] - 1], name) == 0) {
+            return ns->slots[i] - 1;
+        }
+    }
+    return FSM_TABLE_NONE;
+}
+
+static int name_rehash(struct name_set* ns, uint32_t nslots)
+{
+    uint32_t i, j;
+    uint32_t* slots = calloc(nslots, sizeof(*slots));
+
+    if (!slots) {
+        return -1;
+    }
+    for (i = 0; i < ns->count; i++) {
+        for (j = name_hash(ns->names[i]) & (nslots - 1); slots[j]; j = (j + 1) & (nslots - 1))
+            ;
+        slots[j] = i + 1;
+    }
+    free(ns->slots);
+    ns->slots = slots;
+    ns->nslots = nslots;
+    return 0;
+}
+
+// 添加名称，返回编号；名称已存在时返回已有编号并置*exists
+static uint32_t name_add(struct name_set* ns, const char* name, int* exists)
+{
+    uint32_t idx = name_find(ns, name);
+
+    *exists = idx != FSM_TABLE_NONE;
+    if (*exists) {
+        return idx;
+    }
+
+    if (ns->count == ns->cap) {
+        uint32_t cap = ns->cap ? ns->cap * 2 : 16;
+        char** names = realloc(ns->names, cap * sizeof(*names));
+        if (!names) {
+            return FSM_TABLE_NONE;
+        }
+        ns->names = names;
+        ns->cap = cap;
+    }
+    // 负载因子不超过1/2
+    if ((ns->count + 1) * 2 > ns->nslots && name_rehash(ns, ns->nslots ? ns->nslots * 2 : 32) < 0) {
+        return FSM_TABLE_NONE;
+    }
+
+    if (!(ns->names[ns->count] = strdup(name))) {
+        return FSM_TABLE_NONE;
+    }
+    idx = ns->count++;
+    uint32_t i;
+    for (i = name_hash(name) & (ns->nslots - 1); ns->slots[i]; i = (i + 1) & (ns->nslots - 1))
+        ;
+    ns->slots[i] = idx + 1;
+    return idx;
+}
+
+static void name_free(struct name_set* ns)
+{
+    uint32_t i;
+
+    for (i = 0; i < ns->count; i++) {
+        free(ns->names[i]);
+    }
+    free(ns->names);
+    free(ns->slots);
+}
+
+static int registry_has(const struct fsm_action_entry* registry, const char* name)
+{
+    for (; registry->name; registry++) {
+        if (strcmp(registry->name, name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 从初始状态出发做广度优先搜索，返回第一个不可达的状态，全部可达返回FSM_TABLE_NONE
+static uint32_t find_unreachable(const struct fsm_table_cell* cells, uint32_t num_states,
+                                 uint32_t num_events, uint32_t initial)
+{
+    uint32_t* queue = malloc(num_states * sizeof(*queue));
+    uint8_t* seen = calloc(num_states, 1);
+    uint32_t head = 0, tail = 0, i, e, ret = FSM_TABLE_NONE;
+
+    if (!queue || !seen) {
+        free(queue);
+        free(seen);
+        return FSM_TABLE_NONE;
+    }
+
+    seen[initial] = 1;
+    queue[tail++] = initial;
+    while (head < tail) {
+        uint32_t s = queue[head++];
+        for (e = 0; e < num_events; e++) {
+            uint32_t next = cells[(size_t)s * num_events + e].next;
+            if (next != FSM_TABLE_NONE && !seen[next]) {
+                seen[next] = 1;
+                queue[tail++] = next;
+            }
+        }
+    }
+    for (i = 0; i < num_states; i++) {
+        if (!seen[i]) {
+            ret = i;
+            break;
+        }
+    }
+
+    free(queue);
+    free(seen);
+    return ret;
+}
+
+#define ALIGN4(x) (((x) + 3u) & ~3u)
+
+int fsm_table_compile(const char* text, size_t len, const struct fsm_action_entry* registry,
+                      unsigned flags, void** out, size_t* out_size, char* err, size_t errlen)
+{
+    struct name_set states = { 0 }, events = { 0 }, actions = { 0 };
+    struct parsed_trans* trans = NULL;
+    struct fsm_table_cell* cells = NULL;
+    uint32_t num_trans = 0, cap_trans = 0, initial = FSM_TABLE_NONE, i;
+    const char* p = text;
+    const char* end = text + len;
+    char line[FSM_TABLE_MAX_LINE];
+    int lineno = 0, exists, ret = -1;
+    uint8_t* blob = NULL;
+
+    *out = NULL;
+    *out_size = 0;
+
+    // 第一遍：逐行解析指令
+    while (p < end) {
+        const char* eol = memchr(p, '\n', end - p);
+        size_t n = (eol ? eol : end) - p;
+        char *save, *cmd, *a[4];
+        int argc = 0;
+
+        lineno++;
+        if (n >= sizeof(line)) {
+            set_error(err, errlen, "第%d行: 行太长", lineno);
+            goto out;
+        }
+        memcpy(line, p, n);
+        line[n] = '\0';
+        p = eol ? eol + 1 : end;
+
+        char* hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        if (!(cmd = strtok_r(line, " \t\r", &save))) {
+            continue;
+        }
+        while (argc < 4 && (a[argc] = strtok_r(NULL, " \t\r", &save))) {
+            argc++;
+        }
+        if (strtok_r(NULL, " \t\r", &save)) {
+            set_error(err, errlen, "第%d行: 参数过多", lineno);
+            goto out;
+        }
+
+        if (strcmp(cmd, "state") == 0 && argc == 1) {
+            if (name_add(&states, a[0], &exists) == FSM_TABLE_NONE) {
+                goto oom;
+            }
+            if (exists) {
+                set_error(err, errlen, "第%d行: 状态%s重复声明", lineno, a[0]);
+                goto out;
+            }
+        } else if (strcmp(cmd, "event") == 0 && argc == 1) {
+            if (name_add(&events, a[0], &exists) == FSM_TABLE_NONE) {
+                goto oom;
+            }
+            if (exists) {
+                set_error(err, errlen, "第%d行: 事件%s重复声明", lineno, a[0]);
+                goto out;
+            }
+        } else if (strcmp(cmd, "initial") == 0 && argc == 1) {
+            if ((initial = name_find(&states, a[0])) == FSM_TABLE_NONE) {
+                set_error(err, errlen, "第%d行: 未声明的状态%s", lineno, a[0]);
+                goto out;
+            }
+        } else if (strcmp(cmd, "trans") == 0 && (argc == 3 || argc == 4)) {
+            struct parsed_trans t;
+            t.line = lineno;
+            t.from = name_find(&states, a[0]);
+            t.event = name_find(&events, a[1]);
+            t.to = name_find(&states, a[2]);
+            t.action = FSM_TABLE_NONE;
+            if (t.from == FSM_TABLE_NONE || t.to == FSM_TABLE_NONE) {
+                set_error(err, errlen, "第%d行: 未声明的状态%s", lineno,
+                          t.from == FSM_TABLE_NONE ? a[0] : a[2]);
+                goto out;
+            }
+            if (t.event == FSM_TABLE_NONE) {
+                set_error(err, errlen, "第%d行: 未声明的事件%s", lineno, a[1]);
+                goto out;
+            }
+            if (argc == 4) {
+                if (registry && !registry_has(registry, a[3])) {
+                    set_error(err, errlen, "第%d行: 未注册的动作%s", lineno, a[3]);
+                    goto out;
+                }
+                if ((t.action = name_add(&actions, a[3], &exists)) == FSM_TABLE_NONE) {
+                    goto oom;
+                }
+            }
+            if (num_trans == cap_trans) {
+                uint32_t cap = cap_trans ? cap_trans * 2 : 64;
+                struct parsed_trans* tmp = realloc(trans, cap * sizeof(*tmp));
+                if (!tmp) {
+                    goto oom;
+                }
+                trans = tmp;
+                cap_trans = cap;
+            }
+            trans[num_trans++] = t;
+        } else {
+            set_error(err, errlen, "第%d行: 无法识别的指令%s", lineno, cmd);
+            goto out;
+        }
+    }
+
+    if (!states.count || !events.count) {
+        set_error(err, errlen, "至少需要声明一个状态和一个事件");
+        goto out;
+    }
+    if (initial == FSM_TABLE_NONE) {
+        initial = 0;
+    }
+
+    // 第二遍：填充稠密转换表，同一(状态,事件)出现不同的转换即为非确定性
+    size_t ncells = (size_t)states.count * events.count;
+    if (!(cells = malloc(ncells * sizeof(*cells)))) {
+        goto oom;
+    }
+    memset(cells, 0xff, ncells * sizeof(*cells));
+
+    uint32_t* ntrans = calloc(states.count, sizeof(*ntrans));
+    if (!ntrans) {
+        goto oom;
+    }
+    for (i = 0; i < num_trans; i++) {
+        struct parsed_trans* t = &trans[i];
+        struct fsm_table_cell* c = &cells[(size_t)t->from * events.count + t->event];
+        if (c->next != FSM_TABLE_NONE) {
+            if (c->next != t->to || c->action != t->action) {
+                set_error(err, errlen, "第%d行: 非确定性转换 %s --%s-->", t->line,
+                          states.names[t->from], events.names[t->event]);
+                free(ntrans);
+                goto out;
+            }
+            continue;
+        }
+        c->next = t->to;
+        c->action = t->action;
+        ntrans[t->from]++;
+    }
+
+    if (!(flags & FSM_TABLE_ALLOW_UNREACHABLE)) {
+        uint32_t s = find_unreachable(cells, states.count, events.count, initial);
+        if (s != FSM_TABLE_NONE) {
+            set_error(err, errlen, "状态%s从初始状态%s不可达", states.names[s], states.names[initial]);
+            free(ntrans);
+            goto out;
+        }
+    }
+
+    // 输出布局：表头 | 转换表 | 转换数量 | 名称偏移 | 字符串表
+    uint32_t num_names = states.count + events.count + actions.count;
+    uint32_t strtab_size = 0;
+    for (i = 0; i < states.count; i++) strtab_size += strlen(states.names[i]) + 1;
+    for (i = 0; i < events.count; i++) strtab_size += strlen(events.names[i]) + 1;
+    for (i = 0; i < actions.count; i++) strtab_size += strlen(actions.names[i]) + 1;
+
+    struct fsm_table_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = FSM_TABLE_MAGIC;
+    hdr.version = FSM_TABLE_VERSION;
+    hdr.num_states = states.count;
+    hdr.num_events = events.count;
+    hdr.num_actions = actions.count;
+    hdr.initial = initial;
+    hdr.cells_off = ALIGN4(sizeof(hdr));
+    hdr.ntrans_off = hdr.cells_off + ncells * sizeof(*cells);
+    hdr.names_off = hdr.ntrans_off + states.count * sizeof(uint32_t);
+    hdr.strtab_off = hdr.names_off + num_names * sizeof(uint32_t);
+    hdr.strtab_size = strtab_size;
+    hdr.total_size = ALIGN4(hdr.strtab_off + strtab_size);
+
+    if (!(blob = calloc(1, hdr.total_size))) {
+        free(ntrans);
+        goto oom;
+    }
+    memcpy(blob, &hdr, sizeof(hdr));
+    memcpy(blob + hdr.cells_off, cells, ncells * sizeof(*cells));
+    memcpy(blob + hdr.ntrans_off, ntrans, states.count * sizeof(uint32_t));
+    free(ntrans);
+
+    uint32_t* names = (uint32_t*)(blob + hdr.names_off);
+    char* strtab = (char*)(blob + hdr.strtab_off);
+    uint32_t off = 0, k = 0;
+    struct name_set* sets[3] = { &states, &events, &actions };
+    int si;
+    for (si = 0; si < 3; si++) {
+        for (i = 0; i < sets[si]->count; i++) {
+            size_t l = strlen(sets[si]->names[i]) + 1;
+            names[k++] = off;
+            memcpy(strtab + off, sets[si]->names[i], l);
+            off += l;
+        }
+    }
+
+    *out = blob;
+    *out_size = hdr.total_size;
+    ret = 0;
+    goto out;
+
+oom:
+    set_error(err, errlen, "内存不足");
+out:
+    free(cells);
+    free(trans);
+    name_free(&states);
+    name_free(&events);
+    name_free(&actions);
+    return ret;
+}
+
+int fsm_table_write(const char* path, const void* blob, size_t size)
+{
+    FILE* fp = fopen(path, "wb");
+    int ret = 0;
+
+    if (!fp) {
+        return -1;
+    }
+    if (fwrite(blob, 1, size, fp) != size) {
+        ret = -1;
+    }
+    if (fclose(fp) != 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+int fsm_table_open(struct fsm_table* table, const void* blob, size_t size,
+                   const struct fsm_action_entry* registry, char* err, size_t errlen)
+{
+    const struct fsm_table_header* hdr = blob;
+    const uint8_t* base = blob;
+    uint32_t i;
+
+    memset(table, 0, sizeof(*table));
+
+    // 只做O(1)的边界检查，不遍历转换表
+    if (size < sizeof(*hdr) || hdr->magic != FSM_TABLE_MAGIC) {
+        set_error(err, errlen, "不是有效的状态机表");
+        return -1;
+    }
+    if (hdr->version != FSM_TABLE_VERSION) {
+        set_error(err, errlen, "不支持的表版本%u", hdr->version);
+        return -1;
+    }
+    uint64_t ncells = (uint64_t)hdr->num_states * hdr->num_events;
+    uint64_t num_names = (uint64_t)hdr->num_states + hdr->num_events + hdr->num_actions;
+    if (hdr->total_size > size || hdr->num_states == 0 || hdr->initial >= hdr->num_states ||
+        hdr->cells_off + ncells * sizeof(struct fsm_table_cell) > hdr->ntrans_off ||
+        hdr->ntrans_off + (uint64_t)hdr->num_states * sizeof(uint32_t) > hdr->names_off ||
+        hdr->names_off + num_names * sizeof(uint32_t) > hdr->strtab_off ||
+        (uint64_t)hdr->strtab_off + hdr->strtab_size > hdr->total_size ||
+        hdr->strtab_size == 0 || base[hdr->strtab_off + hdr->strtab_size - 1] != '\0') {
+        set_error(err, errlen, "状态机表已损坏");
+        return -1;
+    }
+
+    table->hdr = hdr;
+    table->cells = (const struct fsm_table_cell*)(base + hdr->cells_off);
+    table->ntrans = (const uint32_t*)(base + hdr->ntrans_off);
+    table->names = (const uint32_t*)(base + hdr->names_off);
+    table->strtab = (const char*)(base + hdr->strtab_off);
+
+    // 按名称绑定动作函数，只与动作数量有关
+    if (hdr->num_actions) {
+        table->actions = calloc(hdr->num_actions, sizeof(*table->actions));
+        if (!table->actions) {
+            set_error(err, errlen, "内存不足");
+            return -1;
+        }
+    }
+    for (i = 0; i < hdr->num_actions; i++) {
+        uint32_t off = table->names[hdr->num_states + hdr->num_events + i];
+        const char* name = off < hdr->strtab_size ? table->strtab + off : "";
+        const struct fsm_action_entry* e;
+        for (e = registry; e && e->name; e++) {
+            if (strcmp(e->name, name) == 0) {
+                table->actions[i] = e->fn;
+                break;
+            }
+        }
+        if (!table->actions[i]) {
+            set_error(err, errlen, "未注册的动作%s", name);
+            free(table->actions);
+            table->actions = NULL;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int fsm_table_mmap(struct fsm_table* table, const char* path,
+                   const struct fsm_action_entry* registry, char* err, size_t errlen)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        set_error(err, errlen, "无法打开%s: %s", path, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        set_error(err, errlen, "无法读取%s", path);
+        close(fd);
+        return -1;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        set_error(err, errlen, "mmap %s失败: %s", path, strerror(errno));
+        return -1;
+    }
+
+    if (fsm_table_open(table, map, st.st_size, registry, err, errlen) < 0) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+    table->map = map;
+    table->map_size = st.st_size;
+    return 0;
+}
+
+void fsm_table_close(struct fsm_table* table)
+{
+    free(table->actions);
+    if (table->map) {
+        munmap(table->map, table->map_size);
+    }
+    memset(table, 0, sizeof(*table));
+}
+
+static const char* name_at(const struct fsm_table* table, uint32_t idx)
+{
+    uint32_t off = table->names[idx];
+    return off < table->hdr->strtab_size ? table->strtab + off : "";
+}
+
+uint32_t fsm_table_find_state(const struct fsm_table* table, const char* name)
+{
+    uint32_t i;
+
+    for (i = 0; i < table->hdr->num_states; i++) {
+        if (strcmp(name_at(table, i), name) == 0) {
+            return i;
+        }
+    }
+    return FSM_TABLE_NONE;
+}
+
+uint32_t fsm_table_find_event(const struct fsm_table* table, const char* name)
+{
+    uint32_t i;
+
+    for (i = 0; i < table->hdr->num_events; i++) {
+        if (strcmp(name_at(table, table->hdr->num_states + i), name) == 0) {
+            return i;
+        }
+    }
+    return FSM_TABLE_NONE;
+}
+
+const char* fsm_table_state_name(const struct fsm_table* table, uint32_t state)
+{
+    if (state >= table->hdr->num_states) {
+        return NULL;
+    }
+    return name_at(table, state);
+}
+
+void fsm_table_machine_init(struct fsm_table_machine* m, const struct fsm_table* table)
+{
+    m->table = table;
+    m->cur = table->hdr->initial;
+    m->prev = FSM_TABLE_NONE;
+}
+
+int fsm_table_handle_event(struct fsm_table_machine* m, struct event* event)
+{
+    if (!m || !event) {
+        return stateM_errArg;
+    }
+
+    const struct fsm_table* t = m->table;
+    if (m->cur == FSM_TABLE_NONE) {
+        return stateM_errorStateReached;
+    }
+    if ((uint32_t)event->type >= t->hdr->num_events) {
+        return stateM_noStateChange;
+    }
+
+    const struct fsm_table_cell* c = &t->cells[(size_t)m->cur * t->hdr->num_events + event->type];
+    if (c->next == FSM_TABLE_NONE) {
+        return stateM_noStateChange;
+    }
+    if (unlikely(c->next >= t->hdr->num_states)) {
+        m->prev = m->cur;
+        m->cur = FSM_TABLE_NONE;
+        return stateM_errorStateReached;
+    }
+
+    if (c->action != FSM_TABLE_NONE && c->action < t->hdr->num_actions) {
+        t->actions[c->action](event);
+    }
+
+    m->prev = m->cur;
+    m->cur = c->next;
+
+    if (m->cur == m->prev) {
+        return stateM_stateLoopSelf;
+    }
+    if (!t->ntrans[m->cur]) {
+        return stateM_finalStateReached;
+    }
+    return stateM_stateChanged;
+}
@@ -0,0 +1,104 @@
+#ifndef FSM_TABLE_H
+#define FSM_TABLE_H
+
+// 表驱动状态机
+// 状态机以文本形式定义，经过校验后编译成一张扁平的二进制表：
+// 表中只包含偏移量而不含指针，因此可以写入文件后在启动时直接mmap使用，无需再次解析。
+//
+// 文本格式（每行一条指令，#开头为注释）：
+//   state  <名称>                       声明状态
+//   event  <名称>                       声明事件，事件类型按声明顺序从0编号
+//   initial <状态>                      初始状态，缺省为第一个声明的状态
+//   trans  <状态> <事件> <下一状态> [动作]  声明转换，动作名通过注册表绑定到函数
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fsm.h"
+
+#define FSM_TABLE_MAGIC   0x31424d46u  // "FMB1"
+#define FSM_TABLE_VERSION 1
+#define FSM_TABLE_NONE    0xffffffffu
+
+// 编译选项：允许存在从初始状态不可达的状态
+#define FSM_TABLE_ALLOW_UNREACHABLE 0x1
+
+// 动作注册表项，以{NULL, NULL}结尾
+struct fsm_action_entry {
+    const char* name;
+    void (*fn)(struct event* event);
+};
+
+// 二进制表头，所有偏移量均相对于表的起始地址
+struct fsm_table_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t num_states;
+    uint32_t num_events;
+    uint32_t num_actions;
+    uint32_t initial;
+    uint32_t cells_off;     // struct fsm_table_cell[num_states * num_events]
+    uint32_t ntrans_off;    // uint32_t[num_states]，每个状态的转换数量
+    uint32_t names_off;     // uint32_t[num_states + num_events + num_actions]，名称在字符串表中的偏移
+    uint32_t strtab_off;
+    uint32_t strtab_size;
+};
+
+// 稠密转换表的一项：[状态][事件]
+struct fsm_table_cell {
+    uint32_t next;          // 下一状态，FSM_TABLE_NONE表示无转换
+    uint32_t action;        // 动作编号，FSM_TABLE_NONE表示无动作
+};
+
+// 已加载的表（编译结果或mmap的文件）
+struct fsm_table {
+    const struct fsm_table_header* hdr;
+    const struct fsm_table_cell* cells;
+    const uint32_t* ntrans;
+    const uint32_t* names;
+    const char* strtab;
+    void (**actions)(struct event* event);  // 按动作编号绑定的函数
+
+    void* map;              // mmap的地址，非mmap加载时为NULL
+    size_t map_size;
+};
+
+// 基于表的状态机实例
+struct fsm_table_machine {
+    const struct fsm_table* table;
+    uint32_t cur;           // FSM_TABLE_NONE表示错误状态
+    uint32_t prev;
+};
+
+// 解析并校验文本定义，编译成二进制表
+// registry非NULL时同时检查所有动作名都已注册
+// 成功返回0，*out为malloc分配的表，由调用方free；失败返回-1，错误信息写入err
+int fsm_table_compile(const char* text, size_t len, const struct fsm_action_entry* registry,
+                      unsigned flags, void** out, size_t* out_size, char* err, size_t errlen);
+
+// 将编译好的表写入文件
+int fsm_table_write(const char* path, const void* blob, size_t size);
+
+// 从内存加载表：校验表头并按注册表绑定动作，blob在表使用期间必须保持有效
+int fsm_table_open(struct fsm_table* table, const void* blob, size_t size,
+                   const struct fsm_action_entry* registry, char* err, size_t errlen);
+
+// mmap编译好的表文件并加载
+int fsm_table_mmap(struct fsm_table* table, const char* path,
+                   const struct fsm_action_entry* registry, char* err, size_t errlen);
+
+void fsm_table_close(struct fsm_table* table);
+
+// 按名称查找状态/事件编号，未找到返回FSM_TABLE_NONE
+uint32_t fsm_table_find_state(const struct fsm_table* table, const char* name);
+uint32_t fsm_table_find_event(const struct fsm_table* table, const char* name);
+
+const char* fsm_table_state_name(const struct fsm_table* table, uint32_t state);
+
+void fsm_table_machine_init(struct fsm_table_machine* m, const struct fsm_table* table);
+
+// 处理事件，event->type为事件编号，返回值同FSM_handleEvent
+int fsm_table_handle_event(struct fsm_table_machine* m, struct event* event);
+
+#endif
@@ -0,0 +1,135 @@
+#include "fsm.h"
+
+#ifdef FSM_TRACE
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// 每线程环形缓冲区：只有所属线程写入，dump时由其它线程无锁读取
+struct fsm_trace_ring {
+    uint64_t head;                      // 已写入的记录总数
+    long tid;
+    struct fsm_trace_ring* next;        // 全局链表，用于dump时遍历所有线程
+    struct fsm_trace_record records[FSM_TRACE_RING_SIZE];
+};
+
+static struct fsm_trace_ring* ringList = NULL;
+static __thread struct fsm_trace_ring* localRing = NULL;
+
+static struct fsm_trace_ring* getLocalRing(void)
+{
+    struct fsm_trace_ring* ring = localRing;
+    if (ring) {
+        return ring;
+    }
+
+    ring = calloc(1, sizeof(*ring));
+    if (!ring) {
+        return NULL;
+    }
+    ring->tid = (long)syscall(SYS_gettid);
+
+    // 无锁插入全局链表头，环形缓冲区在进程生命周期内不释放
+    ring->next = __atomic_load_n(&ringList, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&ringList, &ring->next, ring, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+
+    localRing = ring;
+    return ring;
+}
+
+void fsm_trace_record(const struct StateMachine* fsm, const struct state* from,
+                      const struct state* to, int event, uint64_t ts)
+{
+    struct fsm_trace_ring* ring = getLocalRing();
+    if (unlikely(!ring)) {
+        return;
+    }
+
+    uint64_t head = ring->head;
+    struct fsm_trace_record* r = &ring->records[head & (FSM_TRACE_RING_SIZE - 1)];
+    r->ts = ts;
+    r->machine = (uintptr_t)fsm;
+    r->from = from;
+    r->to = to;
+    r->event = event;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void fsm_trace_dwell(struct fsm_dwell_hist* hist, uint64_t ticks)
+{
+    int b = ticks ? 63 - __builtin_clzll(ticks) : 0;
+    if (b >= FSM_TRACE_DWELL_BUCKETS) {
+        b = FSM_TRACE_DWELL_BUCKETS - 1;
+    }
+    __atomic_add_fetch(&hist->count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hist->buckets[b], 1, __ATOMIC_RELAXED);
+}
+
+static const char* stateName(const struct state* s)
+{
+    return s ? s->name : "(error)";
+}
+
+void fsm_trace_dump(FILE* fp, size_t max_per_thread)
+{
+    struct fsm_trace_ring* ring;
+    struct fsm_trace_record* copy = malloc(sizeof(ring->records));
+    if (!copy) {
+        return;
+    }
+
+    for (ring = __atomic_load_n(&ringList, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        uint64_t end = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t n = end < FSM_TRACE_RING_SIZE ? end : FSM_TRACE_RING_SIZE;
+        if (max_per_thread && n > max_per_thread) {
+            n = max_per_thread;
+        }
+        memcpy(copy, ring->records, sizeof(ring->records));
+
+        // 复制期间写线程可能覆盖了最旧的记录，这些记录直接丢弃；写线程先写第after条再推进head，
+        // 第after条所在的槽（即第after - RING_SIZE条）可能正写到一半，也一并丢弃
+        uint64_t after = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t start = end - n;
+        if (after >= FSM_TRACE_RING_SIZE && after - FSM_TRACE_RING_SIZE + 1 > start) {
+            start = after - FSM_TRACE_RING_SIZE + 1;
+        }
+
+        fprintf(fp, "thread %ld: %llu transitions\n", ring->tid, (unsigned long long)end);
+        for (uint64_t i = start; i < end; i++) {
+            struct fsm_trace_record* r = &copy[i & (FSM_TRACE_RING_SIZE - 1)];
+            fprintf(fp, "  %llu fsm=%#lx %s -> %s event=%d\n",
+                    (unsigned long long)r->ts, (unsigned long)r->machine,
+                    stateName(r->from), stateName(r->to), r->event);
+        }
+    }
+
+    free(copy);
+}
+
+void fsm_trace_dump_states(FILE* fp, struct state* const* states, int num)
+{
+    int i, j, b;
+
+    for (i = 0; i < num; i++) {
+        struct state* s = states[i];
+        fprintf(fp, "state %s: dwell samples=%llu\n", s->name,
+                (unsigned long long)__atomic_load_n(&s->dwell.count, __ATOMIC_RELAXED));
+        for (j = 0; j < s->numTransitions; j++) {
+            struct transition* t = &s->transitions[j];
+            fprintf(fp, "  event %d -> %s: hits=%llu\n", t->eventType, stateName(t->nextState),
+                    (unsigned long long)__atomic_load_n(&t->hits, __ATOMIC_RELAXED));
+        }
+        for (b = 0; b < FSM_TRACE_DWELL_BUCKETS; b++) {
+            uint64_t c = __atomic_load_n(&s->dwell.buckets[b], __ATOMIC_RELAXED);
+            if (c) {
+                fprintf(fp, "  dwell [2^%d, 2^%d) ticks: %llu\n", b, b + 1, (unsigned long long)c);
+            }
+        }
+    }
+}
+
+#endif
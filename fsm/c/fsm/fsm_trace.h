@@ -0,0 +1,82 @@
+#ifndef FSM_TRACE_H
+#define FSM_TRACE_H
+
+// 状态机执行追踪
+// 定义FSM_TRACE时启用：每个线程一个无锁环形缓冲区记录状态转换，
+// 同时统计每个转换的命中次数和每个状态的停留时间直方图。
+// 未定义时所有追踪代码都被编译掉，不产生任何开销。
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef FSM_TRACE
+
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// 每线程环形缓冲区的记录数（2的幂）
+#define FSM_TRACE_RING_SIZE 4096
+
+// 停留时间直方图的桶数：第i个桶统计[2^i, 2^(i+1))个时钟周期
+#define FSM_TRACE_DWELL_BUCKETS 48
+
+struct state;
+struct StateMachine;
+
+struct fsm_trace_record {
+    uint64_t ts;                // 时间戳（fsm_trace_now的时钟周期）
+    uintptr_t machine;          // 状态机标识
+    const struct state* from;
+    const struct state* to;
+    int event;
+};
+
+struct fsm_dwell_hist {
+    uint64_t count;
+    uint64_t buckets[FSM_TRACE_DWELL_BUCKETS];
+};
+
+// 读取时间戳：x86上使用rdtsc，其它平台使用clock_gettime（vDSO）
+static inline uint64_t fsm_trace_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// 记录一次状态转换（写入当前线程的环形缓冲区）
+void fsm_trace_record(const struct StateMachine* fsm, const struct state* from,
+                      const struct state* to, int event, uint64_t ts);
+
+// 记录一次停留时间
+void fsm_trace_dwell(struct fsm_dwell_hist* hist, uint64_t ticks);
+
+// 输出所有线程最近的追踪记录，max_per_thread为0表示输出缓冲区中的全部记录
+void fsm_trace_dump(FILE* fp, size_t max_per_thread);
+
+// 输出给定状态的转换命中次数和停留时间直方图
+void fsm_trace_dump_states(FILE* fp, struct state* const* states, int num);
+
+#define FSM_TRACE_TRANSITION(fsm, t, from, to, ev) do {                       \
+        uint64_t now_ = fsm_trace_now();                                      \
+        __atomic_add_fetch(&(t)->hits, 1, __ATOMIC_RELAXED);                  \
+        if ((fsm)->enteredAt) {                                               \
+            fsm_trace_dwell(&(from)->dwell, now_ - (fsm)->enteredAt);         \
+        }                                                                     \
+        (fsm)->enteredAt = now_;                                              \
+        fsm_trace_record((fsm), (from), (to), (ev), now_);                    \
+    } while (0)
+
+#else
+
+#define FSM_TRACE_TRANSITION(fsm, t, from, to, ev) do { } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,146 @@
+#include "admissionFilter.h"
+
+#include <cstring>
+
+#include "flow_hash.h"
+#include "timeWheel.h"
+
+static inline void addSaturated(uint32_t& v, uint64_t n)
+{
+	uint64_t sum = (uint64_t)v + n;
+	v = sum > UINT32_MAX ? UINT32_MAX : (uint32_t)sum;
+}
+
+static inline void addSaturated(uint16_t& v, uint64_t n)
+{
+	uint64_t sum = (uint64_t)v + n;
+	v = sum > UINT16_MAX ? UINT16_MAX : (uint16_t)sum;
+}
+
+AdmissionFilter::AdmissionFilter(const AdmissionConfig& cfg)
+	: cfg_(cfg), admitted_(0), rejected_(0), evicted_(0)
+{
+	size_t sets = 1;
+	while (sets * WAYS < cfg_.capacity)
+	{
+		sets <<= 1;
+	}
+	setMask_ = sets - 1;
+	slots_.resize(sets * WAYS);
+	memset(&slots_[0], 0, slots_.size() * sizeof(Slot));
+}
+
+bool AdmissionFilter::offer(const Sessionkey& key, bool isUplink, uint64_t bytes, uint64_t packets, uint64_t now,
+                            SessionStats& stats, bool& reversed)
+{
+	// 两端分别哈希，按大小排序后再合并：正反方向得到同一个哈希，本包的朝向为源端是否较大
+	uint64_t a = hash_bytes(key.srcIp.data(), key.srcIp.size(), (uint16_t)key.srcPort);
+	uint64_t b = hash_bytes(key.dstIp.data(), key.dstIp.size(), (uint16_t)key.dstPort);
+	uint64_t ends[2] = { a < b ? a : b, a < b ? b : a };
+	uint64_t h = hash_bytes(ends, sizeof(ends), key.protocol);
+	// 两端哈希相等时（如同一地址上两个端口恰好碰撞）按原始的(地址, 端口)比较，否则双向流两个方向的dir相同
+	uint8_t dir;
+	if (a != b)
+	{
+		dir = a > b;
+	}
+	else if (key.srcIp != key.dstIp)
+	{
+		dir = key.srcIp > key.dstIp;
+	}
+	else
+	{
+		dir = (uint16_t)key.srcPort > (uint16_t)key.dstPort;
+	}
+	uint32_t tag = (uint32_t)(h >> 32) | 1;
+
+	Slot* set = &slots_[(h & setMask_) * WAYS];
+	Slot* slot = NULL;
+	for (int i = 0; i < WAYS; ++i)
+	{
+		if (set[i].tag == tag)
+		{
+			slot = &set[i];
+			break;
+		}
+	}
+
+	if (slot == NULL || expired(*slot, now))
+	{
+		// 新的流：依次选空槽、已作废的槽、最久没有数据包的槽
+		if (slot == NULL)
+		{
+			for (int i = 0; i < WAYS; ++i)
+			{
+				Slot& s = set[i];
+				if (s.tag == 0)
+				{
+					slot = &s;
+					break;
+				}
+				if (slot == NULL || (expired(s, now) && !expired(*slot, now)) ||
+				    (expired(s, now) == expired(*slot, now) && (uint32_t)now - s.lastSeen > (uint32_t)now - slot->lastSeen))
+				{
+					slot = &s;
+				}
+			}
+		}
+		if (slot->tag != 0)
+		{
+			rejected_++;
+			evicted_ += !expired(*slot, now);
+		}
+		memset(slot, 0, sizeof(*slot));
+		slot->tag = tag;
+		slot->firstDir = dir;
+	}
+
+	int d = isUplink ? 0 : 1;
+	slot->lastSeen = (uint32_t)now;
+	addSaturated(slot->bytes[d], bytes);
+	addSaturated(slot->packets[d], packets);
+	slot->dirs |= (uint8_t)(1 << dir);
+
+	uint32_t total = (uint32_t)slot->packets[0] + slot->packets[1];
+	bool admit = (cfg_.bidirectional && slot->dirs == 3) || (cfg_.minPackets && total >= cfg_.minPackets) ||
+	             (!cfg_.bidirectional && !cfg_.minPackets);
+	if (!admit)
+	{
+		return false;
+	}
+
+	stats.upBytes = slot->bytes[0];
+	stats.downBytes = slot->bytes[1];
+	stats.upPackets = slot->packets[0];
+	stats.downPackets = slot->packets[1];
+	reversed = dir != slot->firstDir;
+	slot->tag = 0;
+	admitted_++;
+	return true;
+}
+
+AdmissionStats AdmissionFilter::stats(uint64_t now) const
+{
+	AdmissionStats st;
+	st.admitted = admitted_;
+	st.rejected = rejected_;
+	st.evicted = evicted_;
+	st.memoryBytes = slots_.size() * sizeof(Slot);
+
+	for (size_t i = 0; i < slots_.size(); ++i)
+	{
+		if (slots_[i].tag == 0)
+		{
+			continue;
+		}
+		if (expired(slots_[i], now))
+		{
+			st.rejected++;
+		}
+		else
+		{
+			st.probing++;
+		}
+	}
+	return st;
+}
@@ -0,0 +1,82 @@
+#ifndef ADMISSION_FILTER_H
+#define ADMISSION_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Sessionkey;
+struct SessionStats;
+
+/*
+ * 会话准入过滤：未知流的数据包先记在一张固定大小的试用表中，流量满足条件后才创建完整的会话。
+ *
+ * 每个会话要分配Sessionkey、Entry、哈希表节点等几百字节，并在时间轮中停留idleSeconds；
+ * 端口扫描的每个探测包都是一个新流，不过滤时会造成上百万个只有一个包的会话。
+ * 试用表每个流只占一个24字节的槽，按双向对称的五元组哈希定位，正反方向落在同一个槽；
+ * 4路组相联，流在probationSeconds内没有新数据包即作废，组满时替换最久没有数据包的槽。
+ * 槽中只存哈希的32位标签，两个流的哈希同时冲突时会被当成同一个流，概率可以忽略。
+ *
+ * 作废或被替换、没有转正的流记为rejected；试用期间的数据包统计在转正时带入会话。
+ */
+struct AdmissionConfig
+{
+	uint32_t minPackets;        // 累计这么多个数据包后创建会话，0表示不按包数
+	bool bidirectional;         // 两个方向都有数据包后创建会话
+	uint32_t probationSeconds;  // 试用表中的流这么久没有新数据包即作废
+	size_t capacity;            // 试用表的槽数，向上取整为4的倍数的2的幂
+
+	AdmissionConfig() : minPackets(4), bidirectional(true), probationSeconds(2), capacity(65536) {}
+};
+
+struct AdmissionStats
+{
+	uint64_t admitted;          // 转正为会话的流
+	uint64_t rejected;          // 作废或被替换的流
+	uint64_t evicted;           // 其中试用期未满就被替换的流
+	uint64_t probing;           // 仍在试用期中的流
+	size_t memoryBytes;         // 试用表占用的内存
+
+	AdmissionStats() : admitted(0), rejected(0), evicted(0), probing(0), memoryBytes(0) {}
+};
+
+class AdmissionFilter
+{
+public:
+	explicit AdmissionFilter(const AdmissionConfig& cfg);
+
+	/*记录未知流的一个数据包（now为当前tick）。流满足准入条件时从试用表中移除并返回true，
+	  stats为试用期间累计的统计（含本包），reversed表示本包与该流第一个包的方向相反*/
+	bool offer(const Sessionkey& key, bool isUplink, uint64_t bytes, uint64_t packets, uint64_t now,
+	           SessionStats& stats, bool& reversed);
+
+	/*now时刻的统计，已过期但还没有被替换的槽计入rejected*/
+	AdmissionStats stats(uint64_t now) const;
+
+private:
+	enum { WAYS = 4 };
+
+	struct Slot
+	{
+		uint32_t tag;           // 哈希的高32位，0为空槽
+		uint32_t lastSeen;      // 最后一个数据包的tick（低32位）
+		uint32_t bytes[2];      // [0]上行，[1]下行
+		uint16_t packets[2];
+		uint8_t dirs;           // 见过的方向（按五元组的朝向），bit0/bit1
+		uint8_t firstDir;       // 第一个包的朝向
+	};
+
+	bool expired(const Slot& s, uint64_t now) const
+	{
+		return (uint32_t)now - s.lastSeen > cfg_.probationSeconds;
+	}
+
+	AdmissionConfig cfg_;
+	std::vector<Slot> slots_;
+	size_t setMask_;
+	uint64_t admitted_;
+	uint64_t rejected_;
+	uint64_t evicted_;
+};
+
+#endif
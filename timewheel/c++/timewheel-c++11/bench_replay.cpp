@@ -0,0 +1,399 @@
+#include "timeWheel.h"
+#include "pcapReader.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <string>
+#include <vector>
+
+// 离线回放测试：mmap读取pcap/pcapng，零拷贝解析五元组，按数据包时间戳驱动外部时钟模式的时间轮，
+// 以最快速度批量调用UpdateSessions，统计吞吐、会话创建/超时速率、峰值会话数与内存、每包延迟分布。
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s [options] <file.pcap|file.pcapng>\n"
+            "       %s [options] --synth <flows> <seconds>\n"
+            "  -i, --idle <sec>     会话超时时间，默认60\n"
+            "  -b, --batch <n>      每批更新的数据包数，默认32，1表示逐包调用\n"
+            "      --lazy           延迟刷新：刷新会话只记录tick，bucket到期时再移动\n"
+            "  -e, --expect <n>     预计的并发会话数，预先分配会话表，会话数涨到n之前不再扩容\n"
+            "      --synth          生成合成流量后回放（没有抓包文件时使用）\n"
+            "      --pcapng         合成流量写成pcapng格式\n"
+            "  -o, --out <path>     合成流量文件路径，默认/tmp/cpp-timewheel-c11-synth.pcap[ng]\n"
+            "      --json           时间轮运行时统计以JSON格式输出\n",
+            prog, prog);
+}
+
+// ----------------- 每包延迟直方图 ------------------
+// 使用时间轮统计模块的对数线性直方图，按2的幂合并子桶输出
+static void printLatency(FILE* fp, const wheel_hist_t* h)
+{
+    fprintf(fp, "latency:   p50 %llu ns, p90 %llu ns, p99 %llu ns, p99.9 %llu ns, max %llu ns\n",
+            (unsigned long long)wheel_hist_percentile(h, 50), (unsigned long long)wheel_hist_percentile(h, 90),
+            (unsigned long long)wheel_hist_percentile(h, 99), (unsigned long long)wheel_hist_percentile(h, 99.9),
+            (unsigned long long)h->max);
+
+    for (unsigned k = 0; k * WHEEL_HIST_SUB < WHEEL_HIST_BUCKETS; ++k) {
+        uint64_t c = 0;
+        for (unsigned j = 0; j < WHEEL_HIST_SUB; ++j) {
+            c += h->buckets[k * WHEEL_HIST_SUB + j];
+        }
+        if (c) {
+            fprintf(fp, "  [%8llu, %8llu) ns: %10llu %5.1f%%\n",
+                    (unsigned long long)wheel_hist_bucket_lower(k * WHEEL_HIST_SUB),
+                    (unsigned long long)wheel_hist_bucket_lower((k + 1) * WHEEL_HIST_SUB),
+                    (unsigned long long)c, 100.0 * c / h->count);
+        }
+    }
+}
+
+// 匿名内存（不含mmap的抓包文件页）和历史峰值RSS，单位KB
+static void readMemory(long& anonKb, long& hwmKb)
+{
+    char line[256];
+    FILE* fp = fopen("/proc/self/status", "r");
+    anonKb = hwmKb = 0;
+    if (!fp) {
+        return;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        sscanf(line, "RssAnon: %ld", &anonKb);
+        sscanf(line, "VmHWM: %ld", &hwmKb);
+    }
+    fclose(fp);
+}
+
+// ----------------- 合成流量 ------------------
+class SyntheticWriter {
+public:
+    SyntheticWriter(FILE* fp, bool pcapng) : fp_(fp), pcapng_(pcapng) {}
+
+    void writeHeader()
+    {
+        if (pcapng_) {
+            // SHB + 一个以太网接口（默认微秒精度）
+            uint32_t shb[7] = { 0x0a0d0d0a, 28, 0x1a2b3c4d, 1, 0xffffffff, 0xffffffff, 28 };
+            uint32_t idb[5] = { 1, 20, PCAP_LINKTYPE_ETHERNET, 65535, 20 };
+            fwrite(shb, sizeof(shb), 1, fp_);
+            fwrite(idb, sizeof(idb), 1, fp_);
+        } else {
+            uint32_t hdr[6] = { 0xa1b2c3d4, 0x00040002, 0, 0, 65535, PCAP_LINKTYPE_ETHERNET };
+            fwrite(hdr, sizeof(hdr), 1, fp_);
+        }
+    }
+
+    void writePacket(uint64_t tsUs, const uint8_t* frame, uint32_t capLen, uint32_t len)
+    {
+        static const uint8_t pad[4] = { 0, 0, 0, 0 };
+        if (pcapng_) {
+            uint32_t padded = (capLen + 3) & ~3u;
+            uint32_t blockLen = 32 + padded;
+            uint32_t epb[7] = { 6, blockLen, 0, (uint32_t)(tsUs >> 32), (uint32_t)tsUs, capLen, len };
+            fwrite(epb, sizeof(epb), 1, fp_);
+            fwrite(frame, capLen, 1, fp_);
+            fwrite(pad, padded - capLen, 1, fp_);
+            fwrite(&blockLen, sizeof(blockLen), 1, fp_);
+        } else {
+            uint32_t rec[4] = { (uint32_t)(tsUs / 1000000), (uint32_t)(tsUs % 1000000), capLen, len };
+            fwrite(rec, sizeof(rec), 1, fp_);
+            fwrite(frame, capLen, 1, fp_);
+        }
+    }
+
+private:
+    FILE* fp_;
+    bool pcapng_;
+};
+
+static void put16(uint8_t* p, uint16_t v) { p[0] = v >> 8; p[1] = v & 0xff; }
+static void put32(uint8_t* p, uint32_t v) { put16(p, v >> 16); put16(p + 2, v & 0xffff); }
+
+// 会话在[0, seconds)内均匀开始，每个会话若干个数据包，包间隔大多很短，
+// 少数超过超时时间（会话先超时再以同一五元组重新创建）。
+// 混合IPv4/IPv6、TCP/UDP，部分带VLAN标签，覆盖解析的各个分支。
+static bool writeSynthetic(const char* path, bool pcapng, int flows, int seconds, int idleSeconds)
+{
+    struct Pkt {
+        uint64_t tsUs;
+        int flow;
+        bool reply;
+        uint16_t len;
+    };
+    std::vector<Pkt> pkts;
+    unsigned seed = 42;
+
+    for (int f = 0; f < flows; ++f) {
+        uint64_t ts = (uint64_t)rand_r(&seed) % ((uint64_t)seconds * 1000000ULL);
+        int n = 2 + rand_r(&seed) % 20;
+        for (int i = 0; i < n; ++i) {
+            Pkt p = { ts, f, (i & 1) != 0, (uint16_t)(128 + rand_r(&seed) % 1300) };
+            pkts.push_back(p);
+            ts += rand_r(&seed) % 50 ? rand_r(&seed) % 200000
+                                     : (uint64_t)(idleSeconds + 1 + rand_r(&seed) % 5) * 1000000ULL;
+        }
+    }
+    std::sort(pkts.begin(), pkts.end(), [](const Pkt& a, const Pkt& b) { return a.tsUs < b.tsUs; });
+
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        return false;
+    }
+    SyntheticWriter writer(fp, pcapng);
+    writer.writeHeader();
+
+    const uint64_t base = 1700000000ULL * 1000000ULL;
+    uint8_t frame[18 + 40 + 20];
+    for (size_t i = 0; i < pkts.size(); ++i) {
+        const Pkt& p = pkts[i];
+        bool ipv6 = p.flow % 4 == 3;
+        bool vlan = p.flow % 5 == 0;
+        uint8_t proto = p.flow % 7 == 0 ? IPPROTO_UDP : IPPROTO_TCP;
+        uint32_t client = 0x0a000000u | (uint32_t)(p.flow & 0xffffff);
+        uint32_t server = 0xc0a80000u | (uint32_t)(p.flow % 251 + 1);
+        uint16_t cport = (uint16_t)(1024 + p.flow % 60000);
+        uint16_t sport = proto == IPPROTO_UDP ? 53 : (p.flow % 3 ? 443 : 80);
+
+        memset(frame, 0, sizeof(frame));
+        uint8_t* l3 = frame + 14;
+        if (vlan) {
+            put16(frame + 12, 0x8100);
+            put16(frame + 14, (uint16_t)(p.flow % 4094 + 1));
+            l3 += 4;
+        }
+        put16(l3 - 2, ipv6 ? 0x86dd : 0x0800);
+
+        uint8_t* l4;
+        if (ipv6) {
+            l3[0] = 0x60;
+            put16(l3 + 4, (uint16_t)(p.len - (l3 - frame) - 40));
+            l3[6] = proto;
+            l3[7] = 64;
+            // 2001:db8::/32下的地址，低32位为IPv4地址
+            uint8_t* a = l3 + (p.reply ? 24 : 8);
+            uint8_t* b = l3 + (p.reply ? 8 : 24);
+            put16(a, 0x2001); put16(a + 2, 0x0db8); put32(a + 12, client);
+            put16(b, 0x2001); put16(b + 2, 0x0db8); put32(b + 12, server);
+            l4 = l3 + 40;
+        } else {
+            l3[0] = 0x45;
+            put16(l3 + 2, (uint16_t)(p.len - (l3 - frame)));
+            l3[8] = 64;
+            l3[9] = proto;
+            put32(l3 + 12, p.reply ? server : client);
+            put32(l3 + 16, p.reply ? client : server);
+            l4 = l3 + 20;
+        }
+        put16(l4, p.reply ? sport : cport);
+        put16(l4 + 2, p.reply ? cport : sport);
+
+        uint32_t capLen = (uint32_t)(l4 + 20 - frame);
+        writer.writePacket(base + p.tsUs, frame, capLen, p.len);
+    }
+    fclose(fp);
+    printf("synthetic trace: %d flows, %zu packets over %ds -> %s\n", flows, pkts.size(), seconds, path);
+    return true;
+}
+
+// ----------------- 回放 ------------------
+static void tupleToUpdate(const PacketTuple& t, uint32_t len, SessionUpdate& u)
+{
+    char src[INET6_ADDRSTRLEN], dst[INET6_ADDRSTRLEN];
+    inet_ntop(t.family, t.srcAddr, src, sizeof(src));
+    inet_ntop(t.family, t.dstAddr, dst, sizeof(dst));
+
+    // assign复用字符串已有的容量，批量缓冲区稳定后不再分配内存
+    u.key.srcIp.assign(src);
+    u.key.dstIp.assign(dst);
+    u.key.srcPort = t.srcPort;
+    u.key.dstPort = t.dstPort;
+    u.key.protocol = t.proto;
+    // 客户端端口通常大于服务端端口
+    u.isUplink = t.srcPort > t.dstPort;
+    u.bytes = len;
+    u.packets = 1;
+}
+
+int main(int argc, char* argv[])
+{
+    int idleSeconds = 60;
+    size_t batchSize = 32;
+    size_t expectFlows = 0;
+    bool synth = false, pcapng = false, json = false, lazy = false;
+    std::string path;
+
+    static const struct option longOpts[] = {
+        { "idle", required_argument, NULL, 'i' },
+        { "batch", required_argument, NULL, 'b' },
+        { "out", required_argument, NULL, 'o' },
+        { "synth", no_argument, NULL, 's' },
+        { "pcapng", no_argument, NULL, 'n' },
+        { "json", no_argument, NULL, 'j' },
+        { "lazy", no_argument, NULL, 'l' },
+        { "expect", required_argument, NULL, 'e' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "i:b:o:e:h", longOpts, NULL)) != -1) {
+        switch (c) {
+        case 'i': idleSeconds = atoi(optarg); break;
+        case 'b': batchSize = (size_t)atol(optarg); break;
+        case 'o': path = optarg; break;
+        case 's': synth = true; break;
+        case 'n': pcapng = true; break;
+        case 'j': json = true; break;
+        case 'l': lazy = true; break;
+        case 'e': expectFlows = (size_t)atol(optarg); break;
+        default: usage(argv[0]); return c == 'h' ? 0 : 1;
+        }
+    }
+    if (idleSeconds <= 0 || batchSize == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (synth) {
+        if (argc - optind != 2) {
+            usage(argv[0]);
+            return 1;
+        }
+        int flows = atoi(argv[optind]), seconds = atoi(argv[optind + 1]);
+        if (path.empty()) {
+            path = pcapng ? "/tmp/cpp-timewheel-c11-synth.pcapng" : "/tmp/cpp-timewheel-c11-synth.pcap";
+        }
+        if (flows <= 0 || seconds <= 0 || !writeSynthetic(path.c_str(), pcapng, flows, seconds, idleSeconds)) {
+            fprintf(stderr, "failed to write synthetic trace\n");
+            return 1;
+        }
+    } else {
+        if (argc - optind != 1) {
+            usage(argv[0]);
+            return 1;
+        }
+        path = argv[optind];
+    }
+
+    std::string err;
+    PcapReader reader;
+    if (!reader.open(path.c_str(), err)) {
+        fprintf(stderr, "%s\n", err.c_str());
+        return 1;
+    }
+
+    wheel_clock_init(1, 20);
+    CTimeWheel::verbose = false;
+    CTimeWheel wheel(idleSeconds, NULL, CTimeWheel::CLOCK_EXTERNAL);
+    wheel.setLazyRefresh(lazy);
+    if (expectFlows) {
+        wheel.reserveSessions(expectFlows);
+    }
+
+    std::vector<SessionUpdate> batch(batchSize);
+    size_t pending = 0;
+    std::vector<wheel_hist_t> latency(1);   // 约4KB，不放在栈上
+
+    uint64_t packets = 0, skipped = 0, bytes = 0, created = 0, expired = 0;
+    uint64_t firstTs = 0, lastTs = 0, curTick = 0;
+    size_t peakSessions = 0;
+    long baseAnonKb, peakAnonKb, anonKb, hwmKb;
+    readMemory(baseAnonKb, hwmKb);
+    peakAnonKb = baseAnonKb;
+
+    // 提交一批更新，按批耗时均摊到每个数据包
+    auto flush = [&]() {
+        if (!pending) {
+            return;
+        }
+        uint64_t t0 = wheel_clock_ns();
+        created += wheel.UpdateSessions(&batch[0], pending);
+        uint64_t dt = wheel_clock_ns() - t0;
+        wheel_hist_record_n(&latency[0], dt / pending, pending);
+        pending = 0;
+
+        size_t n = wheel.sessionCount();
+        if (n > peakSessions) {
+            peakSessions = n;
+        }
+    };
+
+    PacketView pkt;
+    PacketTuple tuple;
+    uint64_t start = wheel_clock_mono_ns();
+
+    while (reader.next(pkt)) {
+        uint64_t tick = pkt.tsNs / 1000000000ULL;
+        if (packets + skipped == 0) {
+            firstTs = pkt.tsNs;
+            curTick = tick;
+            wheel.start(tick);
+        }
+        lastTs = pkt.tsNs;
+
+        // 时间推进前先提交之前的数据包，保证它们按原来的tick刷新生命周期
+        if (tick != curTick) {
+            flush();
+            expired += wheel.advance(tick);
+            curTick = tick;
+        }
+
+        if (!parsePacket(pkt, tuple)) {
+            skipped++;
+            continue;
+        }
+        tupleToUpdate(tuple, pkt.len, batch[pending]);
+        packets++;
+        bytes += pkt.len;
+
+        if (++pending == batchSize) {
+            flush();
+        }
+        if ((packets & 0xffff) == 0) {
+            readMemory(anonKb, hwmKb);
+            peakAnonKb = anonKb > peakAnonKb ? anonKb : peakAnonKb;
+        }
+    }
+    flush();
+    double elapsed = (wheel_clock_mono_ns() - start) / 1e9;
+
+    if (!reader.finished()) {
+        fprintf(stderr, "warning: %s is truncated or corrupt, stopped early\n", path.c_str());
+    }
+
+    readMemory(anonKb, hwmKb);
+    peakAnonKb = anonKb > peakAnonKb ? anonKb : peakAnonKb;
+    size_t remaining = wheel.sessionCount();
+    double traceSec = (lastTs - firstTs) / 1e9;
+    if (elapsed <= 0) {
+        elapsed = 1e-9;
+    }
+
+    printf("input:     %s (%s, %.1f MB)\n", path.c_str(), reader.isPcapng() ? "pcapng" : "pcap",
+           reader.fileSize() / 1e6);
+    printf("packets:   %llu (%llu skipped), %.1f MB on the wire, batch %zu, %s refresh\n",
+           (unsigned long long)packets, (unsigned long long)skipped, bytes / 1e6, batchSize,
+           lazy ? "lazy" : "eager");
+    printf("sessions:  created %llu, expired %llu, remaining %zu, peak %zu (idle timeout %ds)\n",
+           (unsigned long long)created, (unsigned long long)expired, remaining, peakSessions, idleSeconds);
+    printf("replay:    %.3f s for %.1f s of traffic (%.0fx)\n", elapsed, traceSec,
+           traceSec / elapsed);
+    printf("rates:     %.2f Mpps, %.0f flows/s created, %.0f flows/s expired\n",
+           packets / elapsed / 1e6, created / elapsed, expired / elapsed);
+    printf("memory:    peak anon RSS %.1f MB (+%.1f MB), %.0f bytes/session at peak, VmHWM %.1f MB\n",
+           peakAnonKb / 1024.0, (peakAnonKb - baseAnonKb) / 1024.0,
+           peakSessions ? (peakAnonKb - baseAnonKb) * 1024.0 / peakSessions : 0.0, hwmKb / 1024.0);
+    printLatency(stdout, &latency[0]);
+    wheel.dumpMetrics(stdout, json);
+
+    // 自检：每个会话要么已超时，要么仍在表中
+    if (created != expired + remaining) {
+        fprintf(stderr, "FAIL: created %llu != expired %llu + remaining %zu\n", (unsigned long long)created,
+                (unsigned long long)expired, remaining);
+        return 1;
+    }
+    return 0;
+}
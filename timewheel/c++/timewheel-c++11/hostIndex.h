@@ -0,0 +1,302 @@
+#ifndef HOST_INDEX_H
+#define HOST_INDEX_H
+
+#include <arpa/inet.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "flow_hash.h"
+#include "sessionTable.h"
+
+/*128位主机地址，IPv4映射为::ffff:a.b.c.d，IPv4与IPv6在同一个地址空间中排序*/
+struct HostAddr
+{
+	uint64_t hi;
+	uint64_t lo;
+
+	HostAddr() : hi(0), lo(0) {}
+	HostAddr(uint64_t h, uint64_t l) : hi(h), lo(l) {}
+
+	/*ip为主机字节序的IPv4地址*/
+	static HostAddr fromIpv4(uint32_t ip)
+	{
+		return HostAddr(0, 0xffff00000000ULL | ip);
+	}
+
+	/*解析点分十进制的IPv4或IPv6地址*/
+	static bool parse(const std::string& s, HostAddr& out)
+	{
+		unsigned char buf[16];
+		if (inet_pton(AF_INET, s.c_str(), buf) == 1)
+		{
+			out = fromIpv4((uint32_t)buf[0] << 24 | (uint32_t)buf[1] << 16 | (uint32_t)buf[2] << 8 | buf[3]);
+			return true;
+		}
+		if (inet_pton(AF_INET6, s.c_str(), buf) == 1)
+		{
+			out.hi = out.lo = 0;
+			for (int i = 0; i < 8; ++i)
+			{
+				out.hi = out.hi << 8 | buf[i];
+				out.lo = out.lo << 8 | buf[i + 8];
+			}
+			return true;
+		}
+		return false;
+	}
+
+	bool operator<(const HostAddr& o) const
+	{
+		return hi != o.hi ? hi < o.hi : lo < o.lo;
+	}
+
+	bool operator==(const HostAddr& o) const
+	{
+		return hi == o.hi && lo == o.lo;
+	}
+};
+
+struct HostAddrHash
+{
+	size_t operator()(const HostAddr& a) const
+	{
+		return (size_t)hash_bytes(&a, sizeof(a), 0);
+	}
+};
+
+/*地址前缀，即[first, last]区间*/
+struct HostPrefix
+{
+	HostAddr first;
+	HostAddr last;
+
+	bool contains(const HostAddr& a) const
+	{
+		return !(a < first) && !(last < a);
+	}
+
+	/*addr的前len位（0-128）*/
+	static HostPrefix of(const HostAddr& addr, int len)
+	{
+		HostPrefix p;
+		uint64_t hiMask = len >= 64 ? ~0ULL : len <= 0 ? 0 : ~0ULL << (64 - len);
+		uint64_t loMask = len >= 128 ? ~0ULL : len <= 64 ? 0 : ~0ULL << (128 - len);
+		p.first = HostAddr(addr.hi & hiMask, addr.lo & loMask);
+		p.last = HostAddr(addr.hi | ~hiMask, addr.lo | ~loMask);
+		return p;
+	}
+
+	/*"10.0.0.0/24"、"10.0.0.5"（即/32）、"2001:db8::/32"；IPv4的前缀长度为0-32*/
+	static bool parse(const std::string& s, HostPrefix& out)
+	{
+		size_t slash = s.find('/');
+		HostAddr addr;
+		if (!HostAddr::parse(s.substr(0, slash), addr))
+		{
+			return false;
+		}
+
+		bool v4 = s.find(':') == std::string::npos;
+		int len = v4 ? 32 : 128;
+		if (slash != std::string::npos)
+		{
+			const char* str = s.c_str() + slash + 1;
+			char* end;
+			long n = strtol(str, &end, 10);
+			if (end == str || *end != '\0' || n < 0 || n > len)
+			{
+				return false;
+			}
+			len = (int)n;
+		}
+		out = of(addr, v4 ? 96 + len : len);
+		return true;
+	}
+};
+
+/*
+ * 按主机地址的会话二级索引：每个主机一个会话的侵入式双向链表，主机按地址排序。
+ *
+ * 会话表只能按五元组精确查找，"10.0.0.0/24的所有会话"、"删掉主机X的所有流"只能遍历全部会话。
+ * 这里每个会话按源、目的地址各挂在一个主机的链表上，主机放在按地址排序的std::map中，
+ * 前缀对应一段连续的地址区间：lower_bound找到第一个主机后顺序遍历，
+ * 查询时间为O(log 主机数 + 匹配的主机数 + 匹配的会话数)，与会话总数无关。
+ * 会话加入时按地址在哈希表中找到主机（几十万个主机时map的查找每层都是一次cache miss），
+ * 只有主机第一次出现和最后一个会话离开时才修改map；链表节点与会话一起分配、一起释放。
+ *
+ * T为会话的类型，索引只保存T*；调用方需自己加锁。
+ */
+template <typename T>
+class HostIndex
+{
+public:
+	struct Links;
+
+private:
+	struct Link;
+
+	struct HostList
+	{
+		Link* head;
+		size_t sessions;
+
+		HostList() : head(NULL), sessions(0) {}
+	};
+
+	typedef std::map<HostAddr, HostList> HostMap;
+	typedef SessionTable<HostAddr, typename HostMap::iterator, HostAddrHash> HostTable;
+
+	struct Link
+	{
+		Link* prev;
+		Link* next;
+		Links* parent;
+		typename HostMap::iterator host;
+	};
+
+public:
+	/*一个会话在索引中的节点：[0]挂在源地址的链表上，[1]挂在目的地址的链表上*/
+	struct Links
+	{
+		Link end[2];
+		T* owner;
+	};
+
+	HostIndex() : sessions_(0) {}
+
+	~HostIndex()
+	{
+		clear();
+	}
+
+	HostIndex(const HostIndex&) = delete;
+	HostIndex& operator=(const HostIndex&) = delete;
+
+	/*把会话按源、目的地址加入索引，返回的节点由unlink()释放*/
+	Links* link(T* owner, const HostAddr& src, const HostAddr& dst)
+	{
+		Links* l = new Links;
+		l->owner = owner;
+		attach(&l->end[0], l, src);
+		attach(&l->end[1], l, dst);
+		sessions_++;
+		return l;
+	}
+
+	void unlink(Links* l)
+	{
+		detach(&l->end[0]);
+		detach(&l->end[1]);
+		sessions_--;
+		delete l;
+	}
+
+	/*对源或目的地址在prefix内的每个会话调用一次fn(T*)，返回会话数；fn中不能修改索引*/
+	template <typename Fn>
+	size_t forEach(const HostPrefix& prefix, Fn fn) const
+	{
+		size_t n = 0;
+		for (typename HostMap::const_iterator it = hosts_.lower_bound(prefix.first);
+		     it != hosts_.end() && !(prefix.last < it->first); ++it)
+		{
+			for (Link* k = it->second.head; k != NULL; k = k->next)
+			{
+				// 两端都在前缀内的会话只在源地址一侧报告
+				if (k == &k->parent->end[1] && prefix.contains(k->parent->end[0].host->first))
+				{
+					continue;
+				}
+				fn(k->parent->owner);
+				n++;
+			}
+		}
+		return n;
+	}
+
+	/*释放所有节点，之前link()返回的节点全部失效*/
+	void clear()
+	{
+		// 目的地址一侧的Link可能在之后的链表中，先收集再释放
+		std::vector<Links*> all;
+		all.reserve(sessions_);
+		for (typename HostMap::iterator it = hosts_.begin(); it != hosts_.end(); ++it)
+		{
+			for (Link* k = it->second.head; k != NULL; k = k->next)
+			{
+				if (k == &k->parent->end[0])
+				{
+					all.push_back(k->parent);
+				}
+			}
+		}
+		for (size_t i = 0; i < all.size(); ++i)
+		{
+			delete all[i];
+		}
+		hosts_.clear();
+		byAddr_.clear();
+		sessions_ = 0;
+	}
+
+	size_t sessions() const { return sessions_; }
+	size_t hosts() const { return hosts_.size(); }
+
+private:
+	void attach(Link* k, Links* parent, const HostAddr& addr)
+	{
+		typename HostMap::iterator* found = byAddr_.find(addr);
+		typename HostMap::iterator it;
+		if (found != NULL)
+		{
+			it = *found;
+		}
+		else
+		{
+			it = hosts_.insert(std::make_pair(addr, HostList())).first;
+			byAddr_.insert(addr, it);
+		}
+		HostList& list = it->second;
+		k->parent = parent;
+		k->host = it;
+		k->prev = NULL;
+		k->next = list.head;
+		if (list.head != NULL)
+		{
+			list.head->prev = k;
+		}
+		list.head = k;
+		list.sessions++;
+	}
+
+	void detach(Link* k)
+	{
+		HostList& list = k->host->second;
+		if (k->prev != NULL)
+		{
+			k->prev->next = k->next;
+		}
+		else
+		{
+			list.head = k->next;
+		}
+		if (k->next != NULL)
+		{
+			k->next->prev = k->prev;
+		}
+		if (--list.sessions == 0)
+		{
+			byAddr_.erase(k->host->first);
+			hosts_.erase(k->host);
+		}
+	}
+
+	HostMap hosts_;         // 按地址排序，用于前缀查询
+	HostTable byAddr_;      // 地址到hosts_中的主机
+	size_t sessions_;
+};
+
+#endif
@@ -75,5 +75,9 @@ int main() {
     std::cout << "\n=== 演示结束 ===" << std::endl;
     std::cout << "总共超时会话数: " << timeoutNum << std::endl;
 
+    // 运行时统计
+    std::cout << std::endl;
+    timeWheel.dumpMetrics(stdout);
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,376 @@
+#include "pcapReader.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 经典pcap
+static const uint32_t PCAP_MAGIC_US = 0xa1b2c3d4;
+static const uint32_t PCAP_MAGIC_NS = 0xa1b23c4d;
+static const size_t PCAP_FILE_HDR_LEN = 24;
+static const size_t PCAP_RECORD_HDR_LEN = 16;
+
+// pcapng块类型
+static const uint32_t PCAPNG_SHB = 0x0a0d0d0a;
+static const uint32_t PCAPNG_IDB = 0x00000001;
+static const uint32_t PCAPNG_SPB = 0x00000003;
+static const uint32_t PCAPNG_EPB = 0x00000006;
+static const uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+static const uint16_t PCAPNG_OPT_ENDOFOPT = 0;
+static const uint16_t PCAPNG_OPT_IF_TSRESOL = 9;
+
+PcapReader::PcapReader()
+    : map_(NULL), size_(0), pos_(0), swap_(false), pcapng_(false), nanosecond_(false),
+      linktype_(0), lastTsNs_(0)
+{
+}
+
+PcapReader::~PcapReader()
+{
+    close();
+}
+
+void PcapReader::close()
+{
+    if (map_) {
+        munmap(const_cast<uint8_t*>(map_), size_);
+        map_ = NULL;
+    }
+    size_ = pos_ = 0;
+    interfaces_.clear();
+}
+
+uint16_t PcapReader::load16(size_t off) const
+{
+    uint16_t v;
+    memcpy(&v, map_ + off, sizeof(v));
+    return fix16(v);
+}
+
+uint32_t PcapReader::load32(size_t off) const
+{
+    uint32_t v;
+    memcpy(&v, map_ + off, sizeof(v));
+    return fix32(v);
+}
+
+bool PcapReader::open(const char* path, std::string& err)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        err = std::string(path) + ": " + strerror(errno);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)PCAP_FILE_HDR_LEN) {
+        err = std::string(path) + ": file too short";
+        ::close(fd);
+        return false;
+    }
+
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        err = std::string(path) + ": mmap: " + strerror(errno);
+        return false;
+    }
+    // 顺序读取，让内核加大预读
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    map_ = (const uint8_t*)p;
+    size_ = (size_t)st.st_size;
+
+    uint32_t magic;
+    memcpy(&magic, map_, sizeof(magic));
+
+    if (magic == PCAPNG_SHB) {
+        pcapng_ = true;
+        pos_ = 0;
+        return true;
+    }
+
+    pcapng_ = false;
+    if (magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS) {
+        swap_ = false;
+    } else if (__builtin_bswap32(magic) == PCAP_MAGIC_US || __builtin_bswap32(magic) == PCAP_MAGIC_NS) {
+        swap_ = true;
+    } else {
+        err = std::string(path) + ": not a pcap or pcapng file";
+        close();
+        return false;
+    }
+    nanosecond_ = fix32(magic) == PCAP_MAGIC_NS;
+    linktype_ = load32(20) & 0x0fffffff;   // 高4位为FCS信息
+    pos_ = PCAP_FILE_HDR_LEN;
+    return true;
+}
+
+bool PcapReader::next(PacketView& pkt)
+{
+    return pcapng_ ? nextPcapng(pkt) : nextPcap(pkt);
+}
+
+bool PcapReader::nextPcap(PacketView& pkt)
+{
+    if (size_ - pos_ < PCAP_RECORD_HDR_LEN) {
+        return false;
+    }
+
+    uint32_t tsSec = load32(pos_);
+    uint32_t tsFrac = load32(pos_ + 4);
+    uint32_t capLen = load32(pos_ + 8);
+    if (size_ - pos_ - PCAP_RECORD_HDR_LEN < capLen) {
+        return false;
+    }
+
+    pkt.tsNs = (uint64_t)tsSec * 1000000000ULL + (uint64_t)tsFrac * (nanosecond_ ? 1 : 1000);
+    pkt.capLen = capLen;
+    pkt.len = load32(pos_ + 12);
+    pkt.data = map_ + pos_ + PCAP_RECORD_HDR_LEN;
+    pkt.linktype = linktype_;
+
+    pos_ += PCAP_RECORD_HDR_LEN + capLen;
+    return true;
+}
+
+bool PcapReader::parseSectionHeader(size_t off)
+{
+    // 每个段可以有自己的字节序，接口编号也从0重新开始
+    uint32_t bom;
+    memcpy(&bom, map_ + off + 8, sizeof(bom));
+    if (bom == PCAPNG_BYTE_ORDER_MAGIC) {
+        swap_ = false;
+    } else if (__builtin_bswap32(bom) == PCAPNG_BYTE_ORDER_MAGIC) {
+        swap_ = true;
+    } else {
+        return false;
+    }
+    interfaces_.clear();
+    return true;
+}
+
+bool PcapReader::parseInterface(size_t off, uint32_t blockLen)
+{
+    if (blockLen < 20) {
+        return false;
+    }
+
+    Interface ifc;
+    ifc.linktype = load16(off + 8);
+    ifc.binaryResol = false;
+    ifc.resol = 6;
+
+    // 选项：code(2) len(2) value，按4字节对齐
+    size_t opt = off + 16;
+    size_t end = off + blockLen - 4;
+    while (end - opt >= 4) {
+        uint16_t code = load16(opt);
+        uint16_t len = load16(opt + 2);
+        if (code == PCAPNG_OPT_ENDOFOPT || end - opt - 4 < len) {
+            break;
+        }
+        if (code == PCAPNG_OPT_IF_TSRESOL && len >= 1) {
+            uint8_t v = map_[opt + 4];
+            ifc.binaryResol = (v & 0x80) != 0;
+            ifc.resol = v & 0x7f;
+        }
+        opt += 4 + ((len + 3u) & ~3u);
+    }
+
+    interfaces_.push_back(ifc);
+    return true;
+}
+
+uint64_t PcapReader::toNs(const Interface& ifc, uint64_t ts) const
+{
+    if (ifc.binaryResol) {
+        return (uint64_t)(((unsigned __int128)ts * 1000000000ULL) >> ifc.resol);
+    }
+    if (ifc.resol == 9) {
+        return ts;
+    }
+
+    uint64_t scale = 1;
+    if (ifc.resol < 9) {
+        for (int i = ifc.resol; i < 9; ++i) {
+            scale *= 10;
+        }
+        return ts * scale;
+    }
+    for (int i = 9; i < ifc.resol && i < 28; ++i) {
+        scale *= 10;
+    }
+    return ts / scale;
+}
+
+bool PcapReader::nextPcapng(PacketView& pkt)
+{
+    while (size_ - pos_ >= 12) {
+        size_t off = pos_;
+        uint32_t type;
+        memcpy(&type, map_ + off, sizeof(type));
+
+        // SHB的类型值与字节序无关，块长度要等读出字节序标记之后才能解释
+        if (type == PCAPNG_SHB) {
+            if (!parseSectionHeader(off)) {
+                return false;
+            }
+        } else {
+            type = fix32(type);
+        }
+
+        uint32_t blockLen = load32(off + 4);
+        if (blockLen < (type == PCAPNG_SHB ? 28u : 12u) || (blockLen & 3) || blockLen > size_ - off) {
+            return false;
+        }
+        pos_ += blockLen;
+
+        if (type == PCAPNG_IDB) {
+            if (!parseInterface(off, blockLen)) {
+                return false;
+            }
+        } else if (type == PCAPNG_EPB) {
+            if (blockLen < 32) {
+                return false;
+            }
+            uint32_t ifId = load32(off + 8);
+            uint32_t capLen = load32(off + 20);
+            if (ifId >= interfaces_.size() || capLen > blockLen - 32) {
+                return false;
+            }
+            const Interface& ifc = interfaces_[ifId];
+            uint64_t ts = (uint64_t)load32(off + 12) << 32 | load32(off + 16);
+
+            pkt.tsNs = lastTsNs_ = toNs(ifc, ts);
+            pkt.capLen = capLen;
+            pkt.len = load32(off + 24);
+            pkt.data = map_ + off + 28;
+            pkt.linktype = ifc.linktype;
+            return true;
+        } else if (type == PCAPNG_SPB) {
+            if (blockLen < 16 || interfaces_.empty()) {
+                return false;
+            }
+            uint32_t len = load32(off + 8);
+            uint32_t room = blockLen - 16;
+
+            pkt.tsNs = lastTsNs_;
+            pkt.capLen = len < room ? len : room;
+            pkt.len = len;
+            pkt.data = map_ + off + 12;
+            pkt.linktype = interfaces_[0].linktype;
+            return true;
+        }
+        // 其它块（名称解析、统计、自定义块等）直接跳过
+    }
+
+    return false;
+}
+
+// IPv6扩展头：跳过后才能找到传输层
+static bool isIpv6ExtHeader(uint8_t next)
+{
+    return next == 0 || next == 43 || next == 44 || next == 60;
+}
+
+bool parsePacket(const PacketView& pkt, PacketTuple& tuple)
+{
+    const uint8_t* p = pkt.data;
+    const uint8_t* end = pkt.data + pkt.capLen;
+    uint16_t etherType;
+
+    switch (pkt.linktype) {
+    case PCAP_LINKTYPE_ETHERNET:
+        if (end - p < 14) {
+            return false;
+        }
+        etherType = (uint16_t)(p[12] << 8 | p[13]);
+        p += 14;
+        // 802.1Q/802.1ad，可能有多层
+        while ((etherType == 0x8100 || etherType == 0x88a8) && end - p >= 4) {
+            etherType = (uint16_t)(p[2] << 8 | p[3]);
+            p += 4;
+        }
+        break;
+    case PCAP_LINKTYPE_LINUX_SLL:
+        if (end - p < 16) {
+            return false;
+        }
+        etherType = (uint16_t)(p[14] << 8 | p[15]);
+        p += 16;
+        break;
+    case PCAP_LINKTYPE_RAW:
+        if (end - p < 1) {
+            return false;
+        }
+        etherType = (p[0] >> 4) == 6 ? 0x86dd : 0x0800;
+        break;
+    case PCAP_LINKTYPE_IPV4:
+        etherType = 0x0800;
+        break;
+    case PCAP_LINKTYPE_IPV6:
+        etherType = 0x86dd;
+        break;
+    default:
+        return false;
+    }
+
+    const uint8_t* l4;
+    if (etherType == 0x0800) {
+        if (end - p < 20 || (p[0] >> 4) != 4) {
+            return false;
+        }
+        int ihl = (p[0] & 0x0f) * 4;
+        // 非首分片没有传输层头
+        if (ihl < 20 || end - p < ihl || ((p[6] & 0x1f) | p[7]) != 0) {
+            return false;
+        }
+        tuple.family = AF_INET;
+        tuple.proto = p[9];
+        tuple.srcAddr = p + 12;
+        tuple.dstAddr = p + 16;
+        l4 = p + ihl;
+    } else if (etherType == 0x86dd) {
+        if (end - p < 40 || (p[0] >> 4) != 6) {
+            return false;
+        }
+        tuple.family = AF_INET6;
+        tuple.srcAddr = p + 8;
+        tuple.dstAddr = p + 24;
+
+        uint8_t next = p[6];
+        l4 = p + 40;
+        while (isIpv6ExtHeader(next)) {
+            if (end - l4 < 8) {
+                return false;
+            }
+            // 分片头长度固定8字节，非首分片没有传输层头
+            if (next == 44 && ((l4[2] << 8 | l4[3]) & 0xfff8) != 0) {
+                return false;
+            }
+            size_t extLen = next == 44 ? 8 : (size_t)(l4[1] + 1) * 8;
+            next = l4[0];
+            if ((size_t)(end - l4) < extLen) {
+                return false;
+            }
+            l4 += extLen;
+        }
+        tuple.proto = next;
+    } else {
+        return false;
+    }
+
+    if ((tuple.proto != IPPROTO_TCP && tuple.proto != IPPROTO_UDP) || end - l4 < 4) {
+        return false;
+    }
+    tuple.srcPort = (uint16_t)(l4[0] << 8 | l4[1]);
+    tuple.dstPort = (uint16_t)(l4[2] << 8 | l4[3]);
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef PCAP_READER_H
+#define PCAP_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 不依赖libpcap的离线抓包文件读取：mmap整个文件，支持经典pcap和pcapng，
+// 返回的数据包直接指向映射区域，不做拷贝。
+
+// 链路层类型（LINKTYPE_*）
+enum {
+    PCAP_LINKTYPE_ETHERNET = 1,
+    PCAP_LINKTYPE_RAW = 101,
+    PCAP_LINKTYPE_LINUX_SLL = 113,
+    PCAP_LINKTYPE_IPV4 = 228,
+    PCAP_LINKTYPE_IPV6 = 229
+};
+
+// 一个数据包，data在PcapReader关闭前有效
+struct PacketView {
+    uint64_t tsNs;          // 时间戳（纳秒）
+    const uint8_t* data;
+    uint32_t capLen;        // 实际捕获的长度
+    uint32_t len;           // 线路上的原始长度
+    uint32_t linktype;
+};
+
+// 从数据包中解析出的五元组，地址指向数据包内部
+struct PacketTuple {
+    int family;             // AF_INET或AF_INET6
+    const uint8_t* srcAddr;
+    const uint8_t* dstAddr;
+    uint16_t srcPort;
+    uint16_t dstPort;
+    uint8_t proto;
+};
+
+class PcapReader {
+public:
+    PcapReader();
+    ~PcapReader();
+
+    // 打开并识别文件格式，失败时err中为错误信息
+    bool open(const char* path, std::string& err);
+    void close();
+
+    // 读取下一个数据包，文件结束或遇到损坏的记录时返回false
+    bool next(PacketView& pkt);
+
+    bool isPcapng() const { return pcapng_; }
+    size_t fileSize() const { return size_; }
+
+    // next()返回false后，文件是否被完整读完（否则为截断或损坏）
+    bool finished() const { return pos_ >= size_; }
+
+private:
+    uint16_t fix16(uint16_t v) const { return swap_ ? __builtin_bswap16(v) : v; }
+    uint32_t fix32(uint32_t v) const { return swap_ ? __builtin_bswap32(v) : v; }
+    uint16_t load16(size_t off) const;
+    uint32_t load32(size_t off) const;
+
+    bool nextPcap(PacketView& pkt);
+    bool nextPcapng(PacketView& pkt);
+    bool parseSectionHeader(size_t off);
+    bool parseInterface(size_t off, uint32_t blockLen);
+
+    // pcapng的接口描述：链路类型和时间戳精度
+    struct Interface {
+        uint32_t linktype;
+        bool binaryResol;   // if_tsresol的最高位：2的负幂
+        uint8_t resol;      // 10^-resol或2^-resol秒
+    };
+    uint64_t toNs(const Interface& ifc, uint64_t ts) const;
+
+    const uint8_t* map_;
+    size_t size_;
+    size_t pos_;
+    bool swap_;
+    bool pcapng_;
+    bool nanosecond_;       // 经典pcap：纳秒精度的magic
+    uint32_t linktype_;     // 经典pcap：全局链路类型
+    uint64_t lastTsNs_;     // pcapng的简单数据包块没有时间戳，沿用上一个
+    std::vector<Interface> interfaces_;
+};
+
+// 零拷贝解析以太网/VLAN/Linux SLL/原始IP链路层上的IPv4/IPv6 TCP/UDP头部
+// 非TCP/UDP、IPv4非首分片或长度不足时返回false
+bool parsePacket(const PacketView& pkt, PacketTuple& tuple);
+
+#endif
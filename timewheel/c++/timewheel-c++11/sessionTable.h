@@ -0,0 +1,300 @@
+#ifndef SESSION_TABLE_H
+#define SESSION_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <utility>
+
+/*
+ * 渐进式rehash的链式哈希表，用作会话表。
+ *
+ * 会话数随流量上涨时哈希表要扩容；一次性把几百万个会话搬到新表会在持有CTimeWheel::mtx时
+ * 停顿几十毫秒，期间所有数据包都在等锁。这里扩容时同时保留新旧两张表：每次查找/插入/删除
+ * 顺带把旧表的rehashStep个bucket搬到新表，查找在两张表中都找，旧表搬空后释放。
+ * 表的大小在装载因子到1时翻倍，新表容量是旧表两倍，旧表在新表装满之前一定已经搬完，
+ * 任何时候最多只有两张表，每次操作多做的工作有固定上限。
+ *
+ * 节点保存哈希值，搬迁时不重新计算；bucket数组用calloc分配，大数组由mmap得到内核的零页，
+ * 分配时不清零，缺页分摊到之后的访问中。
+ * 已知会话规模时用reserve()（或构造函数的hint）预先分配，上涨过程中不会扩容。
+ */
+template <typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K> >
+class SessionTable
+{
+public:
+	/*每次操作默认搬迁的bucket数*/
+	static const size_t DEFAULT_REHASH_STEP = 4;
+
+	explicit SessionTable(size_t hint = 0)
+		: size_(0), rehashIdx_(0), rehashStep_(DEFAULT_REHASH_STEP)
+	{
+		tables_[0].init(bucketsFor(hint));
+		tables_[1].init(0);
+	}
+
+	~SessionTable()
+	{
+		clear();
+		tables_[0].release();
+		tables_[1].release();
+	}
+
+	SessionTable(const SessionTable&) = delete;
+	SessionTable& operator=(const SessionTable&) = delete;
+
+	/*查找，返回值的指针，不存在时返回NULL；指针在下一次插入或删除前有效*/
+	V* find(const K& key)
+	{
+		rehashSome();
+		Node* n = lookup(key, hasher_(key));
+		return n ? &n->value : NULL;
+	}
+
+	/*插入，key已存在时不修改并返回false*/
+	bool insert(const K& key, const V& value)
+	{
+		size_t h = hasher_(key);
+
+		rehashSome();
+		if (lookup(key, h) != NULL)
+		{
+			return false;
+		}
+		if (!rehashing() && size_ >= tables_[0].buckets())
+		{
+			startRehash(tables_[0].buckets() * 2);
+		}
+
+		// 扩容期间新节点直接进新表
+		Table& t = tables_[rehashing() ? 1 : 0];
+		Node* n = new Node(key, value, h);
+		Node*& head = t.slot[h & t.mask];
+		n->next = head;
+		head = n;
+		size_++;
+		return true;
+	}
+
+	bool erase(const K& key)
+	{
+		size_t h = hasher_(key);
+
+		rehashSome();
+		for (int i = 0; i < (rehashing() ? 2 : 1); ++i)
+		{
+			Table& t = tables_[i];
+			if (i == 0 && rehashing() && (h & t.mask) < rehashIdx_)
+			{
+				// 这个bucket已经搬走
+				continue;
+			}
+			for (Node** pp = &t.slot[h & t.mask]; *pp != NULL; pp = &(*pp)->next)
+			{
+				Node* n = *pp;
+				if (n->hash == h && eq_(n->key, key))
+				{
+					*pp = n->next;
+					delete n;
+					size_--;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	/*预先分配能容纳n个元素的bucket，之后增长到n个元素不再扩容；正在扩容时先搬完*/
+	void reserve(size_t n)
+	{
+		size_t want = bucketsFor(n);
+		finishRehash();
+		if (want <= tables_[0].buckets())
+		{
+			return;
+		}
+		if (size_ == 0)
+		{
+			tables_[0].release();
+			tables_[0].init(want);
+			return;
+		}
+		startRehash(want);
+	}
+
+	/*每次操作搬迁的bucket数，0表示一次搬完（即通常的一次性rehash）*/
+	void setRehashStep(size_t step)
+	{
+		rehashStep_ = step;
+	}
+
+	void clear()
+	{
+		for (int i = 0; i < 2; ++i)
+		{
+			Table& t = tables_[i];
+			for (size_t b = 0; b < t.buckets(); ++b)
+			{
+				for (Node* n = t.slot[b], *next; n != NULL; n = next)
+				{
+					next = n->next;
+					delete n;
+				}
+				t.slot[b] = NULL;
+			}
+		}
+		if (rehashing())
+		{
+			// 元素都已删除，保留较大的新表
+			tables_[0].release();
+			tables_[0] = tables_[1];
+			tables_[1].init(0);
+		}
+		size_ = 0;
+		rehashIdx_ = 0;
+	}
+
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	bool rehashing() const { return tables_[1].slot != NULL; }
+
+	/*当前（扩容期间为新表）的bucket数*/
+	size_t bucketCount() const
+	{
+		return tables_[rehashing() ? 1 : 0].buckets();
+	}
+
+private:
+	struct Node
+	{
+		Node(const K& k, const V& v, size_t h) : next(NULL), hash(h), key(k), value(v) {}
+
+		Node* next;
+		size_t hash;
+		K key;
+		V value;
+	};
+
+	struct Table
+	{
+		Node** slot;
+		size_t mask;
+
+		void init(size_t n)
+		{
+			mask = n ? n - 1 : 0;
+			slot = NULL;
+			if (n && (slot = (Node**)calloc(n, sizeof(Node*))) == NULL)
+			{
+				throw std::bad_alloc();
+			}
+		}
+
+		void release()
+		{
+			free(slot);
+			slot = NULL;
+			mask = 0;
+		}
+
+		size_t buckets() const { return slot ? mask + 1 : 0; }
+	};
+
+	enum { MIN_BUCKETS = 16 };
+
+	/*装载因子为1时n个元素需要的bucket数，2的幂*/
+	static size_t bucketsFor(size_t n)
+	{
+		size_t b = MIN_BUCKETS;
+		while (b < n)
+		{
+			b <<= 1;
+		}
+		return b;
+	}
+
+	Node* lookup(const K& key, size_t h)
+	{
+		for (int i = 0; i < (rehashing() ? 2 : 1); ++i)
+		{
+			const Table& t = tables_[i];
+			if (i == 0 && rehashing() && (h & t.mask) < rehashIdx_)
+			{
+				continue;
+			}
+			for (Node* n = t.slot[h & t.mask]; n != NULL; n = n->next)
+			{
+				if (n->hash == h && eq_(n->key, key))
+				{
+					return n;
+				}
+			}
+		}
+		return NULL;
+	}
+
+	void startRehash(size_t buckets)
+	{
+		tables_[1].init(buckets);
+		rehashIdx_ = 0;
+		if (rehashStep_ == 0)
+		{
+			finishRehash();
+		}
+	}
+
+	void rehashSome()
+	{
+		if (rehashing())
+		{
+			migrate(rehashStep_ ? rehashStep_ : tables_[0].buckets());
+		}
+	}
+
+	void finishRehash()
+	{
+		if (rehashing())
+		{
+			migrate(tables_[0].buckets());
+		}
+	}
+
+	/*把旧表接下来的count个bucket搬到新表，搬空后新表取代旧表*/
+	void migrate(size_t count)
+	{
+		Table& from = tables_[0];
+		Table& to = tables_[1];
+		size_t end = rehashIdx_ + count < from.buckets() ? rehashIdx_ + count : from.buckets();
+
+		for (; rehashIdx_ < end; ++rehashIdx_)
+		{
+			for (Node* n = from.slot[rehashIdx_], *next; n != NULL; n = next)
+			{
+				next = n->next;
+				Node*& head = to.slot[n->hash & to.mask];
+				n->next = head;
+				head = n;
+			}
+			from.slot[rehashIdx_] = NULL;
+		}
+		if (rehashIdx_ == from.buckets())
+		{
+			from.release();
+			from = to;
+			to.slot = NULL;
+			to.mask = 0;
+			rehashIdx_ = 0;
+		}
+	}
+
+	Table tables_[2];       // 扩容期间[0]为旧表，[1]为新表，否则只用[0]
+	size_t size_;
+	size_t rehashIdx_;      // 旧表中下一个要搬迁的bucket，之前的都已搬走
+	size_t rehashStep_;
+	Hash hasher_;
+	Eq eq_;
+};
+
+#endif
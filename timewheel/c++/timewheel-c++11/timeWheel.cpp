@@ -1,6 +1,39 @@
 #include "timeWheel.h"
 
+ConnectionMap keyMap;
+uint64_t timeoutNum = 0;
+
 int CTimeWheel::state = 0;
+bool CTimeWheel::verbose = true;
+
+Entry::~Entry()
+{
+	if(CTimeWheel::verbose)
+	{
+		std::cout <<"use_count is "<<sharedKey.use_count();
+	}
+	if(sharedKey.use_count()>0)
+	{
+		if(CTimeWheel::verbose)
+		{
+			std::cout <<" element timeout! index is "<<timeoutNum;
+			std::cout <<" Stats: up="<<sharedKey->stats.upBytes<<"B/"<<sharedKey->stats.upPackets<<"pkts";
+			std::cout <<" down="<<sharedKey->stats.downBytes<<"B/"<<sharedKey->stats.downPackets<<"pkts"<<std::endl;
+		}
+
+		Sessionkey* pKey = sharedKey.get();
+
+		//从keyMap删除元素
+		keyMap.erase(*pKey);
+
+		if(hostLinks != NULL)
+		{
+			hostIndex->unlink(hostLinks);
+		}
+
+		timeoutNum++;
+	}
+}
 
 void *tickStepThreadGlobal(void* param)
 {
@@ -12,15 +45,26 @@ void *tickStepThreadGlobal(void* param)
 
 void CTimeWheel::tickStepRun()
 {
-	while(1)
+	// 按单调时钟推进：sleep可能睡过头，按实际经过的秒数补齐tick，时间轮不会越走越慢
+	wheel_ticks_t ticks;
+	wheel_ticks_init(&ticks, wheel_clock_ns(), 1000000000ULL);
+
+	std::unique_lock<std::mutex> lock(mtx);
+	while(!stopping_)
 	{
+		uint32_t now = wheel_ticks_from_ns(&ticks, wheel_clock_ns());
+		tickLateNs_ = wheel_clock_ns() - wheel_ticks_to_ns(&ticks, now);
+		advanceLocked(now);
+		tickLateNs_ = 0;
+
+		// 等到下一个tick的截止时间，stop()会提前唤醒
+		uint64_t cur = wheel_clock_ns();
+		uint64_t next = wheel_ticks_to_ns(&ticks, now + 1);
+		if (next > cur)
 		{
-			std::lock_guard<std::mutex> lock(mtx);
-			sessionKeyBuckets.push_back(Bucket());
+			stopCond_.wait_for(lock, std::chrono::nanoseconds(next - cur));
 		}
 
-		sleep(1);
-
 		//VLOG(2)<<"tick step add 1";
 
 		//当前map中剩余的元素
@@ -31,11 +75,14 @@ void CTimeWheel::tickStepRun()
 
 void CTimeWheel::dumpSessionKeyBuckets()
 {
+	TimedLockGuard lock(mtx, metrics_);
+
 	int idx = 0;
 	for (weakSessionKeyList::const_iterator bucketI = sessionKeyBuckets.begin();bucketI != sessionKeyBuckets.end();++bucketI, ++idx)
 	{
 		const Bucket& bucket = *bucketI;
-		std::cout <<"index: "<<idx<<"  bucket set size is = "<<bucket.size() << std::endl;
+		std::cout <<"index: "<<idx<<(idx == latestBucketIndex() ? " (latest)" : "")
+				  <<"  bucket set size is = "<<bucket.size() << std::endl;
 		
 		for (Bucket::const_iterator it = bucket.begin();it != bucket.end();++it)
 		{
@@ -47,33 +94,278 @@ void CTimeWheel::dumpSessionKeyBuckets()
 
 
 CTimeWheel::CTimeWheel(int idleSeconds, void* timeoutQueue)
+{
+	init(idleSeconds, timeoutQueue, CLOCK_INTERNAL);
+}
+
+CTimeWheel::CTimeWheel()
+{
+	init(10, NULL, CLOCK_INTERNAL); // 默认10秒
+}
+
+CTimeWheel::CTimeWheel(int idleSeconds, void* timeoutQueue, ClockMode mode)
+{
+	init(idleSeconds, timeoutQueue, mode);
+}
+
+void CTimeWheel::init(int idleSeconds, void* timeoutQueue, ClockMode mode)
 {
 	timeoutSessionQueue = timeoutQueue;
+	clockMode_ = mode;
+	lazyRefresh_ = false;
+	currentTick_ = 0;
+	started_ = false;
+	stopping_ = false;
+	threadRunning_ = false;
+	metrics_ = wheel_metrics_create("c++11");
+	tickLateNs_ = 0;
+	timerFd_ = -1;
+	fdTick_ = 0;
+
+	sessionKeyBuckets.resize(idleSeconds > 0 ? idleSeconds : 1);
+
+	if (mode == CLOCK_EXTERNAL)
+	{
+		return;
+	}
 
-	sessionKeyBuckets.resize(idleSeconds);
+	// tick线程的时间从0开始计数
+	started_ = true;
+	wheel_clock_source();
 
 	/*创建线程*/
 	if(pthread_create(&tickThread,NULL,tickStepThreadGlobal,this)!=0)
 	{
 		std::cout <<"create tickStepThreadGlobal thread failed!" << std::endl;
+		return;
 	}
+	threadRunning_ = true;
 }
 
-CTimeWheel::CTimeWheel()
+CTimeWheel::~CTimeWheel()
 {
-	timeoutSessionQueue = NULL;
-	sessionKeyBuckets.resize(10); // 默认10秒
-
-	/*创建线程*/
-	if(pthread_create(&tickThread,NULL,tickStepThreadGlobal,this)!=0)
+	stop();
+	// 会话析构时要从主机索引中移除，先于索引释放
+	sessionKeyBuckets.clear();
+	if (timerFd_ >= 0)
 	{
-		std::cout <<"create tickStepThreadGlobal thread failed!" << std::endl;
+		close(timerFd_);
 	}
+	wheel_metrics_destroy(metrics_);
+	metrics_ = NULL;
 }
 
-CTimeWheel::~CTimeWheel()
+void CTimeWheel::stop()
 {
+	if (!threadRunning_)
+	{
+		return;
+	}
+
+	{
+		TimedLockGuard lock(mtx, metrics_);
+		stopping_ = true;
+	}
+	stopCond_.notify_all();
+
 	pthread_join(tickThread,NULL);
+	threadRunning_ = false;
+}
+
+void CTimeWheel::setLazyRefresh(bool lazy)
+{
+	TimedLockGuard lock(mtx, metrics_);
+	lazyRefresh_ = lazy;
+}
+
+void CTimeWheel::start(uint64_t now)
+{
+	TimedLockGuard lock(mtx, metrics_);
+	currentTick_ = now;
+	started_ = true;
+}
+
+uint64_t CTimeWheel::advance(uint64_t now)
+{
+	TimedLockGuard lock(mtx, metrics_);
+	return advanceLocked(now);
+}
+
+uint64_t CTimeWheel::advanceLocked(uint64_t now)
+{
+	if (!started_)
+	{
+		currentTick_ = now;
+		started_ = true;
+		return 0;
+	}
+	if (now <= currentTick_)
+	{
+		return 0;
+	}
+
+	// 超过一圈的部分只会清空已经清空的bucket，直接跳过
+	uint64_t before = timeoutNum;
+	uint64_t size = sessionKeyBuckets.size();
+	if (now - currentTick_ > size)
+	{
+		currentTick_ = now - size;
+	}
+
+	// 进入新的tick时清空它对应的bucket：其中的会话已经idleSeconds个tick没有刷新。
+	// Entry析构时从keyMap删除，因此在持锁状态下清空
+	while (currentTick_ < now)
+	{
+		++currentTick_;
+		Bucket& bucket = sessionKeyBuckets[latestBucketIndex()];
+		uint64_t start = wheel_clock_ns();
+		uint64_t expired = timeoutNum;
+		size_t occupancy = bucket.size();
+
+		// 延迟刷新过的会话移到最后一次刷新的tick对应的bucket，该bucket要到lastSeen + size才清空。
+		// 立即刷新的会话lastSeen就是所在bucket的tick，这里只多一次比较。
+		// lastSeen不早于当前tick只可能是start()把时钟往回调了，按超时处理，避免插入正在遍历的bucket
+		for (Bucket::iterator it = bucket.begin(); it != bucket.end();)
+		{
+			const EntryPtr& entry = *it;
+			if (entry->lastSeen + size > currentTick_ && entry->lastSeen < currentTick_)
+			{
+				entry->bucketIndex = (int)(entry->lastSeen % size);
+				sessionKeyBuckets[entry->bucketIndex].insert(entry);
+				it = bucket.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		bucket.clear();
+
+		// 超时延迟：bucket应在tick起点清空，追赶多个tick时越早的tick越晚
+		expired = timeoutNum - expired;
+		wheel_metrics_slot(metrics_, occupancy);
+		wheel_metrics_count(metrics_, WHEEL_METRIC_EXPIRE, expired);
+		wheel_metrics_count(metrics_, WHEEL_METRIC_TICK, 1);
+		wheel_metrics_record(metrics_, WHEEL_HIST_LATENESS,
+		                     (now - currentTick_) * 1000000000ULL + tickLateNs_, expired);
+		wheel_metrics_record(metrics_, WHEEL_HIST_TICK, wheel_clock_ns() - start, 1);
+	}
+
+	return timeoutNum - before;
+}
+
+int CTimeWheel::timerFd()
+{
+	if (clockMode_ != CLOCK_EXTERNAL)
+	{
+		return -1;
+	}
+
+	wheel_clock_source();
+	TimedLockGuard lock(mtx, metrics_);
+	if (timerFd_ < 0 && (timerFd_ = wheel_timerfd_create()) >= 0)
+	{
+		// tick即CLOCK_MONOTONIC的秒数，第t个tick的截止时间为t秒
+		if (!started_)
+		{
+			currentTick_ = wheel_clock_mono_ns() / NS_PER_SEC;
+			started_ = true;
+		}
+		rearmLocked();
+	}
+	return timerFd_;
+}
+
+uint64_t CTimeWheel::processExpired(uint64_t nowNs)
+{
+	bool fired = timerFd_ >= 0 && wheel_timerfd_ack(timerFd_) > 0;
+
+	TimedLockGuard lock(mtx, metrics_);
+	uint64_t now = nowNs / NS_PER_SEC;
+	// fd到期时至少推进到它定的tick，否则会把已经过去的截止时间重新定上，fd一直可读
+	if (fired && fdTick_ > now)
+	{
+		now = fdTick_;
+	}
+	uint64_t expired = advanceLocked(now);
+	rearmLocked();
+	return expired;
+}
+
+uint64_t CTimeWheel::nextExpiryLocked() const
+{
+	// 第t个tick清空bucket[t % size]，从下一个tick起找第一个非空的bucket
+	uint64_t size = sessionKeyBuckets.size();
+	for (uint64_t i = 1; i <= size; ++i)
+	{
+		if (!sessionKeyBuckets[(currentTick_ + i) % size].empty())
+		{
+			return currentTick_ + i;
+		}
+	}
+	return 0;
+}
+
+void CTimeWheel::rearmLocked()
+{
+	fdTick_ = nextExpiryLocked();
+	if (fdTick_ == 0)
+	{
+		wheel_timerfd_disarm(timerFd_);
+	}
+	else
+	{
+		wheel_timerfd_arm(timerFd_, fdTick_ * NS_PER_SEC);
+	}
+}
+
+void CTimeWheel::catchUpLocked()
+{
+	// 事件循环只在有会话超时的tick醒来，其间currentTick_停在上次处理的位置，
+	// 先追上实际时间，新建和刷新的会话才落在正确的bucket
+	if (timerFd_ < 0)
+	{
+		return;
+	}
+	uint64_t now = wheel_clock_mono_ns() / NS_PER_SEC;
+	if (now > currentTick_)
+	{
+		advanceLocked(now);
+		rearmLocked();
+	}
+}
+
+uint64_t CTimeWheel::currentTick()
+{
+	TimedLockGuard lock(mtx, metrics_);
+	return currentTick_;
+}
+
+size_t CTimeWheel::sessionCount()
+{
+	TimedLockGuard lock(mtx, metrics_);
+	return keyMap.size();
+}
+
+void CTimeWheel::snapshotMetrics(wheel_metrics_snapshot_t* snap) const
+{
+	wheel_metrics_snapshot(metrics_, snap);
+}
+
+void CTimeWheel::dumpMetrics(FILE* fp, bool json) const
+{
+	wheel_metrics_snapshot_t* snap = new wheel_metrics_snapshot_t;
+	snapshotMetrics(snap);
+	if (json)
+	{
+		wheel_metrics_dump_json(fp, snap);
+	}
+	else
+	{
+		wheel_metrics_dump_text(fp, snap);
+	}
+	delete snap;
 }
 
 
@@ -83,30 +375,30 @@ CTimeWheel::~CTimeWheel()
 *查找成功,返回true
 */
 
-bool CTimeWheel::checkElementExit(const Sessionkey& key)
+weakEntryPtr* CTimeWheel::findSessionLocked(const Sessionkey& key)
 {
-	MapIterType ite;
-	Sessionkey reverKey(key.dstIp,key.srcIp,
-						key.dstPort,key.srcPort, key.protocol);
-
 	//正向查找
-	ite = keyMap.find(key);
-	if(ite == keyMap.end())
+	weakEntryPtr* ctx = keyMap.find(key);
+	if(ctx == NULL)
 	{
 		//反向查找
-		ite = keyMap.find(reverKey);
-		if(ite == keyMap.end())
-		{
-			//元素第一次加入
-			return false;
-		}
+		Sessionkey reverKey(key.srcIp, key.dstIp, key.srcPort, key.dstPort, key.protocol);
+		ctx = keyMap.find(reverKey);
 	}
+	return ctx;
+}
 
-	Sessionkey rawkey = ite->first;
+bool CTimeWheel::checkElementExit(const Sessionkey& key)
+{
+	weakEntryPtr* ctx = findSessionLocked(key);
+	if(ctx == NULL)
+	{
+		//元素第一次加入
+		return false;
+	}
 
 	// 如果找到元素，将其移动到最新的bucket中
-	weakEntryPtr weakEntry = rawkey.context;
-	EntryPtr entry = weakEntry.lock();
+	EntryPtr entry = ctx->lock();
 	if(entry)
 	{
 		moveEntryToLatestBucket(entry, entry->bucketIndex);
@@ -117,75 +409,148 @@ bool CTimeWheel::checkElementExit(const Sessionkey& key)
 
 bool CTimeWheel::AddElement(const Sessionkey& rawKey)
 {
-	std::lock_guard<std::mutex> lock(mtx);
+	TimedLockGuard lock(mtx, metrics_);
+	catchUpLocked();
+	return addElementLocked(rawKey);
+}
 
+bool CTimeWheel::addElementLocked(const Sessionkey& rawKey)
+{
 	//如果元素已存在，则更新map中元素
 	if(true == checkElementExit(rawKey))
 	{
 		return false;
 	}
 
+	insertElementLocked(rawKey);
+	return true;
+}
+
+void CTimeWheel::insertElementLocked(const Sessionkey& rawKey)
+{
+	wheel_metrics_count(metrics_, WHEEL_METRIC_INSERT, 1);
+
 	sessionkeyPtr sharedEntryPtr(new Sessionkey(rawKey));
 
-	int currentBucketIdx = sessionKeyBuckets.size() - 1;
-	EntryPtr entry(new Entry(sharedEntryPtr, currentBucketIdx));
+	int currentBucketIdx = latestBucketIndex();
+	EntryPtr entry(new Entry(sharedEntryPtr, currentBucketIdx, currentTick_));
 
-	//将entry添加到当前时间轮尾部的bucket中
-	sessionKeyBuckets.back().insert(entry);
+	//将entry添加到当前tick对应的bucket中
+	sessionKeyBuckets[currentBucketIdx].insert(entry);
 
 	// 创建弱引用并设置到key中
 	weakEntryPtr weakEntry(entry);
 	sharedEntryPtr->setContext(weakEntry);
 
-	// 使用shared_ptr作为key
-	keyMap.insert(std::pair<Sessionkey,int>(*sharedEntryPtr,100));
+	keyMap.insert(*sharedEntryPtr, weakEntry);
 
-	return true;
+	if(hostIndex_)
+	{
+		indexEntryLocked(entry.get());
+	}
+
+	// 新会话在最新的bucket，超时不会早于已定的时间，只有时间轮原来为空时才需要定时
+	if (timerFd_ >= 0 && fdTick_ == 0)
+	{
+		rearmLocked();
+	}
 }
 
 // 移动entry到最新的bucket（优化版，避免遍历所有bucket）
 void CTimeWheel::moveEntryToLatestBucket(EntryPtr& entry, int currentBucketIdx)
 {
-	if (currentBucketIdx >= 0 && currentBucketIdx < sessionKeyBuckets.size())
+	wheel_metrics_count(metrics_, WHEEL_METRIC_REFRESH, 1);
+
+	entry->lastSeen = currentTick_;
+	if (lazyRefresh_)
+	{
+		// bucket到期时再移动，见advanceLocked
+		return;
+	}
+
+	int newBucketIdx = latestBucketIndex();
+	if (currentBucketIdx == newBucketIdx)
+	{
+		// 本tick内已经刷新过
+		return;
+	}
+
+	if (currentBucketIdx >= 0 && currentBucketIdx < (int)sessionKeyBuckets.size())
 	{
 		// 从当前bucket中移除
 		sessionKeyBuckets[currentBucketIdx].erase(entry);
 	}
 
 	// 添加到最新的bucket中
-	int newBucketIdx = sessionKeyBuckets.size() - 1;
-	sessionKeyBuckets.back().insert(entry);
+	sessionKeyBuckets[newBucketIdx].insert(entry);
 	entry->bucketIndex = newBucketIdx;
 }
 
 // 更新会话：接收到数据后更新生命周期和统计信息
 bool CTimeWheel::UpdateSession(const Sessionkey& key, bool isUplink, uint64_t bytes, uint64_t packets)
 {
-	std::lock_guard<std::mutex> lock(mtx);
+	TimedLockGuard lock(mtx, metrics_);
+	catchUpLocked();
 
-	MapIterType ite;
-	Sessionkey reverKey(key.dstIp, key.srcIp, key.dstPort, key.srcPort, key.protocol);
+	bool created;
+	return updateSessionLocked(key, isUplink, bytes, packets, created);
+}
 
-	//正向查找
-	ite = keyMap.find(key);
-	if(ite == keyMap.end())
+// 批量更新会话：数据包按批处理时分摊加锁开销
+size_t CTimeWheel::UpdateSessions(const SessionUpdate* updates, size_t num)
+{
+	TimedLockGuard lock(mtx, metrics_);
+	catchUpLocked();
+
+	size_t createdNum = 0;
+	for(size_t i = 0; i < num; ++i)
 	{
-		//反向查找
-		ite = keyMap.find(reverKey);
-		if(ite == keyMap.end())
+		bool created;
+		const SessionUpdate& u = updates[i];
+		updateSessionLocked(u.key, u.isUplink, u.bytes, u.packets, created);
+		createdNum += created;
+	}
+
+	return createdNum;
+}
+
+bool CTimeWheel::updateSessionLocked(const Sessionkey& key, bool isUplink, uint64_t bytes, uint64_t packets,
+                                     bool& created)
+{
+	created = false;
+
+	weakEntryPtr* ctx = findSessionLocked(key);
+	if(ctx == NULL)
+	{
+		// 元素不存在，先添加（正反向都已查过，无需再检查）
+		Sessionkey newKey = key;
+		if(admission_)
+		{
+			SessionStats probation;
+			bool reversed;
+			if(!admission_->offer(key, isUplink, bytes, packets, currentTick_, probation, reversed))
+			{
+				// 仍在试用期
+				return false;
+			}
+			if(reversed)
+			{
+				// 会话按流的第一个包的方向建立
+				newKey = Sessionkey(key.srcIp, key.dstIp, key.srcPort, key.dstPort, key.protocol);
+			}
+			newKey.stats = probation;
+		}
+		else
 		{
-			// 元素不存在，先添加
-			Sessionkey newKey = key;
 			newKey.updateStats(isUplink, bytes, packets);
-			return AddElement(newKey);
 		}
+		insertElementLocked(newKey);
+		created = true;
+		return true;
 	}
 
-	Sessionkey rawkey = ite->first;
-
 	// 更新统计信息
-	weakEntryPtr weakEntry = rawkey.context;
-	EntryPtr entry = weakEntry.lock();
+	EntryPtr entry = ctx->lock();
 	if(entry)
 	{
 		entry->sharedKey->updateStats(isUplink, bytes, packets);
@@ -200,26 +565,15 @@ bool CTimeWheel::UpdateSession(const Sessionkey& key, bool isUplink, uint64_t by
 // 获取会话统计信息
 bool CTimeWheel::GetSessionStats(const Sessionkey& key, SessionStats& stats)
 {
-	std::lock_guard<std::mutex> lock(mtx);
-
-	MapIterType ite;
-	Sessionkey reverKey(key.dstIp, key.srcIp, key.dstPort, key.srcPort, key.protocol);
+	TimedLockGuard lock(mtx, metrics_);
 
-	//正向查找
-	ite = keyMap.find(key);
-	if(ite == keyMap.end())
+	weakEntryPtr* ctx = findSessionLocked(key);
+	if(ctx == NULL)
 	{
-		//反向查找
-		ite = keyMap.find(reverKey);
-		if(ite == keyMap.end())
-		{
-			return false;
-		}
+		return false;
 	}
 
-	Sessionkey rawkey = ite->first;
-	weakEntryPtr weakEntry = rawkey.context;
-	EntryPtr entry = weakEntry.lock();
+	EntryPtr entry = ctx->lock();
 	if(entry)
 	{
 		stats = entry->sharedKey->stats;
@@ -227,4 +581,148 @@ bool CTimeWheel::GetSessionStats(const Sessionkey& key, SessionStats& stats)
 	}
 
 	return false;
+}
+
+void CTimeWheel::reserveSessions(size_t n)
+{
+	TimedLockGuard lock(mtx, metrics_);
+	keyMap.reserve(n);
+}
+
+void CTimeWheel::setAdmission(const AdmissionConfig& cfg)
+{
+	TimedLockGuard lock(mtx, metrics_);
+	admission_.reset(new AdmissionFilter(cfg));
+}
+
+void CTimeWheel::disableAdmission()
+{
+	TimedLockGuard lock(mtx, metrics_);
+	admission_.reset();
+}
+
+bool CTimeWheel::admissionStats(AdmissionStats& stats)
+{
+	TimedLockGuard lock(mtx, metrics_);
+	if(!admission_)
+	{
+		return false;
+	}
+	stats = admission_->stats(currentTick_);
+	return true;
+}
+
+void CTimeWheel::indexEntryLocked(Entry* entry)
+{
+	HostAddr src, dst;
+	if(HostAddr::parse(entry->sharedKey->srcIp, src) && HostAddr::parse(entry->sharedKey->dstIp, dst))
+	{
+		entry->hostIndex = hostIndex_.get();
+		entry->hostLinks = hostIndex_->link(entry, src, dst);
+	}
+}
+
+void CTimeWheel::enableHostIndex()
+{
+	TimedLockGuard lock(mtx, metrics_);
+	if(hostIndex_)
+	{
+		return;
+	}
+
+	hostIndex_.reset(new SessionHostIndex());
+	for(size_t i = 0; i < sessionKeyBuckets.size(); ++i)
+	{
+		for(Bucket::const_iterator it = sessionKeyBuckets[i].begin(); it != sessionKeyBuckets[i].end(); ++it)
+		{
+			indexEntryLocked(it->get());
+		}
+	}
+}
+
+void CTimeWheel::disableHostIndex()
+{
+	TimedLockGuard lock(mtx, metrics_);
+	if(!hostIndex_)
+	{
+		return;
+	}
+
+	for(size_t i = 0; i < sessionKeyBuckets.size(); ++i)
+	{
+		for(Bucket::const_iterator it = sessionKeyBuckets[i].begin(); it != sessionKeyBuckets[i].end(); ++it)
+		{
+			(*it)->hostIndex = NULL;
+			(*it)->hostLinks = NULL;
+		}
+	}
+	// 节点由索引统一释放
+	hostIndex_.reset();
+}
+
+size_t CTimeWheel::visitSessionsLocked(const HostPrefix& prefix, const std::function<void(Entry*)>& fn)
+{
+	if(hostIndex_)
+	{
+		return hostIndex_->forEach(prefix, fn);
+	}
+
+	// 没有索引：遍历全部会话并解析地址
+	size_t n = 0;
+	HostAddr src, dst;
+	for(size_t i = 0; i < sessionKeyBuckets.size(); ++i)
+	{
+		for(Bucket::const_iterator it = sessionKeyBuckets[i].begin(); it != sessionKeyBuckets[i].end(); ++it)
+		{
+			const Sessionkey& key = *(*it)->sharedKey;
+			if(!HostAddr::parse(key.srcIp, src) || !HostAddr::parse(key.dstIp, dst))
+			{
+				continue;
+			}
+			if(prefix.contains(src) || prefix.contains(dst))
+			{
+				fn(it->get());
+				n++;
+			}
+		}
+	}
+	return n;
+}
+
+size_t CTimeWheel::forEachSession(const std::string& prefix, const std::function<void(const Sessionkey&)>& fn)
+{
+	HostPrefix p;
+	if(!HostPrefix::parse(prefix, p))
+	{
+		return 0;
+	}
+
+	TimedLockGuard lock(mtx, metrics_);
+	return visitSessionsLocked(p, [&fn](Entry* entry) { fn(*entry->sharedKey); });
+}
+
+size_t CTimeWheel::removeSessions(const std::string& prefix)
+{
+	HostPrefix p;
+	if(!HostPrefix::parse(prefix, p))
+	{
+		return 0;
+	}
+
+	TimedLockGuard lock(mtx, metrics_);
+
+	// 遍历时不能修改索引，先收集；从bucket移除后Entry随matched一起析构
+	std::vector<EntryPtr> matched;
+	size_t n = visitSessionsLocked(p, [&matched](Entry* entry) { matched.push_back(entry->sharedKey->context.lock()); });
+	for(size_t i = 0; i < n; ++i)
+	{
+		sessionKeyBuckets[matched[i]->bucketIndex].erase(matched[i]);
+	}
+	matched.clear();
+
+	if(timerFd_ >= 0)
+	{
+		rearmLocked();
+	}
+	return n;
 }
\ No newline at end of file
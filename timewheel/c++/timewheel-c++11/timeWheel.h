@@ -10,7 +10,18 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <mutex>
+#include <condition_variable>
+#include <functional>
 #include <cstdint>
+#include <cstdio>
+
+#include "admissionFilter.h"
+#include "flow_hash.h"
+#include "hostIndex.h"
+#include "sessionTable.h"
+#include "wheel_clock.h"
+#include "wheel_metrics.h"
+#include "wheel_timerfd.h"
 
 /*全局函数声明*/
 void *tickStepThreadGlobal(void* param);
@@ -56,6 +67,8 @@ public:
     weakEntryPtr context; // 存储弱引用
     SessionStats stats;   // 会话统计信息
 
+    Sessionkey() : dstPort(0), srcPort(0), protocol(0) {}
+
     Sessionkey(const std::string& dst, const std::string& src, int dport, int sport, uint8_t proto = 6)
         : dstIp(dst), srcIp(src), dstPort(dport), srcPort(sport), protocol(proto) {}
 
@@ -92,54 +105,104 @@ public:
 typedef std::weak_ptr<Sessionkey> weakSessionKeyPtr;
 typedef std::shared_ptr<Sessionkey> sessionkeyPtr;
 
-typedef std::map<Sessionkey, int> ConnectionMap;
-typedef std::map<Sessionkey, int>::iterator MapIterType;
+// 会话表的哈希：按方向哈希五元组，反向的会话由调用方交换地址端口后再查一次
+struct SessionkeyHash {
+    size_t operator()(const Sessionkey& k) const {
+        uint64_t seed = (uint64_t)k.protocol << 32 | (uint64_t)(uint16_t)k.srcPort << 16 | (uint16_t)k.dstPort;
+        seed = hash_bytes(k.srcIp.data(), k.srcIp.size(), seed);
+        return (size_t)hash_bytes(k.dstIp.data(), k.dstIp.size(), seed);
+    }
+};
+
+// 五元组到会话Entry的弱引用，渐进式扩容，见sessionTable.h
+typedef SessionTable<Sessionkey, weakEntryPtr, SessionkeyHash> ConnectionMap;
+
+// 按源、目的主机地址的会话二级索引，见hostIndex.h
+typedef HostIndex<Entry> SessionHostIndex;
 
-static ConnectionMap keyMap;
-static uint64_t timeoutNum = 0;
+// 批量更新的一项，对应一次UpdateSession调用
+struct SessionUpdate {
+    Sessionkey key;
+    bool isUplink;
+    uint64_t bytes;
+    uint64_t packets;
+
+    SessionUpdate() : isUplink(true), bytes(0), packets(1) {}
+};
+
+// 所有时间轮共享的会话表和超时计数，定义在timeWheel.cpp
+extern ConnectionMap keyMap;
+extern uint64_t timeoutNum;
 
 /*Entry结构体,使用shared_ptr*/
 class Entry: public copyable
 {
 public:
-	explicit Entry(const sessionkeyPtr& Key, int bucketIdx = 0)
-		:sharedKey(Key), bucketIndex(bucketIdx)
+	explicit Entry(const sessionkeyPtr& Key, int bucketIdx = 0, uint64_t tick = 0)
+		:sharedKey(Key), bucketIndex(bucketIdx), lastSeen(tick), hostIndex(NULL), hostLinks(NULL)
 	{
 
 	}
 
-	/*删除元素*/
-	~Entry()
-	{
-		std::cout <<"use_count is "<<sharedKey.use_count();
-		if(sharedKey.use_count()>0)
-		{
-			std::cout <<" element timeout! index is "<<timeoutNum;
-			std::cout <<" Stats: up="<<sharedKey->stats.upBytes<<"B/"<<sharedKey->stats.upPackets<<"pkts";
-			std::cout <<" down="<<sharedKey->stats.downBytes<<"B/"<<sharedKey->stats.downPackets<<"pkts"<<std::endl;
+	/*删除元素：Entry随所在bucket一起析构，即会话超时*/
+	~Entry();
 
-			Sessionkey* pKey = sharedKey.get();
+	sessionkeyPtr sharedKey;
+	int bucketIndex;  // 记录当前所在的bucket索引，避免遍历所有bucket
+	uint64_t lastSeen;  // 最后一次刷新的tick，延迟刷新模式下可能晚于所在bucket
+	SessionHostIndex* hostIndex;         // 所在的主机索引，未加入时为NULL
+	SessionHostIndex::Links* hostLinks;  // 在主机索引中的节点，析构时移除
+};
 
-			//从keyMap删除元素
-			keyMap.erase(*pKey);
 
-			timeoutNum++;
+/*加锁并记录等待时间（未发生竞争时记为0），用法同std::lock_guard*/
+class TimedLockGuard
+{
+public:
+	TimedLockGuard(std::mutex& m, wheel_metrics_t* metrics)
+		:mtx_(m)
+	{
+		if (mtx_.try_lock())
+		{
+			wheel_metrics_record(metrics, WHEEL_HIST_LOCK_WAIT, 0, 1);
+			return;
 		}
+		uint64_t start = wheel_clock_ns();
+		mtx_.lock();
+		wheel_metrics_record(metrics, WHEEL_HIST_LOCK_WAIT, wheel_clock_ns() - start, 1);
 	}
 
-	sessionkeyPtr sharedKey;
-	int bucketIndex;  // 记录当前所在的bucket索引，避免遍历所有bucket
+	~TimedLockGuard()
+	{
+		mtx_.unlock();
+	}
+
+	TimedLockGuard(const TimedLockGuard&) = delete;
+	TimedLockGuard& operator=(const TimedLockGuard&) = delete;
+
+private:
+	std::mutex& mtx_;
 };
 
 
 class CTimeWheel
 {
 public:
+	/*时钟模式：内部tick线程按单调时钟推进，或由调用方通过advance()推进*/
+	enum ClockMode
+	{
+		CLOCK_INTERNAL,
+		CLOCK_EXTERNAL
+	};
+
 	CTimeWheel();
 	~CTimeWheel();
 
 	CTimeWheel(int idleSeconds, void* timeoutQueue);
 
+	/*外部时钟模式不创建tick线程，可由事件循环或pcap回放按数据包时间戳驱动*/
+	CTimeWheel(int idleSeconds, void* timeoutQueue, ClockMode mode);
+
 public:
 	typedef std::shared_ptr<Entry> EntryPtr;
 	typedef std::weak_ptr<Entry> weakEntryPtr;
@@ -147,6 +210,7 @@ public:
 	typedef std::unordered_set<EntryPtr> Bucket;
 	typedef std::vector<Bucket> weakSessionKeyList;
 
+	/*环形bucket：第t个tick刷新的会话放在[t % idleSeconds]，时间轮推进到t + idleSeconds时清空即超时*/
 	weakSessionKeyList   sessionKeyBuckets;
 
 	pthread_t tickThread;
@@ -162,18 +226,136 @@ public:
 	/*更新会话：接收到数据后更新生命周期和统计信息*/
 	bool UpdateSession(const Sessionkey& key, bool isUplink, uint64_t bytes, uint64_t packets = 1);
 
+	/*批量更新会话：整批只加一次锁，返回新创建的会话数*/
+	size_t UpdateSessions(const SessionUpdate* updates, size_t num);
+
 	/*获取会话统计信息*/
 	bool GetSessionStats(const Sessionkey& key, SessionStats& stats);
 
+	/*按预计的会话数预先分配会话表，会话数上涨到n之前不再扩容*/
+	void reserveSessions(size_t n);
+
+	/*启用会话准入过滤：未知流的数据包先进入试用表，满足cfg的条件（双向或累计N个包）后才创建会话，
+	  试用期间UpdateSession返回false、UpdateSessions不计入新建数；AddElement不经过滤。
+	  重复调用时换成新的试用表，原来试用中的流丢弃*/
+	void setAdmission(const AdmissionConfig& cfg);
+	void disableAdmission();
+
+	/*准入过滤的统计，未启用时返回false*/
+	bool admissionStats(AdmissionStats& stats);
+
+	/*启用按主机地址的二级索引（为已有的会话建立索引），之后新建会话时加入、超时或删除时移除。
+	  未启用时下面两个函数遍历全部会话；地址不是IPv4/IPv6的会话不进入索引，也不会被匹配*/
+	void enableHostIndex();
+	void disableHostIndex();
+
+	/*对源或目的地址在prefix（"10.0.0.0/24"、"10.0.0.5"、"2001:db8::/32"）内的每个会话调用一次fn，
+	  返回会话数，prefix无效时返回0。fn在持有mtx时调用，不能再调用时间轮的函数*/
+	size_t forEachSession(const std::string& prefix, const std::function<void(const Sessionkey&)>& fn);
+
+	/*删除源或目的地址在prefix内的所有会话，返回删除的会话数；与超时一样从会话表中删除（计入timeoutNum）*/
+	size_t removeSessions(const std::string& prefix);
+
 	/*存储定时器队列*/
 	void *timeoutSessionQueue;
 
 	static int state;
 
+	/*会话超时时是否打印统计信息，回放等批量场景可关闭*/
+	static bool verbose;
+
+	/*延迟刷新：刷新会话时只记录当前tick，不在bucket之间移动；所在bucket到期时
+	  若会话在此期间被刷新过，再移到最后一次刷新的tick对应的bucket。
+	  活跃的会话每个超时周期只移动一次，可随时切换*/
+	void setLazyRefresh(bool lazy);
+	bool lazyRefresh() const { return lazyRefresh_; }
+
+	/*设置起始tick（秒），外部时钟模式下未调用时由第一次advance()设置*/
+	void start(uint64_t now);
+
+	/*推进到now（秒），依次处理经过的每个tick，返回本次超时的会话数*/
+	uint64_t advance(uint64_t now);
+
+	/*停止并等待tick线程退出，可重复调用；外部时钟模式下为空操作*/
+	void stop();
+
+	/*事件循环模式（仅外部时钟模式）：返回一个timerfd，tick为CLOCK_MONOTONIC的秒数，始终定在下一个有会话
+	  超时的tick，没有会话时不定时。加入epoll（或在io_uring上POLL_ADD/READ），可读时调用
+	  processExpired(wheel_clock_mono_ns())，会话超时与数据包处理在同一个线程；更新会话时自动追上实际时间。
+	  fd归时间轮所有，析构时关闭；内部时钟模式或创建失败时返回-1*/
+	int timerFd();
+
+	/*推进到nowNs（CLOCK_MONOTONIC纳秒）所在的秒并重新定时，返回本次超时的会话数*/
+	uint64_t processExpired(uint64_t nowNs);
+
+	uint64_t currentTick();
+	size_t sessionCount();
+
+	/*运行时统计：插入/刷新/超时计数、每tick耗时、超时延迟、加锁等待时间，各线程分别计数，读取时合并*/
+	wheel_metrics_t* metrics() const { return metrics_; }
+	void snapshotMetrics(wheel_metrics_snapshot_t* snap) const;
+	void dumpMetrics(FILE* fp, bool json = false) const;
+
 private:
+	void init(int idleSeconds, void* timeoutQueue, ClockMode mode);
+
+	/*推进时间轮，调用方需持有mtx*/
+	uint64_t advanceLocked(uint64_t now);
+
+	/*添加元素，调用方需持有mtx（UpdateSession在持锁时添加新会话）*/
+	bool addElementLocked(const Sessionkey& keyPtr);
+
+	/*插入确定不存在的会话，调用方需持有mtx*/
+	void insertElementLocked(const Sessionkey& keyPtr);
+
+	/*更新会话，调用方需持有mtx；created返回是否新建了会话*/
+	bool updateSessionLocked(const Sessionkey& key, bool isUplink, uint64_t bytes, uint64_t packets,
+	                         bool& created);
+
+	/*下一个要清空非空bucket的tick，没有会话时为0；调用方需持有mtx*/
+	uint64_t nextExpiryLocked() const;
+
+	/*把timerfd定到nextExpiryLocked()，调用方需持有mtx*/
+	void rearmLocked();
+
+	/*事件循环模式下把时间轮推进到当前时间，调用方需持有mtx*/
+	void catchUpLocked();
+
+	/*把会话加入主机索引，调用方需持有mtx*/
+	void indexEntryLocked(Entry* entry);
+
+	/*对源或目的地址在prefix内的每个会话调用fn，有索引时查索引，否则遍历所有bucket；调用方需持有mtx*/
+	size_t visitSessionsLocked(const HostPrefix& prefix, const std::function<void(Entry*)>& fn);
+
+	/*正向查找，找不到时反向查找，返回会话Entry的弱引用，调用方需持有mtx*/
+	weakEntryPtr* findSessionLocked(const Sessionkey& key);
+
 	/*内部辅助函数：移动entry到最新bucket*/
 	void moveEntryToLatestBucket(EntryPtr& entry, int currentBucketIdx);
 
+	/*当前tick对应的bucket下标*/
+	int latestBucketIndex() const
+	{
+		return (int)(currentTick_ % sessionKeyBuckets.size());
+	}
+
+	ClockMode clockMode_;
+	bool lazyRefresh_;
+	uint64_t currentTick_;
+	bool started_;
+	bool stopping_;
+	bool threadRunning_;
+	std::condition_variable stopCond_;
+
+	wheel_metrics_t* metrics_;
+	uint64_t tickLateNs_;  // tick线程本次醒来相对tick起点的延迟，外部时钟模式下为0
+	int timerFd_;          // 事件循环模式的timerfd，未使用时为-1
+	uint64_t fdTick_;      // timerfd定在哪个tick，未定时为0
+	std::unique_ptr<AdmissionFilter> admission_;  // 准入过滤，未启用时为空
+	std::unique_ptr<SessionHostIndex> hostIndex_; // 主机索引，未启用时为空
+
+	static const uint64_t NS_PER_SEC = 1000000000ULL;
+
 public:
 	/*定时器线程*/
 	void tickStepRun();
@@ -0,0 +1,378 @@
+#ifndef CORO_WHEEL_H
+#define CORO_WHEEL_H
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include "timer_wheel.h"
+}
+#include "wheel_clock.h"
+
+// C++20协程接口：在C时间轮(timer_wheel_t)之上提供
+//   co_await wheel.sleep_for(100ms);
+//   std::optional<T> r = co_await wheel.with_timeout(task(), 500ms);
+// 定时器节点(timer_entry_t)嵌在co_await的等待对象中，等待对象位于协程帧里，每次等待不分配内存。
+// 到期的协程先在roll中挂到就绪链表，roll结束后由tick()按到期顺序批量恢复。
+// 协程帧被销毁（CoroTask析构、with_timeout超时）时，等待对象随之析构并把定时器从时间轮上摘掉。
+// 单线程使用：所有协程都在调用tick()/poll()的线程上运行。
+
+template <typename T = void>
+class CoroTask;
+
+struct CoroPromiseBase {
+    std::coroutine_handle<> continuation;   // co_await这个任务的协程，顶层任务为空
+    std::exception_ptr error;
+
+    // 执行完后把控制权直接交给等待者（对称转移），不会在恢复链上叠栈
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+        {
+            std::coroutine_handle<> c = h.promise().continuation;
+            return c ? c : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    // 惰性启动：由start()或co_await启动
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template <typename T>
+struct CoroPromise : CoroPromiseBase {
+    std::optional<T> value;
+
+    CoroTask<T> get_return_object();
+    template <typename U>
+    void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+    T result()
+    {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct CoroPromise<void> : CoroPromiseBase {
+    CoroTask<void> get_return_object();
+    void return_void() {}
+    void result()
+    {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+// 协程任务，独占协程帧
+template <typename T>
+class CoroTask {
+public:
+    typedef CoroPromise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    CoroTask() : h_() {}
+    explicit CoroTask(Handle h) : h_(h) {}
+    CoroTask(CoroTask&& o) noexcept : h_(std::exchange(o.h_, Handle())) {}
+    CoroTask& operator=(CoroTask&& o) noexcept
+    {
+        if (this != &o) {
+            reset();
+            h_ = std::exchange(o.h_, Handle());
+        }
+        return *this;
+    }
+    CoroTask(const CoroTask&) = delete;
+    CoroTask& operator=(const CoroTask&) = delete;
+    ~CoroTask() { reset(); }
+
+    // 销毁协程帧，挂起中的等待随之取消
+    void reset()
+    {
+        if (h_) {
+            h_.destroy();
+            h_ = Handle();
+        }
+    }
+    // 作为顶层任务启动，运行到第一次挂起
+    void start() { h_.resume(); }
+    bool done() const { return !h_ || h_.done(); }
+    // 已完成任务的结果，任务抛出的异常在这里重新抛出
+    T result() { return h_.promise().result(); }
+    Handle handle() const { return h_; }
+
+    struct Awaiter {
+        Handle h;
+        bool await_ready() const noexcept { return h.done(); }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> cont) noexcept
+        {
+            h.promise().continuation = cont;
+            return h;
+        }
+        T await_resume() { return h.promise().result(); }
+    };
+    // co_await task：启动任务并等待它完成
+    Awaiter operator co_await() const noexcept { return Awaiter{h_}; }
+
+private:
+    Handle h_;
+};
+
+template <typename T>
+inline CoroTask<T> CoroPromise<T>::get_return_object()
+{
+    return CoroTask<T>(CoroTask<T>::Handle::from_promise(*this));
+}
+
+inline CoroTask<void> CoroPromise<void>::get_return_object()
+{
+    return CoroTask<void>(CoroTask<void>::Handle::from_promise(*this));
+}
+
+class CoroWheel;
+
+// 时间轮上的等待节点。entry必须是第一个成员：到期回调只拿到timer_entry_t*
+struct CoroWaiter {
+    enum { IDLE, ARMED, READY };
+
+    timer_entry_t entry;
+    CoroWheel* wheel;
+    void (*fire)(CoroWaiter* w);    // 由tick()在批量恢复时调用
+    uint32_t left;                  // 超过一圈的等待，本次到期后还剩的tick数
+    uint8_t state;
+
+    CoroWaiter(CoroWheel* w, void (*fn)(CoroWaiter*)) : wheel(w), fire(fn), left(0), state(IDLE)
+    {
+        timer_wheel_entry_init(&entry);
+    }
+    inline ~CoroWaiter();
+    CoroWaiter(const CoroWaiter&) = delete;
+    CoroWaiter& operator=(const CoroWaiter&) = delete;
+};
+
+// co_await wheel.sleep_for(d)
+class SleepAwaiter : private CoroWaiter {
+public:
+    SleepAwaiter(CoroWheel* w, uint32_t ticks) : CoroWaiter(w, resume), ticks_(ticks) {}
+
+    bool await_ready() const noexcept { return ticks_ == 0; }
+    inline void await_suspend(std::coroutine_handle<> h);
+    void await_resume() noexcept {}
+
+private:
+    static void resume(CoroWaiter* w) { static_cast<SleepAwaiter*>(w)->h_.resume(); }
+
+    std::coroutine_handle<> h_;
+    uint32_t ticks_;
+};
+
+// with_timeout的结果：void任务为是否按时完成，其它为std::optional<T>，超时为空
+template <typename T>
+struct CoroTimeoutResult {
+    typedef std::optional<T> type;
+};
+
+template <>
+struct CoroTimeoutResult<void> {
+    typedef bool type;
+};
+
+// co_await wheel.with_timeout(task, d)：启动task，先到期则销毁task并返回超时；
+// 空的（默认构造或已被移走的）task不会运行，直接返回空结果
+template <typename T>
+class TimeoutAwaiter : private CoroWaiter {
+public:
+    typedef typename CoroTimeoutResult<T>::type Result;
+
+    TimeoutAwaiter(CoroWheel* w, CoroTask<T>&& task, uint32_t ticks)
+        : CoroWaiter(w, expire), task_(std::move(task)), ticks_(ticks), timedOut_(false) {}
+
+    bool await_ready() const noexcept { return task_.done(); }
+    inline std::coroutine_handle<> await_suspend(std::coroutine_handle<> parent);
+    Result await_resume();
+
+private:
+    // 超时：先销毁任务（它自己的等待随之取消），再恢复等待者
+    static void expire(CoroWaiter* w)
+    {
+        TimeoutAwaiter* self = static_cast<TimeoutAwaiter*>(w);
+        self->timedOut_ = true;
+        self->task_.reset();
+        self->parent_.resume();
+    }
+
+    CoroTask<T> task_;
+    std::coroutine_handle<> parent_;
+    uint32_t ticks_;
+    bool timedOut_;
+};
+
+class CoroWheel {
+public:
+    // tickMs为一个tick的长度，slots为时间轮槽数（取整为2的幂）；等待时间可以超过一圈
+    explicit CoroWheel(uint32_t tickMs = 1, uint32_t slots = MAX_TIMER_SLOTS)
+        : tickNs_((uint64_t)(tickMs ? tickMs : 1) * 1000000ULL), originNs_(wheel_clock_ns()), rollNow_(0)
+    {
+        timer_wheel_attr_t attr = { slots, 0, -1 };
+        if (timer_wheel_init_attr(&w_, &attr) != 0) {
+            throw std::bad_alloc();
+        }
+        CDS_INIT_LIST_HEAD(&ready_);
+        // 时间轮从1开始，0表示未启动
+        timer_wheel_start(&w_, 1);
+    }
+    // 所有挂起在这个时间轮上的协程必须先销毁
+    ~CoroWheel() { timer_wheel_destroy(&w_); }
+    CoroWheel(const CoroWheel&) = delete;
+    CoroWheel& operator=(const CoroWheel&) = delete;
+
+    SleepAwaiter sleep_for(std::chrono::milliseconds d) { return SleepAwaiter(this, toTicks(d)); }
+
+    template <typename T>
+    TimeoutAwaiter<T> with_timeout(CoroTask<T> task, std::chrono::milliseconds d)
+    {
+        return TimeoutAwaiter<T>(this, std::move(task), toTicks(d));
+    }
+
+    // 推进到tick序号now，恢复到期的协程，返回恢复的数量。
+    // 到期的等待在roll中只挂到就绪链表，roll结束后再按到期顺序逐个恢复，
+    // 恢复的协程可以再次co_await这个时间轮
+    uint32_t tick(uint32_t now)
+    {
+        uint32_t resumed = 0;
+
+        rollNow_ = now;
+        timer_wheel_roll(&w_, now);
+        while (!cds_list_empty(&ready_)) {
+            CoroWaiter* wt = waiterOf(ready_.next);
+            cds_list_del(&wt->entry.link);
+            wt->state = CoroWaiter::IDLE;
+            // 下一个等待对象在另一个协程帧中，恢复当前协程时提前取进缓存
+            __builtin_prefetch(ready_.next);
+            wt->fire(wt);
+            resumed++;
+        }
+        return resumed;
+    }
+
+    // 按wheel_clock_ns()推进到当前时间，事件循环每次迭代调用一次
+    uint32_t poll() { return tick(1 + (uint32_t)((wheel_clock_ns() - originNs_) / tickNs_)); }
+
+    // 下一个有等待到期的tick，事件循环可以睡到那时再poll()
+    uint32_t nextTick() { return timer_wheel_next_roll(&w_); }
+    uint32_t now() { return timer_wheel_current(&w_); }
+    // 挂在时间轮上的等待数
+    uint32_t pending() { return timer_wheel_count(&w_); }
+
+private:
+    friend class SleepAwaiter;
+    template <typename T> friend class TimeoutAwaiter;
+    friend struct CoroWaiter;
+
+    uint32_t toTicks(std::chrono::milliseconds d) const
+    {
+        uint64_t ns = d.count() > 0 ? (uint64_t)d.count() * 1000000ULL : 0;
+        return (uint32_t)((ns + tickNs_ - 1) / tickNs_);
+    }
+
+    static CoroWaiter* waiterOf(struct cds_list_head* link)
+    {
+        return reinterpret_cast<CoroWaiter*>(cds_list_entry(link, timer_entry_t, link));
+    }
+
+    // 一次最多等一圈减一，剩余部分到期时再挂上去
+    void link(CoroWaiter* wt, uint32_t ticks, uint32_t now)
+    {
+        uint32_t step = ticks < w_.mask ? ticks : w_.mask;
+        wt->left = ticks - step;
+        timer_wheel_entry_start(&w_, &wt->entry, expired, (uint16_t)step, now);
+        wt->state = CoroWaiter::ARMED;
+    }
+
+    void arm(CoroWaiter* wt, uint32_t ticks) { link(wt, ticks, timer_wheel_current(&w_)); }
+
+    void cancel(CoroWaiter* wt)
+    {
+        if (wt->state == CoroWaiter::ARMED) {
+            timer_wheel_entry_remove(&w_, &wt->entry);
+        } else if (wt->state == CoroWaiter::READY) {
+            cds_list_del(&wt->entry.link);
+        }
+        wt->state = CoroWaiter::IDLE;
+    }
+
+    // timer_wheel_roll()的回调：roll中不恢复协程，只挂到就绪链表
+    static void expired(timer_entry_t* e)
+    {
+        CoroWaiter* wt = reinterpret_cast<CoroWaiter*>(e);
+        CoroWheel* self = wt->wheel;
+
+        if (wt->left) {
+            // 从到期的slot时间而不是roll的now接着等，多圈等待不累积延迟。
+            // 一次roll最多处理一圈，slot时间是rollNow_之前第一个落在expire_slot上的时间
+            uint32_t last = self->rollNow_ - 1;
+            self->link(wt, wt->left, last - ((last - e->expire_slot) & self->w_.mask));
+            return;
+        }
+        wt->state = CoroWaiter::READY;
+        cds_list_add_tail(&e->link, &self->ready_);
+    }
+
+    timer_wheel_t w_;
+    struct cds_list_head ready_;
+    uint64_t tickNs_;
+    uint64_t originNs_;
+    uint32_t rollNow_;              // 正在进行的roll的now
+};
+
+inline CoroWaiter::~CoroWaiter()
+{
+    wheel->cancel(this);
+}
+
+inline void SleepAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    h_ = h;
+    wheel->arm(this, ticks_);
+}
+
+template <typename T>
+inline std::coroutine_handle<> TimeoutAwaiter<T>::await_suspend(std::coroutine_handle<> parent)
+{
+    parent_ = parent;
+    wheel->arm(this, ticks_);
+    typename CoroTask<T>::Handle h = task_.handle();
+    h.promise().continuation = parent;
+    return h;
+}
+
+template <typename T>
+inline typename TimeoutAwaiter<T>::Result TimeoutAwaiter<T>::await_resume()
+{
+    // 空task的done()为true，不挂起直接到这里，没有promise可取结果
+    if (timedOut_ || !task_.handle()) {
+        return Result();
+    }
+    // 任务先完成：取消超时定时器
+    wheel->cancel(this);
+    if constexpr (std::is_void_v<T>) {
+        task_.result();
+        return true;
+    } else {
+        return Result(task_.result());
+    }
+}
+
+#endif
@@ -0,0 +1,50 @@
+#include <iostream>
+#include <unistd.h>
+#include "coroWheel.h"
+
+using namespace std::chrono_literals;
+
+// ----------------- 示例协程 ------------------
+CoroTask<> heartbeat(CoroWheel& wheel, const char* name, int times)
+{
+    for (int i = 0; i < times; ++i) {
+        co_await wheel.sleep_for(200ms);
+        std::cout << name << " tick " << i << " at " << wheel.now() << "ms" << std::endl;
+    }
+}
+
+CoroTask<int> slowQuery(CoroWheel& wheel, std::chrono::milliseconds cost, int value)
+{
+    co_await wheel.sleep_for(cost);
+    co_return value;
+}
+
+CoroTask<> client(CoroWheel& wheel)
+{
+    std::optional<int> r = co_await wheel.with_timeout(slowQuery(wheel, 100ms, 42), 300ms);
+    std::cout << "query 1: " << (r ? std::to_string(*r) : "timeout") << std::endl;
+
+    r = co_await wheel.with_timeout(slowQuery(wheel, 500ms, 7), 300ms);
+    std::cout << "query 2: " << (r ? std::to_string(*r) : "timeout") << std::endl;
+}
+
+int main() {
+    CoroWheel wheel(1); // 每个tick = 1毫秒
+
+    CoroTask<> a = heartbeat(wheel, "A", 5);
+    CoroTask<> b = heartbeat(wheel, "B", 100);
+    CoroTask<> c = client(wheel);
+    a.start();
+    b.start();
+    c.start();
+
+    while (!a.done() || !c.done()) {
+        usleep(1000);
+        wheel.poll();
+    }
+    // 销毁还在等待的协程，它的定时器随之从时间轮上摘掉
+    std::cout << "pending before cancel: " << wheel.pending() << std::endl;
+    b.reset();
+    std::cout << "pending after cancel: " << wheel.pending() << std::endl;
+    return 0;
+}
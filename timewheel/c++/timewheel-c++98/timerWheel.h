@@ -0,0 +1,454 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <vector>
+#include <cstdio>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "wheel_clock.h"
+#include "wheel_metrics.h"
+#include "wheel_pool.h"
+#include "wheel_timerfd.h"
+
+// ----------------- 定时器对象 ------------------
+typedef void (*TimerCallback)(void*);
+
+struct Timer {
+    uint64_t expire;       // 在第几个tick到期（从0开始的绝对序号）
+    TimerCallback cb;      // 回调函数指针
+    void* arg;             // 回调参数
+};
+
+// ----------------- 单层时间轮 ------------------
+class TimerWheel {
+public:
+    TimerWheel(int wheelSize, int tickMs)
+        : wheelSize_(wheelSize),
+          tickMs_(tickMs),
+          curTick_(0),
+          stop_(false),
+          worker_(0),
+          wakeTick_(0),
+          wakeups_(0),
+          origin_(0),
+          timerFd_(-1),
+          lateNs_(0),
+          pool_(NULL),
+          poolWait_(false)
+    {
+        slots_.resize(wheelSize_);
+        pthread_mutex_init(&mtx_, NULL);
+        // 工作线程的截止时间按CLOCK_MONOTONIC（wheel_clock_mono_ns()）计算，与条件变量的时钟一致；
+        // wheel_clock_ns()用TSC时只校准一次，与CLOCK_MONOTONIC之间会漂移，不能混用
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&cond_, &attr);
+        pthread_condattr_destroy(&attr);
+        metrics_ = wheel_metrics_create("c++98");
+    }
+
+    ~TimerWheel() {
+        stop();
+        if (timerFd_ >= 0) {
+            close(timerFd_);
+        }
+        pthread_cond_destroy(&cond_);
+        pthread_mutex_destroy(&mtx_);
+        wheel_metrics_destroy(metrics_);
+    }
+
+    // 添加一个定时器: 延迟 delayMs 毫秒后执行
+    // slackMs > 0 时允许推迟至多slackMs毫秒执行，与附近到期的定时器合并到同一个槽，
+    // 工作线程只在有定时器的槽醒来，空闲超时这类不需要精确到期的定时器可以大大减少唤醒次数
+    void addTimer(int delayMs, TimerCallback cb, void* arg, int slackMs = 0) {
+        if (delayMs <= 0) delayMs = tickMs_; 
+
+        uint64_t ticks = delayMs / tickMs_;
+        uint64_t slack = slackMs > 0 ? slackMs / tickMs_ : 0;
+
+        lockTimed();
+        Timer t;
+        t.expire = applySlack(nowTickLocked() + ticks, slack);
+        t.cb = cb;
+        t.arg = arg;
+        slots_[t.expire % wheelSize_].push_back(t);
+        wheel_metrics_count(metrics_, WHEEL_METRIC_INSERT, 1);
+        // 工作线程（或事件循环的timerfd）睡到wakeTick_，新定时器更早到期时叫醒它
+        if (t.expire < wakeTick_) {
+            wakeTick_ = t.expire;
+            if (timerFd_ >= 0) {
+                wheel_timerfd_arm(timerFd_, origin_ + t.expire * tickNs());
+            } else {
+                pthread_cond_signal(&cond_);
+            }
+        }
+        pthread_mutex_unlock(&mtx_);
+    }
+
+    // 启动工作线程；已经交给事件循环驱动（调用过timerFd()）时不启动
+    void start() {
+        if (timerFd_ >= 0) {
+            return;
+        }
+        wheel_clock_source();
+        stop_ = false;
+        pthread_create(&worker_, NULL, workerThread, this);
+    }
+
+    void stop() {
+        pthread_mutex_lock(&mtx_);
+        stop_ = true;
+        pthread_cond_signal(&cond_);
+        pthread_mutex_unlock(&mtx_);
+        if (worker_) {
+            pthread_join(worker_, NULL);
+            worker_ = 0;
+        }
+        if (pool_) {
+            wheel_pool_wait(pool_);
+        }
+    }
+
+    // 到期回调交给线程池执行：tick()只把到期的定时器按BATCH个一批提交，回调在工作线程上并发执行。
+    // wait为true时tick()等所有回调执行完才返回（屏障），调用方可以依赖回调的先后顺序；
+    // 否则tick()提交后立即返回。pool为NULL时恢复在tick()中串行执行。
+    void setPool(wheel_pool_t* pool, bool wait) {
+        if (pool_) {
+            wheel_pool_wait(pool_);
+        }
+        pool_ = pool;
+        poolWait_ = wait;
+    }
+
+    // 工作线程醒来（或processExpired()被调用）的次数
+    uint64_t wakeups() const {
+        return __atomic_load_n(&wakeups_, __ATOMIC_RELAXED);
+    }
+
+private:
+    static void* workerThread(void* arg) {
+        TimerWheel* tw = (TimerWheel*)arg;
+
+        pthread_mutex_lock(&tw->mtx_);
+        tw->origin_ = wheel_clock_mono_ns() - tw->curTick_ * tw->tickNs();
+        while (!tw->stop_) {
+            // 空槽不用醒：直接睡到下一个有定时器的槽，期间加入更早到期的定时器时addTimer会提前叫醒
+            tw->wakeTick_ = tw->nextExpiryLocked();
+            for (;;) {
+                uint64_t deadline = tw->origin_ + tw->wakeTick_ * tw->tickNs();
+                if (tw->stop_ || wheel_clock_mono_ns() >= deadline) {
+                    break;
+                }
+                struct timespec ts;
+                ts.tv_sec = deadline / 1000000000ULL;
+                ts.tv_nsec = deadline % 1000000000ULL;
+                pthread_cond_timedwait(&tw->cond_, &tw->mtx_, &ts);
+            }
+            // 醒着的时候不需要叫醒
+            tw->wakeTick_ = 0;
+            __atomic_store_n(&tw->wakeups_, tw->wakeups_ + 1, __ATOMIC_RELAXED);
+
+            tw->runDueLocked(wheel_clock_mono_ns());
+        }
+        tw->origin_ = 0;
+        pthread_mutex_unlock(&tw->mtx_);
+        return NULL;
+    }
+
+    // 处理截止时间不晚于now的所有tick，跳过的空槽只是加锁看一眼。调用方持有mtx_
+    size_t runDueLocked(uint64_t now) {
+        size_t expired = 0;
+        // 空闲后（时间轮为空时timerfd不定时）curTick_可能落后很多个tick。超过一圈的部分只会重复扫描同样的槽：
+        // 只走最后一圈，每个到期的定时器都会在经过它的槽时处理；时间轮为空时直接跳到当前tick
+        if (origin_ + curTick_ * tickNs() <= now) {
+            uint64_t due = (now - origin_) / tickNs() + 1;
+            if (due - curTick_ > (uint64_t)wheelSize_) {
+                curTick_ = nextExpiryLocked() == curTick_ + wheelSize_ ? due : due - wheelSize_;
+            }
+        }
+        while (!stop_ && origin_ + curTick_ * tickNs() <= now) {
+            // 记录本次tick相对截止时间的延迟，到期的定时器都晚了这么久
+            lateNs_ = now - (origin_ + curTick_ * tickNs());
+            pthread_mutex_unlock(&mtx_);
+            expired += tick();
+            pthread_mutex_lock(&mtx_);
+        }
+        lateNs_ = 0;
+        return expired;
+    }
+
+public:
+    // 事件循环模式：不启动工作线程，返回一个CLOCK_MONOTONIC的timerfd，始终定在下一个有定时器的槽的
+    // 截止时间，时间轮为空时不定时。把它加入epoll（EPOLLIN），或在io_uring上对它POLL_ADD/READ，
+    // 可读时调用processExpired(wheel_clock_mono_ns())。套接字和定时器在同一个线程处理，空槽不会唤醒事件循环。
+    // fd归时间轮所有，析构时关闭；已经start()或创建失败时返回-1
+    int timerFd() {
+        wheel_clock_source();
+        pthread_mutex_lock(&mtx_);
+        if (timerFd_ < 0 && !worker_ && (timerFd_ = wheel_timerfd_create()) >= 0) {
+            // 第k个tick的截止时间为origin_ + k * tickNs，同工作线程
+            origin_ = wheel_clock_mono_ns() - curTick_ * tickNs();
+            stop_ = false;
+            rearmLocked();
+        }
+        int fd = timerFd_;
+        pthread_mutex_unlock(&mtx_);
+        return fd;
+    }
+
+    // timerfd可读时由事件循环调用：处理截止时间不晚于nowNs（CLOCK_MONOTONIC）的所有tick，在调用线程上
+    // 执行到期回调（回调中可以再加定时器），再把timerfd定到下一个有定时器的槽。返回到期的定时器数
+    size_t processExpired(uint64_t nowNs) {
+        bool fired = timerFd_ >= 0 && wheel_timerfd_ack(timerFd_) > 0;
+        lockTimed();
+        // fd到期时至少处理到它定的那个tick，否则nowNs稍早于截止时间会把同一个截止时间重新定上，反复可读
+        if (fired && origin_ && wakeTick_ != ~(uint64_t)0 && origin_ + wakeTick_ * tickNs() > nowNs) {
+            nowNs = origin_ + wakeTick_ * tickNs();
+        }
+        // 处理期间加入的定时器不单独定时，处理完统一定到下一个有定时器的槽
+        wakeTick_ = 0;
+        __atomic_store_n(&wakeups_, wakeups_ + 1, __ATOMIC_RELAXED);
+        size_t expired = origin_ ? runDueLocked(nowNs) : 0;
+        rearmLocked();
+        pthread_mutex_unlock(&mtx_);
+        return expired;
+    }
+
+    // 推进一个tick并执行到期的回调，返回到期的定时器数；不启动工作线程时可由调用方直接驱动
+    size_t tick() {
+        std::vector<Timer> ready;
+        uint64_t start = wheel_clock_ns();
+        uint64_t occupancy = 0, expired = 0;
+
+        lockTimed();
+        // 槽是连续数组，顺序扫描：到期的复制出来，没到期的原地前移，槽的容量留给下一圈复用
+        std::vector<Timer>& slot = slots_[curTick_ % wheelSize_];
+        size_t keep = 0;
+        occupancy = slot.size();
+        for (size_t i = 0; i < slot.size(); ++i) {
+            if (slot[i].expire <= curTick_) {
+                ready.push_back(slot[i]);
+            } else {
+                slot[keep++] = slot[i];
+            }
+        }
+        slot.resize(keep);
+        expired = ready.size();
+        curTick_++;
+        pthread_mutex_unlock(&mtx_);
+
+        wheel_metrics_slot(metrics_, occupancy);
+
+        if (pool_ && expired) {
+            // 超时计数和延迟由工作线程按批记录
+            dispatch(ready, start);
+            if (poolWait_) {
+                wheel_pool_wait(pool_);
+            }
+        } else {
+            // 锁外执行回调；每BATCH个回调记录一次延迟，同一tick中靠后的回调延迟更大
+            uint64_t late = 0, batch = 0;
+            for (size_t i = 0; i < ready.size(); ++i) {
+                if (batch == 0) {
+                    late = lateNs_ + (wheel_clock_ns() - start);
+                }
+                if (ready[i].cb) {
+                    ready[i].cb(ready[i].arg);
+                }
+                if (++batch == BATCH) {
+                    wheel_metrics_record(metrics_, WHEEL_HIST_LATENESS, late, batch);
+                    batch = 0;
+                }
+            }
+            wheel_metrics_record(metrics_, WHEEL_HIST_LATENESS, late, batch);
+            wheel_metrics_count(metrics_, WHEEL_METRIC_EXPIRE, expired);
+        }
+
+        wheel_metrics_count(metrics_, WHEEL_METRIC_TICK, 1);
+        wheel_metrics_record(metrics_, WHEEL_HIST_TICK, wheel_clock_ns() - start, 1);
+        return expired;
+    }
+
+    // 下一个有定时器的槽在第几个tick（最多向前看一圈，空轮返回一圈之后）。
+    // 不启动工作线程时调用方可以据此睡到那个tick，再调用tick()追上经过的槽
+    uint64_t nextExpiry() {
+        pthread_mutex_lock(&mtx_);
+        uint64_t next = nextExpiryLocked();
+        pthread_mutex_unlock(&mtx_);
+        return next;
+    }
+
+    // 下一次tick()处理第几个tick
+    uint64_t currentTick() {
+        pthread_mutex_lock(&mtx_);
+        uint64_t cur = curTick_;
+        pthread_mutex_unlock(&mtx_);
+        return cur;
+    }
+
+    // 运行时统计：各线程的计数合并后的快照
+    void snapshot(wheel_metrics_snapshot_t* s) const {
+        wheel_metrics_snapshot(metrics_, s);
+    }
+
+    void dumpMetrics(FILE* fp, bool json = false) const {
+        wheel_metrics_snapshot_t* s = new wheel_metrics_snapshot_t;
+        snapshot(s);
+        if (json) {
+            wheel_metrics_dump_json(fp, s);
+        } else {
+            wheel_metrics_dump_text(fp, s);
+        }
+        delete s;
+    }
+
+private:
+    // 线程池模式下每个任务执行的回调数，也是串行执行时记录延迟的间隔
+    enum { BATCH = 256 };
+
+    // 一次tick到期的全部定时器，由最后一个执行完的批次释放
+    struct ReadySet {
+        std::vector<Timer> timers;
+        int remaining;
+    };
+
+    struct Batch {
+        wheel_task_t task;      // 必须是第一个成员，runBatch由此转换回Batch
+        TimerWheel* tw;
+        ReadySet* set;
+        size_t begin;
+        size_t end;
+        uint64_t lateNs;        // tick开始时的延迟
+        uint64_t startNs;       // tick开始的时间
+    };
+
+    void dispatch(std::vector<Timer>& ready, uint64_t start) {
+        ReadySet* set = new ReadySet;
+        set->timers.swap(ready);
+        // 提交最后一批后set可能已被工作线程释放，循环中不能再访问它
+        size_t n = set->timers.size();
+        set->remaining = (int)((n + BATCH - 1) / BATCH);
+
+        for (size_t i = 0; i < n; i += BATCH) {
+            Batch* b = new Batch;
+            b->task.fn = runBatch;
+            b->tw = this;
+            b->set = set;
+            b->begin = i;
+            b->end = i + BATCH < n ? i + BATCH : n;
+            b->lateNs = lateNs_;
+            b->startNs = start;
+            wheel_pool_submit(pool_, &b->task);
+        }
+    }
+
+    static void runBatch(wheel_task_t* t) {
+        Batch* b = reinterpret_cast<Batch*>(t);
+        wheel_metrics_t* metrics = b->tw->metrics_;
+        uint64_t late = b->lateNs + (wheel_clock_ns() - b->startNs);
+
+        for (size_t i = b->begin; i < b->end; ++i) {
+            const Timer& timer = b->set->timers[i];
+            if (timer.cb) {
+                timer.cb(timer.arg);
+            }
+        }
+        wheel_metrics_count(metrics, WHEEL_METRIC_EXPIRE, b->end - b->begin);
+        wheel_metrics_record(metrics, WHEEL_HIST_LATENESS, late, b->end - b->begin);
+
+        if (__atomic_sub_fetch(&b->set->remaining, 1, __ATOMIC_ACQ_REL) == 0) {
+            delete b->set;
+        }
+        delete b;
+    }
+
+    // 槽里可能只有以后几圈才到期的定时器，那只是多醒一次
+    uint64_t nextExpiryLocked() const {
+        for (int i = 0; i < wheelSize_; ++i) {
+            if (!slots_[(curTick_ + i) % wheelSize_].empty()) {
+                return curTick_ + i;
+            }
+        }
+        return curTick_ + wheelSize_;
+    }
+
+    // 把timerfd定到下一个有定时器的槽；时间轮为空时撤销，下一次addTimer再定时
+    void rearmLocked() {
+        uint64_t next = nextExpiryLocked();
+        if (next == curTick_ + wheelSize_) {
+            wakeTick_ = ~(uint64_t)0;
+            if (timerFd_ >= 0) {
+                wheel_timerfd_disarm(timerFd_);
+            }
+        } else {
+            wakeTick_ = next;
+            if (timerFd_ >= 0) {
+                wheel_timerfd_arm(timerFd_, origin_ + next * tickNs());
+            }
+        }
+    }
+
+    // 新定时器从哪个tick算起。工作线程或事件循环只在有定时器的槽醒来，其间curTick_停在上次处理的
+    // 位置，要按实际时间算出当前tick（醒着每个tick都处理时，处理完第k个tick后curTick_为k + 1）；
+    // 由调用方直接驱动tick()时就是curTick_
+    uint64_t nowTickLocked() const {
+        if (origin_ == 0) {
+            return curTick_;
+        }
+        uint64_t now = wheel_clock_mono_ns();
+        uint64_t cur = now > origin_ ? (now - origin_) / tickNs() + 1 : 0;
+        return cur > curTick_ ? cur : curTick_;
+    }
+
+    uint64_t tickNs() const {
+        return (uint64_t)tickMs_ * 1000000ULL;
+    }
+
+    // 到期时间在[expire, expire + slack]内取最粗的2的幂边界（同内核的apply_slack），
+    // 截止时间相近、slack相近的定时器落到同一个槽
+    static uint64_t applySlack(uint64_t expire, uint64_t slack) {
+        uint64_t mask = expire ^ (expire + slack);
+        if (mask == 0) {
+            return expire;
+        }
+        mask = (1ULL << (63 - __builtin_clzll(mask))) - 1;
+        return (expire + slack) & ~mask;
+    }
+
+    // 加锁并记录等待时间，未发生竞争时记为0
+    void lockTimed() {
+        if (pthread_mutex_trylock(&mtx_) == 0) {
+            wheel_metrics_record(metrics_, WHEEL_HIST_LOCK_WAIT, 0, 1);
+            return;
+        }
+        uint64_t t0 = wheel_clock_ns();
+        pthread_mutex_lock(&mtx_);
+        wheel_metrics_record(metrics_, WHEEL_HIST_LOCK_WAIT, wheel_clock_ns() - t0, 1);
+    }
+
+    int wheelSize_;
+    int tickMs_;
+    uint64_t curTick_;    // 下一次tick()处理的tick序号，对应槽curTick_ % wheelSize_
+
+    std::vector<std::vector<Timer> > slots_;
+    volatile bool stop_;
+    pthread_t worker_;
+    pthread_mutex_t mtx_;
+    pthread_cond_t cond_;    // 工作线程在此睡到下一个有定时器的槽
+    uint64_t wakeTick_;      // 工作线程或timerfd睡到哪个tick，醒着时为0，timerfd未定时时为最大值
+    uint64_t wakeups_;
+    uint64_t origin_;        // 第0个tick的截止时间（CLOCK_MONOTONIC），工作线程或事件循环驱动时有效，否则为0
+    int timerFd_;            // 事件循环模式的timerfd，未使用时为-1
+
+    wheel_metrics_t* metrics_;
+    uint64_t lateNs_;     // 工作线程驱动时本次tick的延迟，直接调用tick()时为0
+
+    wheel_pool_t* pool_;  // NULL时在tick()中串行执行回调
+    bool poolWait_;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "wheel_clock.h"
+
+// ns per timestamp for each clock source, TSC calibration accuracy and
+// monotonicity of wheel_clock_ns()
+// usage: clock_bench [iterations]
+
+static uint64_t sink;
+
+#define TIME_LOOP(name, n, expr)                                            \
+    do {                                                                    \
+        uint64_t t0 = wheel_clock_mono_ns(), acc = 0;                       \
+        for (long i_ = 0; i_ < (n); i_ ++) {                                \
+            acc += (expr);                                                  \
+        }                                                                   \
+        uint64_t t1 = wheel_clock_mono_ns();                                \
+        sink += acc;                                                        \
+        printf("%-28s %7.2f ns\n", name, (double)(t1 - t0) / (n));          \
+    } while (0)
+
+int main(int argc, char *argv[])
+{
+    long n = argc > 1 ? atol(argv[1]) : 20000000;
+    int failures = 0;
+    long i;
+
+    if (n <= 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    printf("invariant tsc: %s\n", wheel_clock_tsc_invariant() ? "yes" : "no");
+    int src = wheel_clock_init(1, 50);
+    printf("source: %s", src == WHEEL_CLOCK_TSC ? "tsc" : "clock_monotonic");
+    if (src == WHEEL_CLOCK_TSC) {
+        printf(" (%.3f MHz)", wheel_clock_tsc_hz() / 1e6);
+    }
+    printf("\n\n");
+
+    TIME_LOOP("clock_gettime(MONOTONIC)", n, wheel_clock_mono_ns());
+    TIME_LOOP("clock_gettime(COARSE)", n, wheel_clock_coarse_ns());
+    TIME_LOOP("time()", n, (uint64_t)time(NULL));
+    TIME_LOOP("rdtsc", n, wheel_clock_rdtsc());
+    TIME_LOOP("wheel_clock_ns", n, wheel_clock_ns());
+    TIME_LOOP("wheel_clock_cached_ns", n, wheel_clock_cached_ns());
+
+    wheel_ticks_t ticks;
+    wheel_ticks_init(&ticks, wheel_clock_ns(), 1000000);
+    TIME_LOOP("wheel_ticks_from_ns(ns())", n, wheel_ticks_from_ns(&ticks, wheel_clock_ns()));
+    TIME_LOOP("wheel_ticks_from_ns(cached)", n, wheel_ticks_from_ns(&ticks, wheel_clock_cached_ns()));
+
+    // clock thread: readers see a value at most one period old
+    if (wheel_clock_start_thread(1000) == 0) {
+        uint64_t worst = 0;
+        for (i = 0; i < 200; i ++) {
+            uint64_t now = wheel_clock_ns(), cached = wheel_clock_cached_ns();
+            if (now > cached && now - cached > worst) {
+                worst = now - cached;
+            }
+            usleep(997);
+        }
+        wheel_clock_stop_thread();
+        printf("\nclock thread (1ms period): max staleness %.3f ms\n", worst / 1e6);
+    }
+
+    if (src == WHEEL_CLOCK_TSC) {
+        // TSC conversion against CLOCK_MONOTONIC over a longer interval than the calibration
+        uint64_t m0 = wheel_clock_mono_ns(), w0 = wheel_clock_ns();
+        usleep(500000);
+        uint64_t m1 = wheel_clock_mono_ns(), w1 = wheel_clock_ns();
+        double ppm = ((double)(w1 - w0) - (double)(m1 - m0)) / (m1 - m0) * 1e6;
+        printf("tsc vs clock_monotonic over %.0f ms: %+.1f ppm, offset %+.3f us\n",
+               (m1 - m0) / 1e6, ppm, ((double)w1 - (double)m1) / 1e3);
+        if (ppm > 1000 || ppm < -1000) {
+            printf("tsc calibration off by more than 1000 ppm\n");
+            failures ++;
+        }
+    }
+
+    uint64_t prev = wheel_clock_ns();
+    for (i = 0; i < n / 10; i ++) {
+        uint64_t now = wheel_clock_ns();
+        if (now < prev) {
+            printf("wheel_clock_ns went backwards by %llu ns\n", (unsigned long long)(prev - now));
+            failures ++;
+            break;
+        }
+        prev = now;
+    }
+
+    printf("(sink %llu)\n", (unsigned long long)sink);
+    return failures ? 1 : 0;
+}
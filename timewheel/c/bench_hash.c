@@ -0,0 +1,350 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "helper.h"
+#include "flow_hash.h"
+
+// Correctness checks, throughput and bucket distribution (chi-square) of the
+// flow_hash.h primitives against sdbm_hash
+// usage: hash_bench [keys] [bucket bits]
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t ip4(int a, int b, int c, int d)
+{
+    return htonl((uint32_t)a << 24 | b << 16 | c << 8 | d);
+}
+
+/* ---------------- correctness ---------------- */
+
+static uint32_t crc32c_bitwise(const uint8_t *p, size_t len)
+{
+    uint32_t crc = ~0u;
+    int j;
+
+    while (len --) {
+        crc ^= *p ++;
+        for (j = 0; j < 8; j ++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78u : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+static void random_key(flow_key_t *k, unsigned *seed, int v6)
+{
+    int i;
+
+    memset(k, 0, sizeof(*k));
+    for (i = 0; i < (v6 ? 16 : 4); i ++) {
+        k->src_ip[i] = rand_r(seed);
+        // sometimes share a prefix so the port tie-break gets exercised
+        k->dst_ip[i] = rand_r(seed) % 8 ? k->src_ip[i] : rand_r(seed);
+    }
+    k->src_port = rand_r(seed);
+    k->dst_port = rand_r(seed) % 4 ? rand_r(seed) : k->src_port;
+    k->proto = rand_r(seed) % 2 ? 6 : 17;
+}
+
+static void reverse_key(flow_key_t *r, const flow_key_t *k)
+{
+    *r = *k;
+    memcpy(r->src_ip, k->dst_ip, 16);
+    memcpy(r->dst_ip, k->src_ip, 16);
+    r->src_port = k->dst_port;
+    r->dst_port = k->src_port;
+}
+
+static int check(void)
+{
+    // Microsoft RSS verification suite (IPv4 with ports, IPv4 addresses only)
+    static const struct {
+        int src[4], dst[4];
+        uint16_t sport, dport;
+        uint32_t with_ports, addr_only;
+    } rss_vectors[] = {
+        { { 66, 9, 149, 187 }, { 161, 142, 100, 80 }, 2794, 1766, 0x51ccc178, 0x323e8fc2 },
+        { { 199, 92, 111, 2 }, { 65, 69, 140, 83 }, 14230, 4739, 0xc626b0ea, 0xd718262a },
+        { { 24, 19, 198, 95 }, { 12, 22, 207, 184 }, 12898, 38024, 0x5c2b394a, 0xd2d0a5de },
+        { { 38, 27, 205, 30 }, { 209, 142, 163, 6 }, 48228, 2217, 0xafc7327f, 0x82989176 },
+        { { 153, 39, 163, 191 }, { 202, 188, 127, 2 }, 44251, 1303, 0x10e828a2, 0x5d1809c5 },
+    };
+    static toeplitz_ctx_t rss, sym;
+    uint8_t buf[256];
+    unsigned seed = 11;
+    int i, failures = 0;
+
+    if (crc32c(0, "123456789", 9) != 0xe3069283) {
+        printf("crc32c check value mismatch\n");
+        failures ++;
+    }
+    for (i = 0; i < 10000; i ++) {
+        size_t len = rand_r(&seed) % sizeof(buf), off = rand_r(&seed) % 8, j;
+        for (j = 0; j < len; j ++) {
+            buf[j] = rand_r(&seed);
+        }
+        if (len > off && crc32c(0, buf + off, len - off) != crc32c_bitwise(buf + off, len - off)) {
+            printf("crc32c mismatch: len %zu\n", len - off);
+            failures ++;
+        }
+        // chaining over two pieces gives the crc of the whole
+        if (crc32c(crc32c(0, buf, len / 2), buf + len / 2, len - len / 2) != crc32c(0, buf, len)) {
+            printf("crc32c chaining mismatch: len %zu\n", len);
+            failures ++;
+        }
+    }
+
+    toeplitz_init(&rss, rss_default_key, sizeof(rss_default_key));
+    toeplitz_init(&sym, rss_symmetric_key, sizeof(rss_symmetric_key));
+    for (i = 0; i < (int)(sizeof(rss_vectors) / sizeof(rss_vectors[0])); i ++) {
+        uint32_t s = ip4(rss_vectors[i].src[0], rss_vectors[i].src[1], rss_vectors[i].src[2], rss_vectors[i].src[3]);
+        uint32_t d = ip4(rss_vectors[i].dst[0], rss_vectors[i].dst[1], rss_vectors[i].dst[2], rss_vectors[i].dst[3]);
+        uint8_t in[8];
+        memcpy(in, &s, 4);
+        memcpy(in + 4, &d, 4);
+        if (rss_hash_v4(&rss, s, d, htons(rss_vectors[i].sport), htons(rss_vectors[i].dport)) != rss_vectors[i].with_ports ||
+            toeplitz_hash(&rss, in, 8) != rss_vectors[i].addr_only) {
+            printf("toeplitz vector %d mismatch\n", i);
+            failures ++;
+        }
+    }
+    for (i = 0; i < 10000; i ++) {
+        flow_key_t k, r;
+        size_t len = rand_r(&seed) % (RSS_MAX_INPUT + 1), j;
+        for (j = 0; j < len; j ++) {
+            buf[j] = rand_r(&seed);
+        }
+        if (toeplitz_hash(&rss, buf, len) != toeplitz_hash_slow(rss_default_key, RSS_KEY_LEN, buf, len)) {
+            printf("toeplitz table mismatch: len %zu\n", len);
+            failures ++;
+        }
+
+        random_key(&k, &seed, i & 1);
+        reverse_key(&r, &k);
+        uint32_t sip, dip;
+        memcpy(&sip, k.src_ip, 4);
+        memcpy(&dip, k.dst_ip, 4);
+        if (flow_hash_sym(&k, 5) != flow_hash_sym(&r, 5) ||
+            flow_hash_sym_crc(&k, 5) != flow_hash_sym_crc(&r, 5) ||
+            flow_hash_sym_v4(sip, dip, k.src_port, k.dst_port, k.proto, 5) !=
+            flow_hash_sym_v4(dip, sip, k.dst_port, k.src_port, k.proto, 5) ||
+            rss_hash_v4(&sym, sip, dip, k.src_port, k.dst_port) != rss_hash_v4(&sym, dip, sip, k.dst_port, k.src_port) ||
+            rss_hash_v6(&sym, k.src_ip, k.dst_ip, k.src_port, k.dst_port) !=
+            rss_hash_v6(&sym, k.dst_ip, k.src_ip, k.dst_port, k.src_port)) {
+            printf("symmetric hash mismatch: iteration %d\n", i);
+            failures ++;
+        }
+    }
+
+    return failures;
+}
+
+/* ---------------- keys: many clients to a few servers ---------------- */
+
+// Structured like real session tables: sequential client addresses and
+// ephemeral ports towards a handful of server address/port pairs
+static flow_key_t *build_keys(size_t n)
+{
+    static const uint16_t server_ports[] = { 80, 443, 53, 8080 };
+    flow_key_t *keys = calloc(n, sizeof(*keys));
+    size_t i;
+
+    if (keys == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < n; i ++) {
+        uint32_t client = ip4(10, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+        uint32_t server = ip4(192, 168, 1, 1 + (i >> 2) % 4);
+        memcpy(keys[i].src_ip, &client, 4);
+        memcpy(keys[i].dst_ip, &server, 4);
+        keys[i].src_port = htons(32768 + (i * 7) % 28232);
+        keys[i].dst_port = htons(server_ports[i % 4]);
+        keys[i].proto = 6;
+    }
+    return keys;
+}
+
+enum {
+    H_SDBM,
+    H_BYTES,
+    H_CRC32C,
+    H_SYM,
+    H_SYM_CRC,
+    H_SYM_V4,
+    H_RSS,
+    H_RSS_SYM,
+    H_MAX,
+};
+
+static const char *hash_names[H_MAX] = {
+    "sdbm_hash", "hash_bytes", "crc32c", "flow_hash_sym", "flow_hash_sym_crc", "flow_hash_sym_v4",
+    "rss_hash_v4", "rss_hash_v4(sym key)",
+};
+
+static toeplitz_ctx_t rss_ctx, sym_ctx;
+
+// IPv4 5-tuple packed the way callers feed a byte-wise hash today
+static inline void pack_v4(const flow_key_t *k, uint8_t out[13])
+{
+    memcpy(out, k->src_ip, 4);
+    memcpy(out + 4, k->dst_ip, 4);
+    memcpy(out + 8, &k->src_port, 2);
+    memcpy(out + 10, &k->dst_port, 2);
+    out[12] = k->proto;
+}
+
+static inline uint32_t hash_one(int which, const flow_key_t *k)
+{
+    uint8_t packed[13];
+    uint32_t sip, dip;
+
+    switch (which) {
+    case H_SDBM:
+        pack_v4(k, packed);
+        return sdbm_hash(packed, sizeof(packed));
+    case H_BYTES:
+        pack_v4(k, packed);
+        return (uint32_t)hash_bytes(packed, sizeof(packed), 0);
+    case H_CRC32C:
+        pack_v4(k, packed);
+        return crc32c(0, packed, sizeof(packed));
+    case H_SYM:
+        return flow_hash_sym(k, 0);
+    case H_SYM_CRC:
+        return flow_hash_sym_crc(k, 0);
+    case H_SYM_V4:
+        memcpy(&sip, k->src_ip, 4);
+        memcpy(&dip, k->dst_ip, 4);
+        return flow_hash_sym_v4(sip, dip, k->src_port, k->dst_port, k->proto, 0);
+    case H_RSS:
+    case H_RSS_SYM:
+        memcpy(&sip, k->src_ip, 4);
+        memcpy(&dip, k->dst_ip, 4);
+        return rss_hash_v4(which == H_RSS ? &rss_ctx : &sym_ctx, sip, dip, k->src_port, k->dst_port);
+    }
+    return 0;
+}
+
+// Chi-square of the bucket counts (low bits of the hash), reported as the
+// normal deviate z = (chi2 - df) / sqrt(2 df): |z| of a few is a uniform spread
+static double chi_square_z(int which, const flow_key_t *keys, size_t n, int bits)
+{
+    size_t buckets = (size_t)1 << bits, i;
+    uint32_t *count = calloc(buckets, sizeof(*count));
+    double expected = (double)n / buckets, chi2 = 0;
+
+    if (count == NULL) {
+        return NAN;
+    }
+    for (i = 0; i < n; i ++) {
+        count[hash_one(which, &keys[i]) & (buckets - 1)] ++;
+    }
+    for (i = 0; i < buckets; i ++) {
+        double d = count[i] - expected;
+        chi2 += d * d / expected;
+    }
+    free(count);
+    return (chi2 - (buckets - 1)) / sqrt(2.0 * (buckets - 1));
+}
+
+static double ns_per_hash(int which, const flow_key_t *keys, size_t n, uint32_t *sink)
+{
+    uint32_t acc = 0;
+    size_t i;
+    int r;
+
+    double t0 = now_sec();
+    for (r = 0; r < 4; r ++) {
+        for (i = 0; i < n; i ++) {
+            acc += hash_one(which, &keys[i]);
+        }
+    }
+    double t = now_sec() - t0;
+    *sink += acc;
+    return t * 1e9 / (4.0 * n);
+}
+
+static void bytes_throughput(void)
+{
+    static const size_t sizes[] = { 8, 16, 64, 256, 1500 };
+    uint8_t *buf = malloc(1 << 20);
+    uint64_t acc = 0;
+    size_t s, i, n;
+
+    if (buf == NULL) {
+        return;
+    }
+    for (i = 0; i < (1 << 20); i ++) {
+        buf[i] = i * 131;
+    }
+    for (s = 0; s < ARRAY_ENTRIES(sizes); s ++) {
+        n = ((size_t)64 << 20) / sizes[s];
+        double t0 = now_sec();
+        for (i = 0; i < n; i ++) {
+            acc += sdbm_hash(buf + (i * 64) % ((1 << 20) - 1500), (int)sizes[s]);
+        }
+        double sdbm_t = now_sec() - t0;
+        t0 = now_sec();
+        for (i = 0; i < n; i ++) {
+            acc += hash_bytes(buf + (i * 64) % ((1 << 20) - 1500), sizes[s], 0);
+        }
+        double bytes_t = now_sec() - t0;
+        t0 = now_sec();
+        for (i = 0; i < n; i ++) {
+            acc += crc32c(0, buf + (i * 64) % ((1 << 20) - 1500), sizes[s]);
+        }
+        double crc_t = now_sec() - t0;
+        printf("%5zu bytes: sdbm_hash %6.2f GB/s  hash_bytes %6.2f GB/s  crc32c %6.2f GB/s\n", sizes[s],
+               n * sizes[s] / 1e9 / sdbm_t, n * sizes[s] / 1e9 / bytes_t, n * sizes[s] / 1e9 / crc_t);
+    }
+    printf("(sink %llu)\n", (unsigned long long)acc);
+    free(buf);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 20;
+    int bits = argc > 2 ? atoi(argv[2]) : 16;
+    uint32_t sink = 0;
+    int which;
+
+    if (n == 0 || bits < 1 || bits > 28) {
+        fprintf(stderr, "usage: %s [keys] [bucket bits]\n", argv[0]);
+        return 1;
+    }
+
+    int failures = check();
+    printf("checks: %d failures (crc32c %s)\n", failures, crc32c_hw() ? "sse4.2" : "table");
+
+    toeplitz_init(&rss_ctx, rss_default_key, sizeof(rss_default_key));
+    toeplitz_init(&sym_ctx, rss_symmetric_key, sizeof(rss_symmetric_key));
+    flow_key_t *keys = build_keys(n);
+    if (keys == NULL) {
+        return 1;
+    }
+
+    printf("%zu IPv4 5-tuples, %d buckets\n", n, 1 << bits);
+    for (which = 0; which < H_MAX; which ++) {
+        double z = chi_square_z(which, keys, n, bits);
+        double ns = ns_per_hash(which, keys, n, &sink);
+        printf("%-22s %6.2f ns/key  chi-square z %10.2f\n", hash_names[which], ns, z);
+        // the general purpose mixers must spread structured keys evenly
+        if ((which == H_BYTES || which == H_SYM || which == H_SYM_V4) && !(fabs(z) < 6)) {
+            printf("%s: poor distribution\n", hash_names[which]);
+            failures ++;
+        }
+    }
+    printf("(sink %u)\n", sink);
+    free(keys);
+
+    bytes_throughput();
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,479 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "helper.h"
+
+// Equivalence fuzzing and throughput of the helper.c scanners at every SIMD level,
+// lower_buf()/hex_decode() vs lower_string()/c2hex(), and str_split() vs the zero-copy span splitter
+// usage: helper_bench [payload MB] [fuzz iterations]
+
+static const char *level_names[] = { "scalar", "sse2", "avx2" };
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ---------------- fuzzing against the scalar versions ---------------- */
+
+#define MAX_TOKENS 512
+
+typedef struct token_log_ {
+    int count;
+    int skip_at;            // return CONSUME_TOKEN_SKIP_LINE at this index
+    const uint8_t *ptr[MAX_TOKENS];
+    int len[MAX_TOKENS];
+} token_log_t;
+
+static int log_token(void *param, uint8_t *ptr, int len, int token_idx)
+{
+    token_log_t *log = param;
+    if (log->count < MAX_TOKENS) {
+        log->ptr[log->count] = ptr;
+        log->len[log->count] = len;
+    }
+    log->count ++;
+    return token_idx == log->skip_at ? CONSUME_TOKEN_SKIP_LINE : 0;
+}
+
+static int fuzz(int iterations, int max_level)
+{
+    static const uint8_t alphabet[] = { 'a', 'b', ' ', ' ', '\r', '\n', '\0', 'Z' };
+    uint8_t buf[300];
+    unsigned seed = 1;
+    int it, i, level, failures = 0;
+
+    for (it = 0; it < iterations; it ++) {
+        int len = rand_r(&seed) % (int)sizeof(buf);
+        int dense = rand_r(&seed) % 4;
+        for (i = 0; i < len; i ++) {
+            // mostly plain text, sometimes dense in special bytes
+            buf[i] = dense ? alphabet[rand_r(&seed) % sizeof(alphabet)]
+                           : (rand_r(&seed) % 32 ? 'x' : alphabet[rand_r(&seed) % sizeof(alphabet)]);
+        }
+        int skip_at = rand_r(&seed) % 8 - 1;
+
+        uint8_t *ref_str, *ref_line;
+        int ref_eol;
+        token_log_t ref_tok = { 0, skip_at, { 0 }, { 0 } };
+        helper_simd_set_level(HELPER_SIMD_NONE);
+        ref_str = consume_string(buf, len);
+        ref_line = consume_line(buf, len, &ref_eol);
+        consume_tokens(buf, len, log_token, &ref_tok);
+
+        for (level = HELPER_SIMD_SSE2; level <= max_level; level ++) {
+            uint8_t *str, *line;
+            int eol;
+            token_log_t tok = { 0, skip_at, { 0 }, { 0 } };
+            helper_simd_set_level(level);
+            str = consume_string(buf, len);
+            line = consume_line(buf, len, &eol);
+            consume_tokens(buf, len, log_token, &tok);
+
+            if (str != ref_str || line != ref_line || eol != ref_eol || tok.count != ref_tok.count ||
+                memcmp(tok.ptr, ref_tok.ptr, sizeof(tok.ptr)) || memcmp(tok.len, ref_tok.len, sizeof(tok.len))) {
+                printf("mismatch: iteration %d level %s len %d\n", it, level_names[level], len);
+                failures ++;
+            }
+        }
+    }
+
+    return failures;
+}
+
+/* ---------------- throughput on header-like payloads ---------------- */
+
+static const char *header_lines[] = {
+    "GET /index.html?user=alice&session=0123456789abcdef HTTP/1.1\r\n",
+    "Host: www.example.com\r\n",
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n",
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n",
+    "Accept-Language: en-US,en;q=0.5\r\n",
+    "Accept-Encoding: gzip, deflate, br\r\n",
+    "Cookie: sid=8f14e45fceea167a5a36dedd4bea2543; theme=dark; lang=en\r\n",
+    "Connection: keep-alive\r\n",
+    "MAIL FROM:<bob@example.org> SIZE=1024\r\n",
+    "RCPT TO:<carol@example.net>\r\n",
+    "\r\n",
+};
+
+static uint8_t *build_payload(size_t size)
+{
+    uint8_t *buf = malloc(size);
+    size_t n = 0, i = 0;
+
+    if (buf == NULL) {
+        return NULL;
+    }
+    while (n < size) {
+        const char *l = header_lines[i ++ % ARRAY_ENTRIES(header_lines)];
+        size_t len = min(strlen(l), size - n);
+        memcpy(buf + n, l, len);
+        n += len;
+    }
+    return buf;
+}
+
+static int count_token(void *param, uint8_t *ptr, int len, int token_idx)
+{
+    (void)ptr; (void)token_idx;
+    *(size_t *)param += len;
+    return 0;
+}
+
+static void throughput(uint8_t *buf, size_t size, int level)
+{
+    double t0, gb = size / 1e9;
+    size_t lines = 0, tokens = 0;
+    uint8_t *p, *end = buf + size;
+    int eol;
+
+    helper_simd_set_level(level);
+
+    t0 = now_sec();
+    for (p = buf; p < end; ) {
+        uint8_t *next = consume_line(p, end - p, &eol);
+        if (next == NULL) {
+            break;
+        }
+        p = next;
+        lines ++;
+    }
+    double line_s = now_sec() - t0;
+
+    t0 = now_sec();
+    for (p = buf; p < end; ) {
+        uint8_t *next = consume_line(p, end - p, &eol);
+        if (next == NULL) {
+            break;
+        }
+        consume_tokens(p, next - p - eol, count_token, &tokens);
+        p = next;
+    }
+    double token_s = now_sec() - t0;
+
+    t0 = now_sec();
+    uint8_t *nul = consume_string(buf, size);
+    double string_s = now_sec() - t0;
+
+    printf("%-7s consume_line %6.2f GB/s  line+tokens %6.2f GB/s  consume_string %6.2f GB/s"
+           "  (lines=%zu tokens=%zu nul=%d)\n",
+           level_names[level], gb / line_s, gb / token_s, gb / string_s, lines, tokens, nul != NULL);
+}
+
+/* ---------------- lower_buf / hex_decode ---------------- */
+
+// Every byte value at every offset and length, against the scalar level
+static int check_lower(int max_level)
+{
+    uint8_t src[320], ref[320], out[320];
+    int len, off, level, failures = 0;
+
+    for (len = 0; len < 300; len ++) {
+        for (off = 0; off < 256; off += len < 64 ? 1 : 37) {
+            for (int i = 0; i < len; i ++) {
+                src[i] = (uint8_t)(off + i * 7);
+            }
+            memcpy(ref, src, len);
+            helper_simd_set_level(HELPER_SIMD_NONE);
+            lower_buf(ref, len);
+            for (level = HELPER_SIMD_SSE2; level <= max_level; level ++) {
+                memcpy(out, src, len);
+                helper_simd_set_level(level);
+                lower_buf(out, len);
+                if (memcmp(out, ref, len)) {
+                    printf("lower mismatch: level %s len %d off %d\n", level_names[level], len, off);
+                    failures ++;
+                }
+            }
+        }
+    }
+
+    // and the same result as lower_string()
+    char str[257];
+    for (int i = 0; i < 256; i ++) {
+        str[i] = (char)(i + 1);
+        src[i] = (uint8_t)(i + 1);
+    }
+    str[255] = '\0';
+    lower_string(str);
+    lower_buf(src, 255);
+    if (memcmp(str, src, 255)) {
+        printf("lower mismatch vs lower_string\n");
+        failures ++;
+    }
+
+    return failures;
+}
+
+// Every (hi, lo) character pair at every pair position of a 70 character
+// input, plus odd lengths, against the scalar level
+static int check_hex(int max_level)
+{
+    static const char digits[] = "0123456789abcdefABCDEF";
+    uint8_t src[71], ref[40], out[40];
+    size_t ref_err, err;
+    int pos, c, level, failures = 0;
+    unsigned seed = 3;
+
+    for (int i = 0; i < (int)sizeof(src); i ++) {
+        src[i] = digits[rand_r(&seed) % (sizeof(digits) - 1)];
+    }
+
+    for (pos = 0; pos < 70; pos += 2) {
+        for (c = 0; c < 0x10000; c ++) {
+            uint8_t save0 = src[pos], save1 = src[pos + 1];
+            size_t len = 70 + (c & 1 && pos == 68);
+            src[pos] = (uint8_t)(c >> 8);
+            src[pos + 1] = (uint8_t)c;
+
+            ref_err = err = (size_t)-2;
+            helper_simd_set_level(HELPER_SIMD_NONE);
+            ssize_t ref_n = hex_decode(ref, src, len, &ref_err);
+            for (level = HELPER_SIMD_SSE2; level <= max_level; level ++) {
+                helper_simd_set_level(level);
+                ssize_t n = hex_decode(out, src, len, &err);
+                if (n != ref_n || (n < 0 && err != ref_err) || (n > 0 && memcmp(out, ref, n))) {
+                    printf("hex mismatch: level %s pos %d pair %04x\n", level_names[level], pos, c);
+                    failures ++;
+                }
+            }
+
+            // scalar reference is itself checked against c2hex()
+            int8_t h = c2hex(src[pos]), l = c2hex(src[pos + 1]);
+            if ((h < 0 || l < 0) ? (ref_n != -1 || ref_err != (size_t)(h < 0 ? pos : pos + 1))
+                                 : (len == 70 ? ref_n != 35 || ref[pos / 2] != (uint8_t)(h << 4 | l)
+                                              : ref_n != -1 || ref_err != len - 1 + (c2hex(src[70]) >= 0))) {
+                printf("hex mismatch vs c2hex: pos %d pair %04x\n", pos, c);
+                failures ++;
+            }
+
+            src[pos] = save0;
+            src[pos + 1] = save1;
+        }
+    }
+
+    return failures;
+}
+
+static void fold_throughput(const uint8_t *payload, size_t size, int max_level)
+{
+    char *buf = malloc(size + 1);
+    uint8_t *hexbuf = malloc(size), *dst = malloc(size / 2);
+    size_t i, err;
+    double t0, gb = size / 1e9;
+    int level;
+
+    if (buf == NULL || hexbuf == NULL || dst == NULL) {
+        free(buf); free(hexbuf); free(dst);
+        return;
+    }
+
+    // lower_string() stops at NUL, the payload has none
+    memcpy(buf, payload, size);
+    buf[size] = '\0';
+    t0 = now_sec();
+    lower_string(buf);
+    printf("lower_string    %6.2f GB/s\n", gb / (now_sec() - t0));
+    for (level = HELPER_SIMD_NONE; level <= max_level; level ++) {
+        memcpy(buf, payload, size);
+        helper_simd_set_level(level);
+        t0 = now_sec();
+        lower_buf((uint8_t *)buf, size);
+        printf("lower_buf %-7s %6.2f GB/s\n", level_names[level], gb / (now_sec() - t0));
+    }
+
+    for (i = 0; i < size; i ++) {
+        hexbuf[i] = "0123456789abcdefABCDEF"[payload[i] % 22];
+    }
+    memset(dst, 0, size / 2);
+    t0 = now_sec();
+    for (i = 0; i + 1 < size; i += 2) {
+        dst[i / 2] = (uint8_t)(c2hex(hexbuf[i]) << 4 | c2hex(hexbuf[i + 1]));
+    }
+    printf("c2hex           %6.2f GB/s  (%02x)\n", gb / (now_sec() - t0), dst[size / 4]);
+    for (level = HELPER_SIMD_NONE; level <= max_level; level ++) {
+        helper_simd_set_level(level);
+        t0 = now_sec();
+        ssize_t n = hex_decode(dst, hexbuf, size & ~(size_t)1, &err);
+        printf("hex_decode %-7s%6.2f GB/s  (%zd)\n", level_names[level], gb / (now_sec() - t0), n);
+    }
+
+    free(buf);
+    free(hexbuf);
+    free(dst);
+}
+
+/* ---------------- str_split vs str_split_spans ---------------- */
+
+// strip_str() rewrites inner \t\r\n to spaces, spans keep the original bytes
+static bool span_equals_stripped(const char *t, const char *s, const str_span_t *span)
+{
+    size_t i;
+
+    if (strlen(t) != span->len) {
+        return false;
+    }
+    for (i = 0; i < span->len; i ++) {
+        char c = s[span->off + i];
+        if (t[i] != c && !(t[i] == ' ' && (c == '\t' || c == '\r' || c == '\n'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int check_split(int iterations)
+{
+    static const char alphabet[] = "ab ,;=\t'\"";
+    char buf[128];
+    delim_set_t delims;
+    str_span_t spans[128];
+    unsigned seed = 7;
+    int it, i, failures = 0;
+
+    delim_set_init(&delims, " ,;");
+    for (it = 0; it < iterations; it ++) {
+        int len = rand_r(&seed) % (int)(sizeof(buf) - 1);
+        for (i = 0; i < len; i ++) {
+            buf[i] = alphabet[rand_r(&seed) % (sizeof(alphabet) - 1)];
+        }
+        buf[len] = '\0';
+
+        int count;
+        char **tokens = str_split(buf, " ,;", &count);
+        int n = str_split_spans(buf, len, &delims, 0, spans, ARRAY_ENTRIES(spans));
+        bool ok = n == count;
+        for (i = 0; ok && i < n; i ++) {
+            ok = strlen(tokens[i]) == spans[i].len && memcmp(tokens[i], buf + spans[i].off, spans[i].len) == 0;
+        }
+
+        // with trimming/unquoting the spans must match strip_str + strip_str_quote
+        int tn = str_split_spans(buf, len, &delims, STR_SPLIT_TRIM | STR_SPLIT_QUOTE, spans, ARRAY_ENTRIES(spans));
+        int k = 0;
+        for (i = 0; ok && i < count; i ++) {
+            char *t = strip_str_quote(strip_str(tokens[i]));
+            if (*t == '\0') {
+                continue;
+            }
+            ok = k < tn && span_equals_stripped(t, buf, &spans[k]);
+            k ++;
+        }
+        ok = ok && k == tn;
+
+        if (!ok) {
+            printf("split mismatch: \"%s\"\n", buf);
+            failures ++;
+        }
+        free_split(tokens, count);
+    }
+
+    return failures;
+}
+
+static char *build_config(size_t size)
+{
+    static const char *lines[] = {
+        "policy allow tcp 10.0.0.0/8,192.168.0.0/16 80,443 \"web servers\"\n",
+        "policy deny  udp 0.0.0.0/0 53 'dns block'\n",
+        "  rule id=1024 action=learn ports=1-1024 ,  proto=tcp  \n",
+        "group name=frontend members=web1,web2,web3,web4,web5\n",
+    };
+    char *buf = malloc(size + 1);
+    size_t n = 0, i = 0;
+
+    if (buf == NULL) {
+        return NULL;
+    }
+    while (n < size) {
+        const char *l = lines[i ++ % ARRAY_ENTRIES(lines)];
+        size_t len = min(strlen(l), size - n);
+        memcpy(buf + n, l, len);
+        n += len;
+    }
+    buf[size] = '\0';
+    return buf;
+}
+
+static void split_throughput(char *text, size_t size)
+{
+    delim_set_t delims;
+    span_arena_t arena = { NULL, 0, 0 };
+    size_t tokens = 0, spans = 0;
+    char *line, *save;
+    double t0;
+
+    // str_split() per line, as the config parser does today
+    char *copy = strdup(text);
+    t0 = now_sec();
+    for (line = strtok_r(copy, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        int count;
+        char **t = str_split(line, " ,=", &count);
+        tokens += count;
+        free_split(t, count);
+    }
+    double split_s = now_sec() - t0;
+    free(copy);
+
+    // span splitter per line into a reused arena
+    delim_set_init(&delims, " ,=");
+    t0 = now_sec();
+    char *p = text, *end = text + size;
+    while (p < end) {
+        char *nl = memchr(p, '\n', end - p);
+        size_t len = nl ? (size_t)(nl - p) : (size_t)(end - p);
+        span_arena_reset(&arena);
+        str_split_arena(&arena, p, len, &delims, STR_SPLIT_TRIM | STR_SPLIT_QUOTE);
+        spans += arena.count;
+        p += len + 1;
+    }
+    double span_s = now_sec() - t0;
+    span_arena_free(&arena);
+
+    printf("str_split       %7.3f s  %6.2f MB/s  tokens=%zu\n", split_s, size / 1e6 / split_s, tokens);
+    printf("str_split_spans %7.3f s  %6.2f MB/s  tokens=%zu\n", span_s, size / 1e6 / span_s, spans);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 100;
+    int iterations = argc > 2 ? atoi(argv[2]) : 200000;
+    int max_level = helper_simd_set_level(-1);
+    int level;
+
+    printf("cpu simd level: %s\n", level_names[max_level]);
+
+    int failures = fuzz(iterations, max_level);
+    printf("fuzz: %d iterations, %d mismatches\n", iterations, failures);
+
+    size_t size = (mb ? mb : 1) << 20;
+    uint8_t *buf = build_payload(size);
+    if (buf == NULL) {
+        return 1;
+    }
+    for (level = HELPER_SIMD_NONE; level <= max_level; level ++) {
+        throughput(buf, size, level);
+    }
+
+    int fold_failures = check_lower(max_level) + check_hex(max_level);
+    printf("lower/hex check: %d mismatches\n", fold_failures);
+    failures += fold_failures;
+    fold_throughput(buf, size, max_level);
+    free(buf);
+
+    int split_failures = check_split(iterations / 10);
+    printf("split check: %d iterations, %d mismatches\n", iterations / 10, split_failures);
+    failures += split_failures;
+
+    char *config = build_config(size);
+    if (config == NULL) {
+        return 1;
+    }
+    split_throughput(config, size);
+    free(config);
+
+    return failures ? 1 : 0;
+}
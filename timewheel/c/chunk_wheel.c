@@ -0,0 +1,328 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "chunk_wheel.h"
+#include "wheel_clock.h"
+#include "helper.h"
+
+#define CHUNK_WHEEL_MASK        (CHUNK_WHEEL_SLOTS - 1)
+// Records between the one being processed and the entry being prefetched
+#define CHUNK_WHEEL_PREFETCH    8
+
+static chunk_t *chunk_alloc(chunk_wheel_t *w)
+{
+    chunk_t *c = w->free_chunks;
+
+    if (likely(c != NULL)) {
+        w->free_chunks = c->next;
+        return c;
+    }
+    // Like wheel_metrics, the hot path has no way to report running out of
+    // memory; chunk_wheel_reserve() avoids getting here
+    if (posix_memalign((void **)&c, 64, sizeof(*c)) != 0) {
+        abort();
+    }
+    w->chunks ++;
+    return c;
+}
+
+static inline void chunk_free(chunk_wheel_t *w, chunk_t *c)
+{
+    c->next = w->free_chunks;
+    w->free_chunks = c;
+}
+
+static inline void chunk_entry_link(chunk_wheel_t *w, chunk_entry_t *n, uint32_t expire_at)
+{
+    uint32_t idx = expire_at & CHUNK_WHEEL_MASK;
+    chunk_t *c = w->slots[idx];
+
+    if (unlikely(c == NULL || c->used == CHUNK_WHEEL_CHUNK)) {
+        chunk_t *head = chunk_alloc(w);
+        head->next = c;
+        head->used = 0;
+        head->slot = idx;
+        head->detached = false;
+        w->slots[idx] = c = head;
+    }
+    n->chunk = c;
+    n->index = c->used;
+    c->recs[c->used].entry = n;
+    c->recs[c->used].expire_at = expire_at;
+    c->used ++;
+}
+
+/*
+ * Take the timer's record out of its slot: fill the hole with the slot's last
+ * record, which is in the slot's first chunk, and free that chunk when it
+ * becomes empty. In a chunk detached by chunk_wheel_roll() the record is only
+ * cleared, so the roll's iteration is never disturbed.
+ */
+static inline void chunk_entry_unlink(chunk_wheel_t *w, chunk_entry_t *n)
+{
+    chunk_t *c = n->chunk;
+
+    if (unlikely(c->detached)) {
+        c->recs[n->index].entry = NULL;
+    } else {
+        chunk_t *head = w->slots[c->slot];
+        chunk_rec_t *last = &head->recs[-- head->used];
+
+        if (last->entry != n) {
+            c->recs[n->index] = *last;
+            last->entry->chunk = c;
+            last->entry->index = n->index;
+        }
+        if (head->used == 0) {
+            w->slots[c->slot] = head->next;
+            chunk_free(w, head);
+        }
+    }
+    n->chunk = NULL;
+}
+
+/**
+ * chunk_wheel_init - Initialize a chunked timer wheel
+ * @w: Pointer to the timer wheel to initialize
+ *
+ * All slots start empty and no chunk is allocated; see chunk_wheel_reserve().
+ */
+void chunk_wheel_init(chunk_wheel_t *w)
+{
+    memset(w, 0, sizeof(*w));
+    w->tick_ns = 1;
+}
+
+/**
+ * chunk_wheel_destroy - Free all chunks of a timer wheel
+ * @w: Pointer to the timer wheel
+ *
+ * Timers still armed are dropped without their callbacks being run.
+ */
+void chunk_wheel_destroy(chunk_wheel_t *w)
+{
+    chunk_t *c, *next;
+    uint32_t i;
+
+    for (i = 0; i < CHUNK_WHEEL_SLOTS; i ++) {
+        for (c = w->slots[i]; c != NULL; c = next) {
+            next = c->next;
+            free(c);
+        }
+        w->slots[i] = NULL;
+    }
+    for (c = w->free_chunks; c != NULL; c = next) {
+        next = c->next;
+        free(c);
+    }
+    w->free_chunks = NULL;
+    w->chunks = 0;
+    w->count = 0;
+}
+
+/**
+ * chunk_wheel_reserve - Preallocate chunks
+ * @w: Pointer to the timer wheel
+ * @timers: Number of timers expected to be armed at the same time
+ *
+ * Grows the free list so that @timers timers fit without calling malloc,
+ * counting one partially filled chunk per slot.
+ *
+ * Return: 0, or -1 when out of memory
+ */
+int chunk_wheel_reserve(chunk_wheel_t *w, uint32_t timers)
+{
+    uint32_t want = (timers + CHUNK_WHEEL_CHUNK - 1) / CHUNK_WHEEL_CHUNK + CHUNK_WHEEL_SLOTS;
+
+    while (w->chunks < want) {
+        chunk_t *c;
+        if (posix_memalign((void **)&c, 64, sizeof(*c)) != 0) {
+            return -1;
+        }
+        w->chunks ++;
+        chunk_free(w, c);
+    }
+    return 0;
+}
+
+/**
+ * chunk_wheel_set_metrics - Attach a metrics object to the timer wheel
+ * @w: Pointer to the timer wheel
+ * @m: Metrics to update, or NULL to turn metrics off
+ * @tick_ns: Length of one time unit in nanoseconds, 0 reports lateness in
+ *           time units
+ *
+ * Same counters as timer_wheel_set_metrics(); lateness is recorded per slot.
+ */
+void chunk_wheel_set_metrics(chunk_wheel_t *w, wheel_metrics_t *m, uint64_t tick_ns)
+{
+    w->metrics = m;
+    w->tick_ns = tick_ns ? tick_ns : 1;
+}
+
+void chunk_wheel_start(chunk_wheel_t *w, uint32_t now)
+{
+    w->current = now;
+}
+
+/*
+ * Process every record of one slot against @now. The slot's chunks are
+ * detached first: timers that are not due, or were touched since they were
+ * linked, are linked again into fresh chunks (of this or a later slot) and
+ * the detached chunks are freed once walked.
+ */
+static uint32_t chunk_wheel_roll_slot(chunk_wheel_t *w, uint32_t idx, uint32_t now,
+                                      uint32_t *moved, uint32_t *seen)
+{
+    chunk_t *c = w->slots[idx], *next;
+    uint32_t i, cnt = 0;
+
+    w->slots[idx] = NULL;
+    for (next = c; next != NULL; next = next->next) {
+        next->detached = true;
+        *seen += next->used;
+    }
+
+    for (; c != NULL; c = next) {
+        next = c->next;
+        if (next != NULL) {
+            __builtin_prefetch(next);
+        }
+        for (i = 0; i < c->used; i ++) {
+            chunk_rec_t *r = &c->recs[i];
+            chunk_entry_t *n = r->entry;
+            uint32_t target;
+
+            if (likely(i + CHUNK_WHEEL_PREFETCH < c->used)) {
+                __builtin_prefetch(c->recs[i + CHUNK_WHEEL_PREFETCH].entry, 1);
+            }
+            if (unlikely(n == NULL)) {
+                // Removed by an earlier callback of this roll
+                continue;
+            }
+            if ((int32_t)(r->expire_at - now) >= 0) {
+                // A later revolution
+                chunk_entry_link(w, n, r->expire_at);
+                continue;
+            }
+            target = n->last_seen + n->timeout;
+            if ((int32_t)(target - now) >= 0) {
+                // Touched since it was linked
+                chunk_entry_link(w, n, target);
+                (*moved) ++;
+                continue;
+            }
+            n->chunk = NULL;
+            w->count --;
+            cnt ++;
+            n->callback(n);
+        }
+        chunk_free(w, c);
+    }
+    return cnt;
+}
+
+/**
+ * chunk_wheel_roll - Advance the timer wheel and process expired timers
+ * @w: Pointer to the timer wheel
+ * @now: The current time value
+ *
+ * Processes the slots from the current time up to, but not including, @now,
+ * at most one revolution, and runs the callback of every timer that expired
+ * before @now. Semantics match timer_wheel_roll() for one-shot timers.
+ *
+ * Return: The number of timers that expired
+ */
+uint32_t chunk_wheel_roll(chunk_wheel_t *w, uint32_t now)
+{
+    wheel_metrics_t *metrics = w->metrics;
+    uint64_t start;
+    uint32_t s, steps, cnt = 0, moved = 0;
+
+    if (now < w->current) {
+        return 0;
+    }
+    start = metrics ? wheel_clock_ns() : 0;
+    steps = min(now - w->current, CHUNK_WHEEL_SLOTS);
+
+    for (s = w->current; s != w->current + steps; s ++) {
+        uint32_t idx = s & CHUNK_WHEEL_MASK, slot_cnt, seen = 0;
+
+        if (w->slots[idx] == NULL) {
+            continue;
+        }
+        slot_cnt = chunk_wheel_roll_slot(w, idx, now, &moved, &seen);
+        if (unlikely(metrics != NULL)) {
+            wheel_metrics_slot(metrics, seen);
+            wheel_metrics_record(metrics, WHEEL_HIST_LATENESS, (uint64_t)(now - s) * w->tick_ns, slot_cnt);
+        }
+        cnt += slot_cnt;
+    }
+
+    w->current = now;
+
+    if (unlikely(metrics != NULL)) {
+        wheel_metrics_count(metrics, WHEEL_METRIC_EXPIRE, cnt);
+        wheel_metrics_count(metrics, WHEEL_METRIC_REFRESH, moved);
+        wheel_metrics_count(metrics, WHEEL_METRIC_TICK, 1);
+        wheel_metrics_record(metrics, WHEEL_HIST_TICK, wheel_clock_ns() - start, 1);
+    }
+    return cnt;
+}
+
+/**
+ * chunk_wheel_entry_init - Initialize a timer entry
+ * @n: Pointer to the timer entry to initialize
+ */
+void chunk_wheel_entry_init(chunk_entry_t *n)
+{
+    memset(n, 0, sizeof(*n));
+}
+
+/**
+ * chunk_wheel_entry_start - Start a timer
+ * @w: Pointer to the timer wheel
+ * @n: Pointer to an inactive timer entry
+ * @cb: Callback to run when the timer expires
+ * @timeout: Timeout in time units, may exceed one revolution (up to 2^31 - 1)
+ * @now: The current time value
+ */
+void chunk_wheel_entry_start(chunk_wheel_t *w, chunk_entry_t *n,
+                             chunk_wheel_expire_fct cb, uint32_t timeout, uint32_t now)
+{
+    if (unlikely(timeout > INT32_MAX)) {
+        timeout = INT32_MAX;
+    }
+    n->callback = cb;
+    n->timeout = timeout;
+    n->last_seen = now;
+    chunk_entry_link(w, n, now + timeout);
+    w->count ++;
+    wheel_metrics_count(w->metrics, WHEEL_METRIC_INSERT, 1);
+}
+
+/**
+ * chunk_wheel_entry_refresh - Restart an active timer's timeout from @now
+ * @w: Pointer to the timer wheel
+ * @n: Pointer to the active timer entry
+ * @now: The current time value
+ */
+void chunk_wheel_entry_refresh(chunk_wheel_t *w, chunk_entry_t *n, uint32_t now)
+{
+    chunk_entry_unlink(w, n);
+    n->last_seen = now;
+    chunk_entry_link(w, n, now + n->timeout);
+    wheel_metrics_count(w->metrics, WHEEL_METRIC_REFRESH, 1);
+}
+
+/**
+ * chunk_wheel_entry_remove - Cancel an active timer
+ * @w: Pointer to the timer wheel
+ * @n: Pointer to the active timer entry
+ */
+void chunk_wheel_entry_remove(chunk_wheel_t *w, chunk_entry_t *n)
+{
+    chunk_entry_unlink(w, n);
+    w->count --;
+    wheel_metrics_count(w->metrics, WHEEL_METRIC_CANCEL, 1);
+}
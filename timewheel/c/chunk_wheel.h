@@ -0,0 +1,112 @@
+#ifndef __CHUNK_WHEEL_H__
+#define __CHUNK_WHEEL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "wheel_metrics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Timer wheel with array slots, an alternative to timer_wheel_t.
+//
+// timer_wheel_t links entries into per-slot lists, so expiring a slot chases
+// one pointer per timer through scattered memory: the next timer is not known
+// until the current one has been loaded. Here every slot is a list of chunks
+// of CHUNK_WHEEL_CHUNK compact {entry, expire_at} records. A roll streams
+// through the records and prefetches the entries a few records ahead, so the
+// cache misses on the entries overlap instead of forming a chain. Cancelling
+// swap-removes: the slot's last
+// record is moved into the hole, located through the chunk and index the
+// entry remembers, so it stays O(1).
+//
+// A roll detaches the due slot's chunks before running any callback, so
+// callbacks may start, refresh or remove any timer: removing one whose record
+// is in a detached chunk only clears the record. Records carry the full 32-bit
+// expiry time, so timeouts may be longer than one revolution; a record that
+// is not due yet is moved to the slot's new chunks.
+//
+// Chunks are recycled through a free list; chunk_wheel_reserve() fills it up
+// front so that the steady state never calls malloc.
+
+#define CHUNK_WHEEL_SLOTS   4096                // power of two
+#define CHUNK_WHEEL_CHUNK   64                  // records per chunk
+
+struct chunk_entry_;
+struct chunk_;
+
+typedef void (*chunk_wheel_expire_fct)(struct chunk_entry_ *n);
+
+typedef struct chunk_rec_ {
+    struct chunk_entry_ *entry;                 // NULL: cancelled during a roll
+    uint32_t expire_at;
+} chunk_rec_t;
+
+typedef struct chunk_ {
+    struct chunk_ *next;
+    uint16_t used;
+    uint16_t slot;
+    bool detached;                              // being processed by chunk_wheel_roll()
+    chunk_rec_t recs[CHUNK_WHEEL_CHUNK];
+} chunk_t;
+
+typedef struct chunk_wheel_ {
+    // Each slot's first chunk is the only one that may be partially filled
+    chunk_t *slots[CHUNK_WHEEL_SLOTS];
+    chunk_t *free_chunks;
+    uint32_t count;
+    uint32_t current;
+    uint32_t chunks;                            // allocated, including free ones
+    wheel_metrics_t *metrics;
+    uint64_t tick_ns;
+} chunk_wheel_t;
+
+typedef struct chunk_entry_ {
+    chunk_t *chunk;                             // chunk holding the record, NULL when not armed
+    chunk_wheel_expire_fct callback;
+    uint32_t timeout;
+    uint32_t last_seen;                         // last start/refresh/touch time
+    uint16_t index;                             // record index in chunk
+} chunk_entry_t;
+
+void chunk_wheel_init(chunk_wheel_t *w);
+void chunk_wheel_destroy(chunk_wheel_t *w);
+int chunk_wheel_reserve(chunk_wheel_t *w, uint32_t timers);
+void chunk_wheel_set_metrics(chunk_wheel_t *w, wheel_metrics_t *m, uint64_t tick_ns);
+void chunk_wheel_start(chunk_wheel_t *w, uint32_t now);
+uint32_t chunk_wheel_roll(chunk_wheel_t *w, uint32_t now);
+
+static inline uint32_t chunk_wheel_current(const chunk_wheel_t *w)
+{
+    return w->current;
+}
+
+static inline uint32_t chunk_wheel_count(const chunk_wheel_t *w)
+{
+    return w->count;
+}
+
+void chunk_wheel_entry_init(chunk_entry_t *n);
+void chunk_wheel_entry_start(chunk_wheel_t *w, chunk_entry_t *n,
+                             chunk_wheel_expire_fct cb, uint32_t timeout, uint32_t now);
+void chunk_wheel_entry_refresh(chunk_wheel_t *w, chunk_entry_t *n, uint32_t now);
+void chunk_wheel_entry_remove(chunk_wheel_t *w, chunk_entry_t *n);
+
+// Lazy refresh, as timer_wheel_entry_touch(): the timer is moved to
+// (last_seen + timeout) when its current slot comes due
+static inline void chunk_wheel_entry_touch(chunk_entry_t *n, uint32_t now)
+{
+    n->last_seen = now;
+}
+
+static inline bool chunk_wheel_entry_is_active(const chunk_entry_t *n)
+{
+    return n->chunk != NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
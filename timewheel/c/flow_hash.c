@@ -0,0 +1,342 @@
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "helper.h"
+#include "flow_hash.h"
+
+/*
+ * wyhash-style mixing: a 64x64->128 multiply folded back to 64 bits mixes
+ * every input bit into every output bit in one instruction, and independent
+ * 16/48 byte lanes keep the dependency chain short on longer keys.
+ */
+static const uint64_t wysecret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull,
+};
+
+static inline void wymum(uint64_t *a, uint64_t *b)
+{
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t wymix(uint64_t a, uint64_t b)
+{
+    wymum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t wyr8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t wyr4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t wyr3(const uint8_t *p, size_t k)
+{
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+uint64_t hash_bytes(const void *key, size_t len, uint64_t seed)
+{
+    const uint8_t *p = key;
+    uint64_t a, b;
+
+    seed ^= wymix(seed ^ wysecret[0], wysecret[1]);
+    if (likely(len <= 16)) {
+        if (likely(len >= 4)) {
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        } else if (likely(len > 0)) {
+            a = wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (unlikely(i > 48)) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(wyr8(p) ^ wysecret[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ wysecret[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ wysecret[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (likely(i > 48));
+            seed ^= see1 ^ see2;
+        }
+        while (unlikely(i > 16)) {
+            seed = wymix(wyr8(p) ^ wysecret[1], wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+
+    a ^= wysecret[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ wysecret[0] ^ len, b ^ wysecret[1]);
+}
+
+/*
+ * CRC32C (Castagnoli, reflected polynomial 0x82f63b78). The table is only
+ * used when the CPU has no SSE4.2; it is built on first use.
+ */
+static uint32_t crc32c_table[8][256];
+static int crc32c_mode = -1;            // -1 unknown, 0 table, 1 sse4.2
+
+static void crc32c_init_table(void)
+{
+    uint32_t c;
+    int i, j;
+
+    for (i = 0; i < 256; i ++) {
+        c = i;
+        for (j = 0; j < 8; j ++) {
+            c = c & 1 ? (c >> 1) ^ 0x82f63b78u : c >> 1;
+        }
+        crc32c_table[0][i] = c;
+    }
+    for (i = 0; i < 256; i ++) {
+        c = crc32c_table[0][i];
+        for (j = 1; j < 8; j ++) {
+            c = crc32c_table[0][c & 0xff] ^ (c >> 8);
+            crc32c_table[j][i] = c;
+        }
+    }
+}
+
+// slicing-by-8
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t *p, size_t len)
+{
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t v = wyr8(p) ^ crc;
+        crc = crc32c_table[7][v & 0xff] ^ crc32c_table[6][(v >> 8) & 0xff] ^
+              crc32c_table[5][(v >> 16) & 0xff] ^ crc32c_table[4][(v >> 24) & 0xff] ^
+              crc32c_table[3][(v >> 32) & 0xff] ^ crc32c_table[2][(v >> 40) & 0xff] ^
+              crc32c_table[1][(v >> 48) & 0xff] ^ crc32c_table[0][v >> 56];
+    }
+    for (; len; p ++, len --) {
+        crc = crc32c_table[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *p, size_t len)
+{
+    uint64_t c = crc;
+
+    for (; len >= 8; p += 8, len -= 8) {
+        c = _mm_crc32_u64(c, wyr8(p));
+    }
+    crc = (uint32_t)c;
+    if (len >= 4) {
+        crc = _mm_crc32_u32(crc, (uint32_t)wyr4(p));
+        p += 4;
+        len -= 4;
+    }
+    for (; len; p ++, len --) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+#endif
+
+int crc32c_hw(void)
+{
+    if (unlikely(crc32c_mode < 0)) {
+        int mode = 0;
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        mode = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+#endif
+        if (mode == 0) {
+            crc32c_init_table();
+        }
+        crc32c_mode = mode;
+    }
+    return crc32c_mode;
+}
+
+// Standard CRC32C: pass 0 as the initial crc; the pre/post inversion is done here
+uint32_t crc32c(uint32_t crc, const void *data, size_t len)
+{
+    crc = ~crc;
+#if defined(__x86_64__)
+    if (likely(crc32c_hw())) {
+        return ~crc32c_sse42(crc, data, len);
+    }
+#else
+    crc32c_hw();
+#endif
+    return ~crc32c_sw(crc, data, len);
+}
+
+/*
+ * Symmetric 5-tuple hashes: order the two (address, port) endpoints before
+ * hashing, so both directions of a connection produce the same value.
+ */
+static inline int flow_src_first(const flow_key_t *key)
+{
+    int c = memcmp(key->src_ip, key->dst_ip, 16);
+    return c < 0 || (c == 0 && key->src_port <= key->dst_port);
+}
+
+uint32_t flow_hash_sym(const flow_key_t *key, uint64_t seed)
+{
+    const uint8_t *lo = key->src_ip, *hi = key->dst_ip;
+    uint64_t ports, h;
+
+    if (flow_src_first(key)) {
+        ports = (uint64_t)key->src_port << 16 | key->dst_port;
+    } else {
+        lo = key->dst_ip;
+        hi = key->src_ip;
+        ports = (uint64_t)key->dst_port << 16 | key->src_port;
+    }
+    ports |= (uint64_t)key->proto << 32;
+
+    // both multiplicands get a secret, an IPv4 key's zero upper half must not zero the product
+    h = wymix(wyr8(lo) ^ wysecret[1], wyr8(lo + 8) ^ seed ^ wysecret[0]);
+    h = wymix(wyr8(hi) ^ wysecret[2], wyr8(hi + 8) ^ h ^ wysecret[3]);
+    h = wymix(ports ^ wysecret[3], h ^ wysecret[0]);
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+uint32_t flow_hash_sym_crc(const flow_key_t *key, uint32_t seed)
+{
+    flow_key_t k;
+
+    if (flow_src_first(key)) {
+        k = *key;
+    } else {
+        memcpy(k.src_ip, key->dst_ip, 16);
+        memcpy(k.dst_ip, key->src_ip, 16);
+        k.src_port = key->dst_port;
+        k.dst_port = key->src_port;
+        k.proto = key->proto;
+        memset(k.pad, 0, sizeof(k.pad));
+    }
+    return crc32c(seed, &k, sizeof(k));
+}
+
+/*
+ * Toeplitz hash: for every set bit i of the input (MSB first), XOR in the
+ * 32-bit window of the key that starts at bit i. The contribution of a byte
+ * only depends on its value and offset, so it is precomputed per offset.
+ */
+const uint8_t rss_default_key[RSS_KEY_LEN] = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67,
+    0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0, 0xd0, 0xca, 0x2b, 0xcb,
+    0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30,
+    0xf2, 0x0c, 0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+const uint8_t rss_symmetric_key[RSS_KEY_LEN] = {
+    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+    0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+};
+
+// 32 key bits starting at bit offset bit (MSB first), zero past the end of the key
+static uint32_t toeplitz_window(const uint8_t *key, size_t key_len, size_t bit)
+{
+    uint64_t w = 0;
+    size_t i, byte = bit / 8;
+
+    for (i = 0; i < 5; i ++) {
+        w = w << 8 | (byte + i < key_len ? key[byte + i] : 0);
+    }
+    return (uint32_t)(w >> (8 - bit % 8));
+}
+
+uint32_t toeplitz_hash_slow(const uint8_t *key, size_t key_len, const uint8_t *data, size_t len)
+{
+    uint32_t h = 0;
+    size_t i;
+    int b;
+
+    for (i = 0; i < len; i ++) {
+        for (b = 0; b < 8; b ++) {
+            if (data[i] & (0x80 >> b)) {
+                h ^= toeplitz_window(key, key_len, i * 8 + b);
+            }
+        }
+    }
+    return h;
+}
+
+void toeplitz_init(toeplitz_ctx_t *ctx, const uint8_t *key, size_t key_len)
+{
+    size_t i;
+    int v, b;
+
+    for (i = 0; i < RSS_MAX_INPUT; i ++) {
+        uint32_t w[8];
+        for (b = 0; b < 8; b ++) {
+            w[b] = toeplitz_window(key, key_len, i * 8 + b);
+        }
+        for (v = 0; v < 256; v ++) {
+            uint32_t h = 0;
+            for (b = 0; b < 8; b ++) {
+                if (v & (0x80 >> b)) {
+                    h ^= w[b];
+                }
+            }
+            ctx->lut[i][v] = h;
+        }
+    }
+}
+
+uint32_t toeplitz_hash(const toeplitz_ctx_t *ctx, const uint8_t *data, size_t len)
+{
+    uint32_t h = 0;
+    size_t i;
+
+    if (len > RSS_MAX_INPUT) {
+        len = RSS_MAX_INPUT;
+    }
+    for (i = 0; i < len; i ++) {
+        h ^= ctx->lut[i][data[i]];
+    }
+    return h;
+}
+
+uint32_t rss_hash_v4(const toeplitz_ctx_t *ctx, uint32_t sip, uint32_t dip, uint16_t sport, uint16_t dport)
+{
+    uint8_t in[12];
+
+    memcpy(in, &sip, 4);
+    memcpy(in + 4, &dip, 4);
+    memcpy(in + 8, &sport, 2);
+    memcpy(in + 10, &dport, 2);
+    return toeplitz_hash(ctx, in, sizeof(in));
+}
+
+uint32_t rss_hash_v6(const toeplitz_ctx_t *ctx, const uint8_t *sip, const uint8_t *dip,
+                     uint16_t sport, uint16_t dport)
+{
+    uint8_t in[36];
+
+    memcpy(in, sip, 16);
+    memcpy(in + 16, dip, 16);
+    memcpy(in + 32, &sport, 2);
+    memcpy(in + 34, &dport, 2);
+    return toeplitz_hash(ctx, in, sizeof(in));
+}
@@ -0,0 +1,82 @@
+#ifndef __FLOW_HASH_H__
+#define __FLOW_HASH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Non-cryptographic hashing for session tables and flow sharding.
+//
+// sdbm_hash() in helper.h walks the key one byte at a time with a long
+// dependency chain and mixes the high bits poorly. These are built for short
+// fixed-size network keys instead:
+//   hash_bytes()    wyhash-style 64-bit hash for variable-length data
+//   crc32c()        CRC32C, SSE4.2 instruction when available, table otherwise
+//   flow_hash_*()   symmetric 5-tuple hashes: A->B and B->A land in the same bucket
+//   toeplitz_*()    Toeplitz hash as computed by NIC RSS, so software sharding
+//                   can pick the same queue as the hardware did
+
+// 5-tuple. IPv4 addresses use the first 4 bytes of src_ip/dst_ip with the
+// rest zeroed; zero the whole key (including pad) before filling it in.
+typedef struct flow_key_ {
+    uint8_t src_ip[16];
+    uint8_t dst_ip[16];
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t proto;
+    uint8_t pad[3];
+} flow_key_t;
+
+uint64_t hash_bytes(const void *key, size_t len, uint64_t seed);
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+// Whether crc32c() uses the SSE4.2 instruction
+int crc32c_hw(void);
+
+uint32_t flow_hash_sym(const flow_key_t *key, uint64_t seed);
+uint32_t flow_hash_sym_crc(const flow_key_t *key, uint32_t seed);
+
+// IPv4 fast path, addresses and ports in any (but consistent) byte order
+static inline uint32_t flow_hash_sym_v4(uint32_t sip, uint32_t dip, uint16_t sport, uint16_t dport,
+                                        uint8_t proto, uint64_t seed)
+{
+    uint64_t a = (uint64_t)sip << 16 | sport, b = (uint64_t)dip << 16 | dport;
+    uint64_t lo = a < b ? a : b, hi = a < b ? b : a;
+    __uint128_t r = (__uint128_t)(lo ^ seed ^ 0x2d358dccaa6c78a5ull) * (hi ^ ((uint64_t)proto << 56) ^ 0x8bb84b93962eacc9ull);
+    uint64_t h = (uint64_t)r ^ (uint64_t)(r >> 64);
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+// Toeplitz/RSS
+#define RSS_KEY_LEN    40
+#define RSS_MAX_INPUT  (RSS_KEY_LEN - 4)   // 36 bytes: IPv6 addresses + ports
+
+// Microsoft's default RSS key, used by most NIC drivers out of the box
+extern const uint8_t rss_default_key[RSS_KEY_LEN];
+// 0x6d5a repeated: the hash is unchanged when addresses and ports are swapped
+extern const uint8_t rss_symmetric_key[RSS_KEY_LEN];
+
+// Per-byte lookup tables for one key: lut[i][b] is the hash contribution of
+// byte value b at input offset i, so hashing costs one load per input byte
+typedef struct toeplitz_ctx_ {
+    uint32_t lut[RSS_MAX_INPUT][256];
+} toeplitz_ctx_t;
+
+void toeplitz_init(toeplitz_ctx_t *ctx, const uint8_t *key, size_t key_len);
+uint32_t toeplitz_hash(const toeplitz_ctx_t *ctx, const uint8_t *data, size_t len);
+// Bit-serial reference implementation, len <= key_len - 4
+uint32_t toeplitz_hash_slow(const uint8_t *key, size_t key_len, const uint8_t *data, size_t len);
+
+// RSS input layouts: addresses and ports in network byte order
+uint32_t rss_hash_v4(const toeplitz_ctx_t *ctx, uint32_t sip, uint32_t dip, uint16_t sport, uint16_t dport);
+uint32_t rss_hash_v6(const toeplitz_ctx_t *ctx, const uint8_t *sip, const uint8_t *dip,
+                     uint16_t sport, uint16_t dport);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
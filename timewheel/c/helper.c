@@ -4,6 +4,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <arpa/inet.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 #include "helper.h"
 
@@ -111,7 +114,7 @@ int8_t c2hex(uint8_t c)
     return hex[c];
 }
 
-uint8_t *consume_string(uint8_t *ptr, int len)
+static uint8_t *consume_string_scalar(uint8_t *ptr, int len)
 {
     register uint8_t *l = ptr, *end = ptr + len;
 
@@ -127,7 +130,7 @@ uint8_t *consume_string(uint8_t *ptr, int len)
 }
 
 // eol_chars: return number of EOL characters. eg: if line ends with '\r\n', then 2.
-uint8_t *consume_line(uint8_t *ptr, int len, int *eol_chars)
+static uint8_t *consume_line_scalar(uint8_t *ptr, int len, int *eol_chars)
 {
     register uint8_t *l = ptr, *end = ptr + len;
     register int n = 0;
@@ -149,7 +152,7 @@ uint8_t *consume_line(uint8_t *ptr, int len, int *eol_chars)
     return NULL;
 }
 
-void consume_tokens(uint8_t *ptr, int len, token_func_t func, void *param)
+static void consume_tokens_scalar(uint8_t *ptr, int len, token_func_t func, void *param)
 {
     register uint8_t *l = ptr, *end = ptr + len, *token = NULL;
     int idx = 0;
@@ -177,6 +180,390 @@ void consume_tokens(uint8_t *ptr, int len, token_func_t func, void *param)
     }
 }
 
+/*
+ * SIMD scanners
+ *
+ * Locate a byte 16/32 bytes at a time: compare a whole vector, movemask the
+ * result and take ctz of the first set bit. Loads never leave [p, end): the
+ * last vector is loaded overlapping the previous one and the bytes already
+ * checked are shifted out of the mask. Buffers shorter than one vector are
+ * walked byte by byte.
+ *
+ * Tokenizing builds a 64-bit "is space" mask per 64 bytes and walks the
+ * space/non-space edges with ctz, so short tokens cost a few bit operations
+ * instead of a function call each.
+ */
+typedef const uint8_t *(*scan_fn_t)(const uint8_t *p, const uint8_t *end, uint8_t c);
+typedef uint64_t (*mask64_fn_t)(const uint8_t *p, uint8_t c);
+
+static const uint8_t *find_eq_scalar(const uint8_t *p, const uint8_t *end, uint8_t c)
+{
+    for (; p < end; p ++) {
+        if (*p == c) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static uint64_t mask_eq_scalar(const uint8_t *p, int n, uint8_t c)
+{
+    uint64_t m = 0;
+    int i;
+
+    for (i = 0; i < n; i ++) {
+        m |= (uint64_t)(p[i] == c) << i;
+    }
+    return m;
+}
+
+static uint64_t mask64_eq_scalar(const uint8_t *p, uint8_t c)
+{
+    return mask_eq_scalar(p, 64, c);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static const uint8_t *find_eq_sse2(const uint8_t *p, const uint8_t *end, uint8_t c)
+{
+    const __m128i v = _mm_set1_epi8((char)c);
+    uint32_t m;
+
+    if (end - p < 16) {
+        return find_eq_scalar(p, end, c);
+    }
+    for (; end - p > 16; p += 16) {
+        m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), v));
+        if (m) {
+            return p + __builtin_ctz(m);
+        }
+    }
+
+    const uint8_t *q = end - 16;
+    m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)q), v));
+    m >>= p - q;
+    return m ? p + __builtin_ctz(m) : NULL;
+}
+
+static uint64_t mask64_eq_sse2(const uint8_t *p, uint8_t c)
+{
+    const __m128i v = _mm_set1_epi8((char)c);
+    uint64_t m0 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), v));
+    uint64_t m1 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 16)), v));
+    uint64_t m2 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 32)), v));
+    uint64_t m3 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 48)), v));
+    return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+}
+
+__attribute__((target("avx2")))
+static const uint8_t *find_eq_avx2(const uint8_t *p, const uint8_t *end, uint8_t c)
+{
+    const __m256i v = _mm256_set1_epi8((char)c);
+    uint32_t m;
+
+    if (end - p < 32) {
+        return find_eq_scalar(p, end, c);
+    }
+    for (; end - p > 32; p += 32) {
+        m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), v));
+        if (m) {
+            return p + __builtin_ctz(m);
+        }
+    }
+
+    const uint8_t *q = end - 32;
+    m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)q), v));
+    m >>= p - q;
+    return m ? p + __builtin_ctz(m) : NULL;
+}
+
+__attribute__((target("avx2")))
+static uint64_t mask64_eq_avx2(const uint8_t *p, uint8_t c)
+{
+    const __m256i v = _mm256_set1_epi8((char)c);
+    uint64_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), v));
+    uint64_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + 32)), v));
+    return lo | (hi << 32);
+}
+#endif
+
+/*
+ * Case folding and hex decoding
+ *
+ * lower: 'A'..'Z' are moved to the bottom of the signed byte range by adding
+ * 0x80 - 'A', so one signed compare selects them and 0x20 is added under the
+ * mask. Folding is idempotent, so the tail is done with an overlapping vector.
+ *
+ * hex: every character is classified as digit or (case-folded) 'a'..'f' the
+ * same way and turned into its nibble value; adjacent nibbles are then merged
+ * inside each 16-bit lane (hi << 4 | lo) and packed down to bytes. A vector
+ * with any invalid character stops the SIMD loop and the scalar loop takes
+ * over from there to find the exact position.
+ */
+typedef void (*lower_fn_t)(uint8_t *p, size_t len);
+typedef size_t (*hex_fn_t)(uint8_t *dst, const uint8_t *src, size_t len);
+
+static void lower_buf_scalar(uint8_t *p, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i ++) {
+        if (p[i] >= 'A' && p[i] <= 'Z') {
+            p[i] += 32;
+        }
+    }
+}
+
+// SIMD part of hex decoding returns the number of source bytes consumed
+static size_t hex_decode_none(uint8_t *dst, const uint8_t *src, size_t len)
+{
+    (void)dst; (void)src; (void)len;
+    return 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline __m128i lower16(__m128i v)
+{
+    __m128i t = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - 'A')));
+    __m128i upper = _mm_cmplt_epi8(t, _mm_set1_epi8((char)(0x80 + 26)));
+    return _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+static void lower_buf_sse2(uint8_t *p, size_t len)
+{
+    size_t i;
+
+    if (len < 16) {
+        lower_buf_scalar(p, len);
+        return;
+    }
+    for (i = 0; i + 16 <= len; i += 16) {
+        _mm_storeu_si128((__m128i *)(p + i), lower16(_mm_loadu_si128((const __m128i *)(p + i))));
+    }
+    if (i < len) {
+        i = len - 16;
+        _mm_storeu_si128((__m128i *)(p + i), lower16(_mm_loadu_si128((const __m128i *)(p + i))));
+    }
+}
+
+static size_t hex_decode_sse2(uint8_t *dst, const uint8_t *src, size_t len)
+{
+    const __m128i lo_byte = _mm_set1_epi16(0x00ff);
+    size_t i;
+
+    for (i = 0; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i l = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i digit = _mm_cmplt_epi8(_mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - '0'))),
+                                       _mm_set1_epi8((char)(0x80 + 10)));
+        __m128i alpha = _mm_cmplt_epi8(_mm_add_epi8(l, _mm_set1_epi8((char)(0x80 - 'a'))),
+                                       _mm_set1_epi8((char)(0x80 + 6)));
+        if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xffff) {
+            break;
+        }
+
+        __m128i nib = _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+                                   _mm_and_si128(alpha, _mm_sub_epi8(l, _mm_set1_epi8('a' - 10))));
+        __m128i b = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(nib, lo_byte), 4), _mm_srli_epi16(nib, 8));
+        _mm_storel_epi64((__m128i *)(dst + i / 2), _mm_packus_epi16(b, b));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i lower32(__m256i v)
+{
+    __m256i t = _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - 'A')));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + 26)), t);
+    return _mm256_add_epi8(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static void lower_buf_avx2(uint8_t *p, size_t len)
+{
+    size_t i;
+
+    if (len < 32) {
+        lower_buf_sse2(p, len);
+        return;
+    }
+    for (i = 0; i + 32 <= len; i += 32) {
+        _mm256_storeu_si256((__m256i *)(p + i), lower32(_mm256_loadu_si256((const __m256i *)(p + i))));
+    }
+    if (i < len) {
+        i = len - 32;
+        _mm256_storeu_si256((__m256i *)(p + i), lower32(_mm256_loadu_si256((const __m256i *)(p + i))));
+    }
+}
+
+__attribute__((target("avx2")))
+static size_t hex_decode_avx2(uint8_t *dst, const uint8_t *src, size_t len)
+{
+    const __m256i lo_byte = _mm256_set1_epi16(0x00ff);
+    size_t i;
+
+    for (i = 0; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i l = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i digit = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + 10)),
+                                          _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - '0'))));
+        __m256i alpha = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + 6)),
+                                          _mm256_add_epi8(l, _mm256_set1_epi8((char)(0x80 - 'a'))));
+        if ((uint32_t)_mm256_movemask_epi8(_mm256_or_si256(digit, alpha)) != 0xffffffffu) {
+            break;
+        }
+
+        __m256i nib = _mm256_or_si256(_mm256_and_si256(digit, _mm256_sub_epi8(v, _mm256_set1_epi8('0'))),
+                                      _mm256_and_si256(alpha, _mm256_sub_epi8(l, _mm256_set1_epi8('a' - 10))));
+        __m256i b = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(nib, lo_byte), 4),
+                                    _mm256_srli_epi16(nib, 8));
+        // packus works per 128-bit lane: the 8 result bytes of each lane end up in qwords 0 and 2
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(b, b), 0x08);
+        _mm_storeu_si128((__m128i *)(dst + i / 2), _mm256_castsi256_si128(packed));
+    }
+    return i + hex_decode_sse2(dst + i / 2, src + i, len - i);
+}
+#endif
+
+static int simd_level = -1;
+static scan_fn_t find_eq = find_eq_scalar;
+static mask64_fn_t mask64_eq = mask64_eq_scalar;
+static lower_fn_t lower_fn = lower_buf_scalar;
+static hex_fn_t hex_fn = hex_decode_none;
+
+static int simd_cpu_level(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return HELPER_SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return HELPER_SIMD_SSE2;
+    }
+#endif
+    return HELPER_SIMD_NONE;
+}
+
+int helper_simd_set_level(int level)
+{
+    int cpu = simd_cpu_level();
+
+    if (level < 0 || level > cpu) {
+        level = cpu;
+    }
+
+    switch (level) {
+#if defined(__x86_64__) || defined(__i386__)
+    case HELPER_SIMD_AVX2:
+        find_eq = find_eq_avx2;
+        mask64_eq = mask64_eq_avx2;
+        lower_fn = lower_buf_avx2;
+        hex_fn = hex_decode_avx2;
+        break;
+    case HELPER_SIMD_SSE2:
+        find_eq = find_eq_sse2;
+        mask64_eq = mask64_eq_sse2;
+        lower_fn = lower_buf_sse2;
+        hex_fn = hex_decode_sse2;
+        break;
+#endif
+    default:
+        level = HELPER_SIMD_NONE;
+        find_eq = find_eq_scalar;
+        mask64_eq = mask64_eq_scalar;
+        lower_fn = lower_buf_scalar;
+        hex_fn = hex_decode_none;
+        break;
+    }
+
+    simd_level = level;
+    return level;
+}
+
+int helper_simd_level(void)
+{
+    if (unlikely(simd_level < 0)) {
+        helper_simd_set_level(-1);
+    }
+    return simd_level;
+}
+
+uint8_t *consume_string(uint8_t *ptr, int len)
+{
+    if (helper_simd_level() == HELPER_SIMD_NONE) {
+        return consume_string_scalar(ptr, len);
+    }
+
+    return (uint8_t *)find_eq(ptr, ptr + len, '\0');
+}
+
+// eol_chars: return number of EOL characters. eg: if line ends with '\r\n', then 2.
+uint8_t *consume_line(uint8_t *ptr, int len, int *eol_chars)
+{
+    if (helper_simd_level() == HELPER_SIMD_NONE) {
+        return consume_line_scalar(ptr, len, eol_chars);
+    }
+
+    uint8_t *l = (uint8_t *)find_eq(ptr, ptr + len, '\n');
+    if (l == NULL) {
+        *eol_chars = 0;
+        return NULL;
+    }
+
+    // Count the run of '\r' right before '\n', same as the scalar walk
+    uint8_t *r = l;
+    while (r > ptr && *(r - 1) == '\r') {
+        r --;
+    }
+
+    *eol_chars = (int)(l - r) + 1;
+    return l + 1;
+}
+
+void consume_tokens(uint8_t *ptr, int len, token_func_t func, void *param)
+{
+    if (helper_simd_level() == HELPER_SIMD_NONE) {
+        consume_tokens_scalar(ptr, len, func, param);
+        return;
+    }
+
+    const uint8_t *p = ptr, *end = ptr + len, *token = NULL;
+    uint64_t prev = 1;      // pretend a space precedes the buffer
+    int idx = 0;
+
+    while (p < end) {
+        int n = end - p >= 64 ? 64 : (int)(end - p);
+        uint64_t m = n == 64 ? mask64_eq(p, ' ') : mask_eq_scalar(p, n, ' ');
+        uint64_t valid = n == 64 ? ~0ULL : (1ULL << n) - 1;
+
+        // Bit i is set where byte i differs from byte i-1 in "is space"; the
+        // edges alternate token start / token end.
+        uint64_t edges = (m ^ ((m << 1) | prev)) & valid;
+        while (edges) {
+            int i = __builtin_ctzll(edges);
+            edges &= edges - 1;
+
+            if (token == NULL) {
+                token = p + i;
+            } else {
+                int ret = func(param, (uint8_t *)token, p + i - token, idx);
+                token = NULL;
+                idx ++;
+                if (ret == CONSUME_TOKEN_SKIP_LINE) {
+                    return;
+                }
+            }
+        }
+
+        prev = (m >> (n - 1)) & 1;
+        p += n;
+    }
+
+    if (token != NULL) {
+        func(param, (uint8_t *)token, end - token, idx);
+    }
+}
+
 char *strip_str (char *s)
 {
     int len;
@@ -369,6 +756,149 @@ char **str_split (const char *s, const char *delim, int *count)
     return tokens;
 }
 
+void delim_set_init (delim_set_t *set, const char *delims)
+{
+    memset(set, 0, sizeof(*set));
+    for (; *delims; delims ++) {
+        uint8_t c = *delims;
+        set->bits[c >> 6] |= 1ULL << (c & 63);
+    }
+}
+
+static inline bool is_trim_space (uint8_t c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Shrink [*start, *end) as strip_str()/strip_str_quote() would; returns false if nothing is left
+static inline bool span_trim (const char *s, size_t *start, size_t *end, int flags)
+{
+    size_t b = *start, e = *end;
+
+    if (flags & STR_SPLIT_TRIM) {
+        while (b < e && is_trim_space(s[b])) {
+            b ++;
+        }
+        while (e > b && is_trim_space(s[e - 1])) {
+            e --;
+        }
+    }
+
+    if ((flags & STR_SPLIT_QUOTE) && e - b >= 2 &&
+        (s[b] == '"' || s[b] == '\'') && s[e - 1] == s[b]) {
+        b ++;
+        e --;
+    }
+
+    *start = b;
+    *end = e;
+    return b < e || !(flags & STR_SPLIT_TRIM);
+}
+
+int str_split_spans (const char *s, size_t len, const delim_set_t *delims, int flags,
+                     str_span_t *spans, int max)
+{
+    size_t i = 0, start, end;
+    int count = 0;
+
+    if (s == NULL) {
+        return 0;
+    }
+
+    while (i < len) {
+        // skip delimiters, then take the run of non-delimiters
+        while (i < len && delim_set_has(delims, s[i])) {
+            i ++;
+        }
+        if (i >= len) {
+            break;
+        }
+        start = i;
+        while (i < len && !delim_set_has(delims, s[i])) {
+            i ++;
+        }
+        end = i;
+
+        if (flags && !span_trim(s, &start, &end, flags)) {
+            continue;
+        }
+        if (count < max) {
+            spans[count].off = start;
+            spans[count].len = end - start;
+        }
+        count ++;
+    }
+
+    return count;
+}
+
+int str_split_arena (span_arena_t *arena, const char *s, size_t len, const delim_set_t *delims, int flags)
+{
+    int room = arena->cap - arena->count;
+    int n = str_split_spans(s, len, delims, flags, arena->spans + arena->count, room);
+
+    if (n > room) {
+        // Rare path: grow geometrically and split again
+        int cap = max(arena->cap * 2, arena->count + n);
+        str_span_t *spans = realloc(arena->spans, cap * sizeof(str_span_t));
+        if (spans == NULL) {
+            return -1;
+        }
+        arena->spans = spans;
+        arena->cap = cap;
+        str_split_spans(s, len, delims, flags, arena->spans + arena->count, n);
+    }
+
+    arena->count += n;
+    return n;
+}
+
+void span_arena_reset (span_arena_t *arena)
+{
+    arena->count = 0;
+}
+
+void span_arena_free (span_arena_t *arena)
+{
+    free(arena->spans);
+    arena->spans = NULL;
+    arena->count = arena->cap = 0;
+}
+
+void lower_buf(uint8_t *ptr, size_t len)
+{
+    helper_simd_level();
+    lower_fn(ptr, len);
+}
+
+ssize_t hex_decode(uint8_t *dst, const uint8_t *src, size_t len, size_t *err_pos)
+{
+    size_t i;
+
+    helper_simd_level();
+    i = hex_fn(dst, src, len & ~(size_t)1);
+
+    for (; i + 1 < len; i += 2) {
+        int8_t h = hex[src[i]], l = hex[src[i + 1]];
+        if (unlikely((h | l) < 0)) {
+            if (err_pos != NULL) {
+                *err_pos = h < 0 ? i : i + 1;
+            }
+            return -1;
+        }
+        dst[i / 2] = (uint8_t)(h << 4 | l);
+    }
+
+    if (unlikely(len & 1)) {
+        // a dangling nibble is reported at its own position if invalid, otherwise at len
+        if (err_pos != NULL) {
+            *err_pos = hex[src[len - 1]] < 0 ? len - 1 : len;
+        }
+        return -1;
+    }
+    return len / 2;
+}
+
 void lower_string(char* s) {
    int c = 0;
 
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/types.h>
 #include <arpa/inet.h>
 
 #ifndef unlikely
@@ -38,6 +39,44 @@ char *strip_str(char *s);
 char *strip_str_quote(char *s);
 char **str_split(const char *s, const char *delim, int *count);
 void free_split(char **tokens, int count);
+
+// Zero-copy splitting: tokens are reported as (offset, length) spans into the
+// input instead of strdup'ed strings. Delimiters are a 256-bit byte set.
+typedef struct delim_set_ {
+    uint64_t bits[4];
+} delim_set_t;
+
+typedef struct str_span_ {
+    size_t off;                 // size_t like the input length, so input over 4 GiB does not wrap
+    size_t len;
+} str_span_t;
+
+// Span buffer reused across calls; it only grows, so a warmed-up arena splits without allocating
+typedef struct span_arena_ {
+    str_span_t *spans;
+    int count;
+    int cap;
+} span_arena_t;
+
+#define STR_SPLIT_TRIM  0x1     // drop leading/trailing " \t\r\n" of each token, like strip_str()
+#define STR_SPLIT_QUOTE 0x2     // drop one pair of matching surrounding quotes, like strip_str_quote()
+
+void delim_set_init(delim_set_t *set, const char *delims);
+
+static inline bool delim_set_has(const delim_set_t *set, uint8_t c)
+{
+    return (set->bits[c >> 6] >> (c & 63)) & 1;
+}
+
+// Same tokens as str_split() (empty tokens are skipped). Writes at most max
+// spans and returns the total number of tokens, so a caller can retry with a
+// bigger buffer when the return value exceeds max.
+int str_split_spans(const char *s, size_t len, const delim_set_t *delims, int flags,
+                    str_span_t *spans, int max);
+// Append the tokens of s to the arena; returns the number appended, -1 on allocation failure
+int str_split_arena(span_arena_t *arena, const char *s, size_t len, const delim_set_t *delims, int flags);
+void span_arena_reset(span_arena_t *arena);
+void span_arena_free(span_arena_t *arena);
 bool parse_int_range(uint32_t *low, uint32_t *high, const char *range, int max);
 
 
@@ -79,6 +118,7 @@ static inline uint32_t ip4_get(uint8_t *ip)
     return *(uint32_t *)ip;
 }
 
+// Byte-serial and weak in the low bits; use flow_hash.h for session tables
 static inline uint32_t sdbm_hash(register const uint8_t *a, register int len)
 {
     register uint32_t hash = 0;
@@ -97,7 +137,22 @@ typedef int (*token_func_t) (void *param, uint8_t *ptr, int len, int token_idx);
 uint8_t *consume_string(uint8_t *ptr, int len);
 uint8_t *consume_line(uint8_t *ptr, int len, int *eol_chars);
 void consume_tokens(uint8_t *ptr, int len, token_func_t func, void *param);
+
+// SIMD implementation used by the scanners above, chosen at runtime from the
+// CPU features. HELPER_SIMD_NONE keeps the original byte-at-a-time loops.
+#define HELPER_SIMD_NONE 0
+#define HELPER_SIMD_SSE2 1
+#define HELPER_SIMD_AVX2 2
+int helper_simd_level(void);
+// Force a level (capped to what the CPU supports), -1 for auto. Returns the level in use.
+int helper_simd_set_level(int level);
 void lower_string(char* s);
+// ASCII case folding of a buffer, NUL bytes included
+void lower_buf(uint8_t *ptr, size_t len);
+// Decode len hex characters (either case) into len / 2 bytes. Returns the number
+// of bytes written, or -1 with *err_pos set to the first invalid character
+// (len for an odd-length input). dst may be partially written on error.
+ssize_t hex_decode(uint8_t *dst, const uint8_t *src, size_t len, size_t *err_pos);
 
 int count_cpu(void);
 
@@ -15,16 +15,33 @@ void timer_callback_2(timer_entry_t *entry)
     printf("Timer 2 expired! Entry at %p\n", (void*)entry);
 }
 
+// Periodic timer callback: fires every 4 time units, stops itself after 3 runs
+static int heartbeats;
+
+int heartbeat_callback(timer_entry_t *entry)
+{
+    heartbeats++;
+    printf("Heartbeat %d! Entry at %p\n", heartbeats, (void*)entry);
+    return heartbeats < 3 ? DTIMER_OK : DTIMER_STOP;
+}
+
 int main(int argc, char *argv[])
 {
     timer_wheel_t wheel;
-    timer_entry_t entry1, entry2, entry3;
+    timer_entry_t entry1, entry2, entry3, entry4, entry5;
     uint32_t current_time = 0;
+    wheel_metrics_t *metrics = wheel_metrics_create("c");
+    wheel_metrics_snapshot_t *snap = malloc(sizeof(*snap));
 
     printf("Initializing timer wheel...\n");
 
     // Initialize the timer wheel
-    timer_wheel_init(&wheel);
+    if (timer_wheel_init(&wheel) != 0) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    // One time unit is one second
+    timer_wheel_set_metrics(&wheel, metrics, 1000000000ULL);
 
     // Start the timer wheel at time 0
     timer_wheel_start(&wheel, current_time);
@@ -34,6 +51,8 @@ int main(int argc, char *argv[])
     timer_wheel_entry_init(&entry1);
     timer_wheel_entry_init(&entry2);
     timer_wheel_entry_init(&entry3);
+    timer_wheel_entry_init(&entry4);
+    timer_wheel_entry_init(&entry5);
 
     // Start timers with different timeouts
     printf("\nStarting timers:\n");
@@ -46,6 +65,12 @@ int main(int argc, char *argv[])
     printf("  Timer 3: timeout = 15 seconds\n");
     timer_wheel_entry_start(&wheel, &entry3, timer_callback, 15, current_time);
 
+    printf("  Timer 4: periodic, period = 4 seconds, stops after 3 runs\n");
+    timer_wheel_entry_start_periodic(&wheel, &entry4, heartbeat_callback, 4, current_time);
+
+    printf("  Timer 5: timeout = 6 seconds, touched at time 4 so it expires at 10\n");
+    timer_wheel_entry_start(&wheel, &entry5, timer_callback, 6, current_time);
+
     printf("\nActive timers: %u\n", timer_wheel_count(&wheel));
 
     // Simulate time progression
@@ -54,6 +79,11 @@ int main(int argc, char *argv[])
         current_time++;
         printf("Time: %u - ", current_time);
 
+        // Lazy refresh: only the time is recorded, the wheel moves the timer at 6
+        if (current_time == 4) {
+            timer_wheel_entry_touch(&entry5, current_time);
+        }
+
         uint32_t expired = timer_wheel_roll(&wheel, current_time);
         if (expired > 0) {
             printf("%u timer(s) expired\n", expired);
@@ -70,5 +100,14 @@ int main(int argc, char *argv[])
     printf("\nTimer wheel demo completed.\n");
     printf("Final active timers: %u\n", timer_wheel_count(&wheel));
 
+    if (snap != NULL) {
+        wheel_metrics_snapshot(metrics, snap);
+        printf("\n");
+        wheel_metrics_dump_text(stdout, snap);
+        free(snap);
+    }
+    wheel_metrics_destroy(metrics);
+    timer_wheel_destroy(&wheel);
+
     return 0;
 }
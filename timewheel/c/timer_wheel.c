@@ -1,26 +1,198 @@
 #include <sys/types.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 
 #include "timer_wheel.h"
+#include "wheel_clock.h"
 #include "helper.h"
 
+static inline void timer_entry_link(timer_wheel_t *w, timer_entry_t *n, uint32_t now);
+static inline void timer_entry_unlink(timer_wheel_t *w, timer_entry_t *n);
+static uint32_t timer_wheel_roll_pool(timer_wheel_t *w, uint32_t now);
+static uint32_t timer_wheel_take_back(timer_wheel_t *w);
+
+// Timers run by one pool task, and per lateness sample in timer_wheel_roll()
+#define TIMER_WHEEL_BATCH 256
+
+/*
+ * Move an armed timer that is being processed to the slot of @expire_at. The
+ * timer stays armed and counted, so this is a plain O(1) relink with no
+ * debug-history bookkeeping. Callers keep @expire_at within one revolution
+ * minus one of the slot being processed, so the target is never that slot.
+ */
+static inline void timer_entry_relink(timer_wheel_t *w, timer_entry_t *n, uint32_t expire_at)
+{
+    n->expire_slot = expire_at & w->mask;
+    cds_list_del(&n->link);
+    cds_list_add_tail(&n->link, &w->slots[n->expire_slot]);
+}
+
+/*
+ * Time units from slot time @s until a lazily touched one-shot timer is really
+ * due, 0 when it is due now. While the wheel is rolled regularly last_seen and
+ * @s are less than two revolutions (at most 2 * TIMER_WHEEL_MAX_SLOTS) apart,
+ * so the 16-bit difference is exact; it is capped so that the target slot is
+ * never the one being processed. A cap below the real distance only means the
+ * timer is looked at once more in between.
+ */
+static inline uint32_t timer_entry_lazy_ahead(const timer_wheel_t *w, const timer_entry_t *n, uint32_t s)
+{
+    int16_t ahead = (int16_t)(uint16_t)(n->last_seen + n->timeout - (uint16_t)s);
+
+    if (likely(ahead <= 0)) {
+        return 0;
+    }
+    return (uint32_t)ahead <= w->mask ? (uint32_t)ahead : w->mask;
+}
+
+/*
+ * Expiry time of a timer due @delay time units after @base, pushed back by up
+ * to the timer's slack: as in the kernel's apply_slack(), the deadline is
+ * rounded down to the coarsest power-of-two boundary inside [deadline,
+ * deadline + slack], so timers with nearby deadlines and similar slack meet
+ * in the same slot. The window is cut so that the result stays within one
+ * revolution minus one of @base; callers pass @delay below the slot count.
+ */
+static inline uint32_t timer_entry_deadline(const timer_wheel_t *w, const timer_entry_t *n,
+                                            uint32_t base, uint32_t delay)
+{
+    uint32_t expire_at = base + delay, slack = n->slack, mask;
+
+    if (likely(slack == 0) || n->period) {
+        return expire_at;
+    }
+    if (slack > w->mask - delay) {
+        slack = w->mask - delay;
+    }
+    mask = expire_at ^ (expire_at + slack);
+    if (mask == 0) {
+        return expire_at;
+    }
+    mask = (1u << (31 - __builtin_clz(mask))) - 1;
+    return (expire_at + slack) & ~mask;
+}
+
 /**
  * timer_wheel_init - Initialize a timer wheel structure
  * @w: Pointer to the timer wheel to initialize
  *
- * Initializes all slots in the timer wheel by setting up empty circular
- * doubly-linked lists (using URCU list API). Resets the current time slot
- * and active timer count to zero.
+ * Same as timer_wheel_init_attr() with MAX_TIMER_SLOTS slots (4096 once
+ * rounded up) allocated with calloc.
+ *
+ * Return: 0, or -1 when out of memory
  */
-void timer_wheel_init(timer_wheel_t *w)
+int timer_wheel_init(timer_wheel_t *w)
 {
-    int i;
+    return timer_wheel_init_attr(w, NULL);
+}
 
-    for (i = 0; i < MAX_TIMER_SLOTS; i ++) {
+/**
+ * timer_wheel_init_attr - Initialize a timer wheel with a chosen size
+ * @w: Pointer to the timer wheel to initialize
+ * @attr: Slot count and memory placement, NULL for the defaults
+ *
+ * The slot count is rounded up to a power of two, so that a slot is found
+ * with a mask instead of a division, and capped at TIMER_WHEEL_MAX_SLOTS.
+ * Timeouts and periods must be shorter than the slot count. The slot array
+ * is allocated with wheel_mem_alloc(), optionally from huge pages and on a
+ * given NUMA node; every slot starts as an empty circular doubly-linked
+ * list (using URCU list API). Resets the current time slot and active timer
+ * count to zero. Free the slot array with timer_wheel_destroy().
+ *
+ * Return: 0, or -1 when out of memory
+ */
+int timer_wheel_init_attr(timer_wheel_t *w, const timer_wheel_attr_t *attr)
+{
+    uint32_t i, slots = attr && attr->slots ? attr->slots : MAX_TIMER_SLOTS;
+
+    if (slots > TIMER_WHEEL_MAX_SLOTS) {
+        slots = TIMER_WHEEL_MAX_SLOTS;
+    } else if (slots < 2) {
+        slots = 2;
+    }
+    slots = 1u << (32 - __builtin_clz(slots - 1));
+
+    w->slots = wheel_mem_alloc(slots * sizeof(*w->slots), attr ? attr->mem_flags : 0,
+                               attr ? attr->numa_node : -1, &w->mem_kind);
+    if (w->slots == NULL) {
+        return -1;
+    }
+    w->mask = slots - 1;
+    for (i = 0; i < slots; i ++) {
         CDS_INIT_LIST_HEAD(&w->slots[i]);
     }
     w->current = w->count = 0;
+    w->metrics = NULL;
+    w->tick_ns = 0;
+    w->pool = NULL;
+    w->pool_wait = false;
+    w->retired = 0;
+    w->returned = NULL;
+    return 0;
+}
+
+/**
+ * timer_wheel_destroy - Free the slot array of a timer wheel
+ * @w: Pointer to the timer wheel
+ *
+ * Timers still armed are dropped without their callbacks being run; their
+ * entries must not be used with @w again. A pool attached to the wheel must
+ * have finished with its timers.
+ */
+void timer_wheel_destroy(timer_wheel_t *w)
+{
+    wheel_mem_free(w->slots, (size_t)(w->mask + 1) * sizeof(*w->slots), w->mem_kind);
+    w->slots = NULL;
+    w->count = 0;
+}
+
+/**
+ * timer_wheel_set_metrics - Attach a metrics object to the timer wheel
+ * @w: Pointer to the timer wheel
+ * @m: Metrics to update, or NULL to turn metrics off
+ * @tick_ns: Length of one time unit of 'now' in nanoseconds, used to convert
+ *           expiry lateness; 0 reports lateness in time units
+ *
+ * The metrics are owned by the caller and may be shared between wheels, e.g.
+ * one wheel per thread all feeding the same per-thread-sharded metrics.
+ */
+void timer_wheel_set_metrics(timer_wheel_t *w, wheel_metrics_t *m, uint64_t tick_ns)
+{
+    w->metrics = m;
+    w->tick_ns = tick_ns ? tick_ns : 1;
+}
+
+/**
+ * timer_wheel_set_pool - Run expired callbacks on a worker pool
+ * @w: Pointer to the timer wheel
+ * @pool: Pool to hand expired timers to, or NULL to run callbacks inside
+ *        timer_wheel_roll() again
+ * @wait: Whether timer_wheel_roll() waits for the pool before returning
+ *
+ * With a pool, timer_wheel_roll() detaches each due slot's list in O(1) and
+ * submits it as one task; the worker that picks it up splits off everything
+ * after the first TIMER_WHEEL_BATCH timers as a new task that idle workers
+ * can steal, then runs its batch. A burst of expirations in one slot is thus
+ * spread over all workers while the roll itself stays short.
+ *
+ * Callbacks then run on pool threads, concurrently with each other and with
+ * the thread rolling the wheel, and must not call any timer_wheel function on
+ * @w; periodic callbacks stop by returning DTIMER_STOP. Periodic and touched
+ * timers are handed back to the wheel and relinked by the next roll. Until
+ * its callback has run, a detached timer must not be removed or refreshed;
+ * with @wait set that is the case as soon as timer_wheel_roll() returns.
+ *
+ * Switching pools waits for the previous pool to finish.
+ */
+void timer_wheel_set_pool(timer_wheel_t *w, wheel_pool_t *pool, bool wait)
+{
+    if (w->pool != NULL) {
+        wheel_pool_wait(w->pool);
+        timer_wheel_take_back(w);
+    }
+    w->pool = pool;
+    w->pool_wait = wait;
 }
 
 /**
@@ -50,8 +222,29 @@ void timer_wheel_start(timer_wheel_t *w, uint32_t now)
  * always removing from the head of each slot's list until it's empty, rather
  * than using a safe iterator.
  *
+ * Periodic timers are not removed: before their callback runs they are moved
+ * straight to the slot one period after the slot being processed, so the
+ * schedule does not drift when the wheel is rolled late, and a slot that fell
+ * behind fires once per missed period. The callback may cancel or refresh the
+ * timer itself; returning DTIMER_STOP removes it.
+ *
+ * One-shot timers touched with timer_wheel_entry_touch() since they were
+ * linked are not expired either: they are moved to (last_seen + timeout) and
+ * looked at again then.
+ *
  * To prevent processing too many slots at once, it limits advancement to
- * MAX_TIMER_SLOTS even if 'now' is much larger than the current time.
+ * one revolution even if 'now' is much larger than the current time.
+ *
+ * With a pool attached (timer_wheel_set_pool()) the due slots are handed to
+ * the pool's workers instead, see timer_wheel_roll_pool().
+ *
+ * With metrics attached, the call counts as one tick: its duration, the
+ * number of timers found in each slot, and the lateness of each expired timer
+ * are recorded. Lateness is (now - slot time) in tick_ns units plus the time
+ * since the roll started, sampled once per TIMER_WHEEL_BATCH timers, so a
+ * burst of expirations in one slot shows up as growing lateness. A periodic
+ * timer that fires counts as an expire plus an insert for the re-arm; moving
+ * a touched timer counts as a refresh (touches themselves are not counted).
  *
  * Return: The number of timers that expired and were processed
  */
@@ -60,35 +253,115 @@ uint32_t timer_wheel_roll(timer_wheel_t *w, uint32_t now)
     if (now < w->current) {
         return 0;
     }
+    if (w->pool != NULL) {
+        return timer_wheel_roll_pool(w, now);
+    }
 
-    uint32_t cnt = 0;
-    uint32_t s, m = min(now, w->current + MAX_TIMER_SLOTS);
+    wheel_metrics_t *metrics = w->metrics;
+    uint64_t start = metrics ? wheel_clock_ns() : 0;
+    uint32_t cnt = 0, rearmed = 0, lazy = 0;
+    uint32_t s, m = min(now, w->current + w->mask + 1);
     for (s = w->current; s < m; s ++) {
-        struct cds_list_head *head = &w->slots[s % MAX_TIMER_SLOTS];
+        struct cds_list_head *head = &w->slots[s & w->mask];
+        uint32_t slot_cnt = 0, slot_lazy = 0, batch = 0;
+        uint64_t late = 0;
 
         // Because link entries can be modified in callback, so we cannot use
         // cds_list_for_each_entry_safe() to walk through the list; instead, we remove
         // the head every time and start over again until the link is empty.
         while (!cds_list_empty(head)) {
             timer_entry_t *itr = cds_list_first_entry(head, timer_entry_t, link);
-            timer_wheel_expire_fct fn = itr->callback;
-            timer_wheel_entry_remove(w, itr);
-            fn(itr);
-            cnt ++;
+            uint32_t ahead;
+            if (unlikely(metrics != NULL) && batch == 0) {
+                late = (uint64_t)(now - s) * w->tick_ns + (wheel_clock_ns() - start);
+            }
+            if (itr->period) {
+                timer_wheel_periodic_fct pfn = itr->periodic;
+                itr->last_seen = (uint16_t)s;
+                timer_entry_relink(w, itr, s + itr->period);
+                rearmed ++;
+                // Only remove it if the callback did not already cancel or restart it
+                if (pfn(itr) == DTIMER_STOP && itr->periodic == pfn && itr->period) {
+                    timer_wheel_entry_remove(w, itr);
+                }
+            } else if ((ahead = timer_entry_lazy_ahead(w, itr, s)) != 0) {
+                timer_entry_relink(w, itr, timer_entry_deadline(w, itr, s, ahead));
+                slot_lazy ++;
+                continue;
+            } else {
+                timer_wheel_expire_fct fn = itr->callback;
+                timer_entry_unlink(w, itr);
+                fn(itr);
+            }
+            slot_cnt ++;
+            if (++ batch == TIMER_WHEEL_BATCH) {
+                wheel_metrics_record(metrics, WHEEL_HIST_LATENESS, late, batch);
+                batch = 0;
+            }
+        }
+
+        if (unlikely(metrics != NULL) && (slot_cnt || slot_lazy)) {
+            wheel_metrics_slot(metrics, slot_cnt + slot_lazy);
+            wheel_metrics_record(metrics, WHEEL_HIST_LATENESS, late, batch);
         }
+        cnt += slot_cnt;
+        lazy += slot_lazy;
     }
 
     w->current = now;
 
+    if (unlikely(metrics != NULL)) {
+        wheel_metrics_count(metrics, WHEEL_METRIC_EXPIRE, cnt);
+        wheel_metrics_count(metrics, WHEEL_METRIC_INSERT, rearmed);
+        wheel_metrics_count(metrics, WHEEL_METRIC_REFRESH, lazy);
+        wheel_metrics_count(metrics, WHEEL_METRIC_TICK, 1);
+        wheel_metrics_record(metrics, WHEEL_HIST_TICK, wheel_clock_ns() - start, 1);
+    }
+
     return cnt;
 }
 
+/**
+ * timer_wheel_next_roll - Find the next time the wheel has work
+ * @w: Pointer to the timer wheel
+ *
+ * Scans forward from the current slot for the first non-empty one, so that
+ * a tickless caller can sleep until then instead of rolling every time unit;
+ * together with timer slack (timer_wheel_entry_set_slack()) this cuts the
+ * number of wakeups. The slot found may only hold touched timers that are
+ * moved on rather than expired. With a pool attached, timers handed back by
+ * the workers make the next roll due right away.
+ *
+ * A roll that covers several slots relinks touched and restarted timers
+ * relative to its own 'now', so timeouts plus slack must stay below the
+ * slot count minus the longest sleep for them to land in the right
+ * revolution.
+ *
+ * Return: The smallest 'now' for which timer_wheel_roll() processes a timer;
+ * current + slot count for an empty wheel, as the wheel must still be rolled
+ * once per revolution for touched timers
+ */
+uint32_t timer_wheel_next_roll(timer_wheel_t *w)
+{
+    uint32_t i;
+
+    if (__atomic_load_n(&w->returned, __ATOMIC_RELAXED) != NULL) {
+        return w->current + 1;
+    }
+    for (i = 0; i <= w->mask; i ++) {
+        if (!cds_list_empty(&w->slots[(w->current + i) & w->mask])) {
+            return w->current + i + 1;
+        }
+    }
+    return w->current + w->mask + 1;
+}
+
 /**
  * timer_wheel_entry_init - Initialize a timer entry
  * @n: Pointer to the timer entry to initialize
  *
  * Initializes a timer entry to a clean state with an empty list link,
- * invalid expire slot marker, and NULL callback. This must be called
+ * invalid expire slot marker, NULL callback and no slack. This must be called
  * before using a timer entry.
  */
 void timer_wheel_entry_init(timer_entry_t *n)
@@ -96,6 +369,8 @@ void timer_wheel_entry_init(timer_entry_t *n)
     CDS_INIT_LIST_HEAD(&n->link);
     n->expire_slot = (uint16_t)(-1);
     n->callback = NULL;
+    n->period = 0;
+    n->slack = 0;
 }
 
 #ifdef DEBUG_TIMER_WHEEL
@@ -104,22 +379,10 @@ void timer_wheel_entry_init(timer_entry_t *n)
 #define REMOVE 1
 #endif
 
-/**
- * timer_wheel_entry_insert - Insert a timer entry into the timer wheel
- * @w: Pointer to the timer wheel
- * @n: Pointer to the timer entry to insert
- * @now: The current time value
- *
- * Inserts a timer entry into the appropriate slot of the timer wheel based
- * on its timeout value. The timer will expire at time (now + n->timeout).
- *
- * The expire slot is calculated using modulo arithmetic to wrap around the
- * circular timer wheel. The entry is added to the tail of the slot's list.
- *
- * When DEBUG_TIMER_WHEEL is defined, tracks the insertion in a debug history
- * buffer and validates that insertions and removals are properly paired.
- */
-void timer_wheel_entry_insert(timer_wheel_t *w, timer_entry_t *n, uint32_t now)
+// Always inlined so that __builtin_return_address(0) in the debug history
+// still records the caller of the public function
+static inline __attribute__((always_inline))
+void timer_entry_link(timer_wheel_t *w, timer_entry_t *n, uint32_t now)
 {
 #ifdef DEBUG_TIMER_WHEEL
     void *c1 = __builtin_return_address(0);
@@ -141,12 +404,77 @@ void timer_wheel_entry_insert(timer_wheel_t *w, timer_entry_t *n, uint32_t now)
     }
 #endif
 
-    uint32_t expire_at = now + n->timeout;
-    n->expire_slot = expire_at % MAX_TIMER_SLOTS;
+    uint32_t expire_at = timer_entry_deadline(w, n, now, n->timeout);
+    n->expire_slot = expire_at & w->mask;
+    n->last_seen = (uint16_t)now;
     cds_list_add_tail(&n->link, &w->slots[n->expire_slot]);
     w->count ++;
 }
 
+// Record the removal in the debug history and mark the entry inactive. Also
+// used by pool workers, which expire timers already detached from the wheel
+static inline __attribute__((always_inline))
+void timer_entry_retire(timer_entry_t *n)
+{
+#ifdef DEBUG_TIMER_WHEEL
+    void *c1 = __builtin_return_address(0);
+//    void *c2 = __builtin_return_address(1);
+//    void *c3 = __builtin_return_address(2);
+//    void *c4 = __builtin_return_address(3);
+    if (n->debugs < 16) {
+        n->history[n->debugs].caller[0] = c1;
+//        n->history[n->debugs].caller2 = c2;
+//        n->history[n->debugs].caller3 = c3;
+//        n->history[n->debugs].caller4 = c4;
+//        backtrace(n->history[n->debugs].caller, 4);
+        n->history[n->debugs].callback = n->callback;
+        n->history[n->debugs].act = REMOVE;
+        n->debugs ++;
+        if (n->debugs < 2) {
+            assert(0);
+        }
+        if (n->history[n->debugs - 2].act == REMOVE) {
+            assert(0);
+        }
+        if (n->history[n->debugs - 2].act == INSERT) {
+            n->debugs -= 2;
+        }
+    }
+#endif
+
+    n->callback = NULL;
+}
+
+static inline __attribute__((always_inline))
+void timer_entry_unlink(timer_wheel_t *w, timer_entry_t *n)
+{
+    timer_entry_retire(n);
+    cds_list_del(&n->link);
+    w->count --;
+    //n->expire_slot = (uint16_t)(-1);
+}
+
+/**
+ * timer_wheel_entry_insert - Insert a timer entry into the timer wheel
+ * @w: Pointer to the timer wheel
+ * @n: Pointer to the timer entry to insert
+ * @now: The current time value
+ *
+ * Inserts a timer entry into the appropriate slot of the timer wheel based
+ * on its timeout value. The timer will expire at time (now + n->timeout).
+ *
+ * The expire slot is calculated using modulo arithmetic to wrap around the
+ * circular timer wheel. The entry is added to the tail of the slot's list.
+ *
+ * When DEBUG_TIMER_WHEEL is defined, tracks the insertion in a debug history
+ * buffer and validates that insertions and removals are properly paired.
+ */
+void timer_wheel_entry_insert(timer_wheel_t *w, timer_entry_t *n, uint32_t now)
+{
+    timer_entry_link(w, n, now);
+    wheel_metrics_count(w->metrics, WHEEL_METRIC_INSERT, 1);
+}
+
 /**
  * timer_wheel_entry_refresh - Refresh a timer entry with a new timeout
  * @w: Pointer to the timer wheel
@@ -158,14 +486,17 @@ void timer_wheel_entry_insert(timer_wheel_t *w, timer_entry_t *n, uint32_t now)
  * The callback function is preserved.
  *
  * This is useful for implementing keepalive or activity-based timers that
- * need to be reset when certain events occur.
+ * need to be reset when certain events occur. For timers refreshed far more
+ * often than they expire, timer_wheel_entry_touch() is cheaper: it defers the
+ * relink to the time the old slot comes due.
  */
 void timer_wheel_entry_refresh(timer_wheel_t *w, timer_entry_t *n, uint32_t now)
 {
     timer_wheel_expire_fct fn = n->callback;
-    timer_wheel_entry_remove(w, n);
+    timer_entry_unlink(w, n);
     n->callback = fn;
-    timer_wheel_entry_insert(w, n, now);
+    timer_entry_link(w, n, now);
+    wheel_metrics_count(w->metrics, WHEEL_METRIC_REFRESH, 1);
 }
 
 /**
@@ -183,36 +514,8 @@ void timer_wheel_entry_refresh(timer_wheel_t *w, timer_entry_t *n, uint32_t now)
  */
 void timer_wheel_entry_remove(timer_wheel_t *w, timer_entry_t *n)
 {
-#ifdef DEBUG_TIMER_WHEEL
-    void *c1 = __builtin_return_address(0);
-//    void *c2 = __builtin_return_address(1);
-//    void *c3 = __builtin_return_address(2);
-//    void *c4 = __builtin_return_address(3);
-    if (n->debugs < 16) {
-        n->history[n->debugs].caller[0] = c1;
-//        n->history[n->debugs].caller2 = c2;
-//        n->history[n->debugs].caller3 = c3;
-//        n->history[n->debugs].caller4 = c4;
-//        backtrace(n->history[n->debugs].caller, 4);
-        n->history[n->debugs].callback = n->callback;
-        n->history[n->debugs].act = REMOVE;
-        n->debugs ++;
-        if (n->debugs < 2) {
-            assert(0);
-        }
-        if (n->history[n->debugs - 2].act == REMOVE) {
-            assert(0);
-        }
-        if (n->history[n->debugs - 2].act == INSERT) {
-            n->debugs -= 2;
-        }
-    }
-#endif
-
-    cds_list_del(&n->link);
-    w->count --;
-    //n->expire_slot = (uint16_t)(-1);
-    n->callback = NULL;
+    timer_entry_unlink(w, n);
+    wheel_metrics_count(w->metrics, WHEEL_METRIC_CANCEL, 1);
 }
 
 /**
@@ -224,48 +527,240 @@ void timer_wheel_entry_remove(timer_wheel_t *w, timer_entry_t *n)
  * @now: The current time value
  *
  * Initializes and starts a timer entry with the given callback and timeout.
- * If the timeout is greater than or equal to MAX_TIMER_SLOTS, it's clamped
- * to 0 to prevent out-of-bounds access.
+ * If the timeout is greater than or equal to the wheel's slot count, it's
+ * clamped to 0 to prevent out-of-bounds access.
  *
- * The timer will expire at time (now + timeout), at which point the callback
- * function will be invoked with the timer entry as its argument.
+ * The timer will expire at time (now + timeout), or up to the entry's slack
+ * later, at which point the callback function will be invoked with the timer
+ * entry as its argument.
  */
 void timer_wheel_entry_start(timer_wheel_t *w, timer_entry_t *n,
                              timer_wheel_expire_fct cb, uint16_t timeout, uint32_t now)
 {
-    if (unlikely(timeout >= MAX_TIMER_SLOTS)) {
+    if (unlikely(timeout > w->mask)) {
         timeout = 0;
     }
 
     n->callback = cb;
     n->timeout = timeout;
+    n->period = 0;
 
     timer_wheel_entry_insert(w, n, now);
 }
 
 /**
- * get_expire_at - Calculate the absolute expiration time of a timer entry
- * @n: Pointer to the timer entry
+ * timer_wheel_entry_start_periodic - Start a periodic timer entry
+ * @w: Pointer to the timer wheel
+ * @n: Pointer to the timer entry to start
+ * @cb: Callback run every period; returns DTIMER_OK to keep the timer or
+ *      DTIMER_STOP to remove it
+ * @period: Period in time units, clamped to 1..slot count - 1
  * @now: The current time value
  *
- * Calculates when the timer entry will expire in absolute time units.
- * This handles the circular nature of the timer wheel by determining
- * whether the expire slot is ahead of or behind the current slot position.
+ * The first expiry is at (now + period); later ones are computed from the
+ * previous scheduled expiry rather than from the time the wheel was rolled,
+ * so a periodic timer does not drift. See timer_wheel_roll().
+ */
+void timer_wheel_entry_start_periodic(timer_wheel_t *w, timer_entry_t *n,
+                                      timer_wheel_periodic_fct cb, uint16_t period, uint32_t now)
+{
+    if (unlikely(period == 0)) {
+        period = 1;
+    } else if (unlikely(period > w->mask)) {
+        period = w->mask;
+    }
+
+    n->periodic = cb;
+    n->timeout = period;
+    n->period = period;
+
+    timer_wheel_entry_insert(w, n, now);
+}
+
+typedef struct timer_batch_ {
+    wheel_task_t task;
+    timer_wheel_t *w;
+    wheel_pool_t *pool;
+    struct cds_list_head *first;    // NULL-terminated chain through link.next
+    uint32_t slot_time;
+    uint64_t late_ns;               // lateness of the slot when the roll started
+    uint64_t start_ns;              // when the roll started, 0 without metrics
+} timer_batch_t;
+
+/*
+ * Pool task: expire a chain of timers detached from one slot. Periodic and
+ * touched timers cannot be relinked here, as the wheel belongs to the rolling
+ * thread; they are pushed onto w->returned in one go and relinked by
+ * timer_wheel_take_back(). Expired timers are only counted in w->retired.
+ */
+static void timer_batch_run(wheel_task_t *t)
+{
+    timer_batch_t *b = STRUCT_OF(t, timer_batch_t, task);
+    timer_wheel_t *w = b->w;
+    wheel_metrics_t *metrics = w->metrics;
+    struct cds_list_head *pos = b->first, *next, *back = NULL, *back_tail = NULL;
+    uint32_t i, expired = 0, rearmed = 0, lazy = 0, stopped = 0, retired = 0;
+    uint64_t late = 0;
+
+    // Leave everything after the first TIMER_WHEEL_BATCH timers to idle workers;
+    // without memory for a new task, this worker runs the whole chain
+    for (i = 1; i < TIMER_WHEEL_BATCH && pos->next != NULL; i ++) {
+        pos = pos->next;
+    }
+    if (pos->next != NULL) {
+        timer_batch_t *rest = malloc(sizeof(*rest));
+        if (rest != NULL) {
+            *rest = *b;
+            rest->first = pos->next;
+            pos->next = NULL;
+            wheel_pool_submit(b->pool, &rest->task);
+        }
+    }
+
+    if (unlikely(metrics != NULL)) {
+        late = b->late_ns + (wheel_clock_ns() - b->start_ns);
+    }
+
+    for (pos = b->first; pos != NULL; pos = next) {
+        timer_entry_t *itr = cds_list_entry(pos, timer_entry_t, link);
+        next = pos->next;
+        if (itr->period) {
+            itr->last_seen = (uint16_t)b->slot_time;
+            expired ++;
+            rearmed ++;
+            if (itr->periodic(itr) == DTIMER_STOP) {
+                timer_entry_retire(itr);
+                stopped ++;
+                retired ++;
+                continue;
+            }
+        } else if (timer_entry_lazy_ahead(w, itr, b->slot_time) != 0) {
+            lazy ++;
+        } else {
+            timer_wheel_expire_fct fn = itr->callback;
+            timer_entry_retire(itr);
+            expired ++;
+            retired ++;
+            fn(itr);
+            continue;
+        }
+        // Handed back: relinked at last_seen + timeout by the rolling thread
+        pos->next = back;
+        back = pos;
+        if (back_tail == NULL) {
+            back_tail = pos;
+        }
+    }
+
+    if (back != NULL) {
+        struct cds_list_head *old = __atomic_load_n(&w->returned, __ATOMIC_RELAXED);
+        do {
+            back_tail->next = old;
+        } while (!__atomic_compare_exchange_n(&w->returned, &old, back, true,
+                                              __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+    if (retired) {
+        __atomic_add_fetch(&w->retired, retired, __ATOMIC_RELEASE);
+    }
+
+    if (unlikely(metrics != NULL)) {
+        wheel_metrics_count(metrics, WHEEL_METRIC_EXPIRE, expired);
+        wheel_metrics_count(metrics, WHEEL_METRIC_INSERT, rearmed);
+        wheel_metrics_count(metrics, WHEEL_METRIC_CANCEL, stopped);
+        wheel_metrics_count(metrics, WHEEL_METRIC_REFRESH, lazy);
+        wheel_metrics_record(metrics, WHEEL_HIST_LATENESS, late, expired);
+    }
+    free(b);
+}
+
+/*
+ * Fold the workers' results back into the wheel: take expired timers off the
+ * count and relink handed-back timers at (last_seen + timeout), or in the
+ * current slot when that time has already passed.
+ *
+ * Return: The number of timers expired by workers since the last call
+ */
+static uint32_t timer_wheel_take_back(timer_wheel_t *w)
+{
+    struct cds_list_head *pos = __atomic_exchange_n(&w->returned, NULL, __ATOMIC_ACQUIRE), *next;
+    uint32_t retired = __atomic_exchange_n(&w->retired, 0, __ATOMIC_ACQUIRE);
+
+    w->count -= retired;
+    for (; pos != NULL; pos = next) {
+        timer_entry_t *n = cds_list_entry(pos, timer_entry_t, link);
+        int16_t ahead = (int16_t)(uint16_t)(n->last_seen + n->timeout - (uint16_t)w->current);
+
+        next = pos->next;
+        if (ahead < 0) {
+            ahead = 0;
+        } else if ((uint32_t)ahead > w->mask) {
+            ahead = w->mask;
+        }
+        n->expire_slot = timer_entry_deadline(w, n, w->current, ahead) & w->mask;
+        cds_list_add_tail(&n->link, &w->slots[n->expire_slot]);
+    }
+    return retired;
+}
+
+/*
+ * timer_wheel_roll() with a pool: relink what the workers handed back since
+ * the last roll, then detach every due slot in O(1) (the slot's circular list
+ * becomes a NULL-terminated chain) and submit it. Lateness is recorded by the
+ * workers per batch and includes the time the batch waited in the pool; slot
+ * occupancy is not recorded, as counting would mean walking the lists.
  *
- * If the timer is inactive (callback is NULL) or the expire slot is at or
- * after the current slot within the same wheel rotation, the expiration is
- * in the current rotation. Otherwise, it's in the next rotation.
+ * When a task cannot be allocated the roll stops at that slot and the next
+ * call resumes from there.
  *
- * Return: The absolute time value when the timer will expire
+ * Return: With wait set, the number of timers that expired (periodic timers
+ * that keep running are not counted); otherwise 0, as the timers have only
+ * been handed to the pool
  */
-static uint32_t get_expire_at(const timer_entry_t *n, uint32_t now)
+static uint32_t timer_wheel_roll_pool(timer_wheel_t *w, uint32_t now)
 {
-    uint16_t slot = now % MAX_TIMER_SLOTS;
-    if (n->callback == NULL || n->expire_slot >= slot) {
-        return now + n->expire_slot - slot;
-    } else {
-        return now + n->expire_slot + MAX_TIMER_SLOTS - slot;
+    wheel_metrics_t *metrics = w->metrics;
+    uint64_t start = metrics ? wheel_clock_ns() : 0;
+    uint32_t cnt = 0;
+    uint32_t s, m = min(now, w->current + w->mask + 1);
+
+    timer_wheel_take_back(w);
+
+    for (s = w->current; s < m; s ++) {
+        struct cds_list_head *head = &w->slots[s & w->mask];
+        timer_batch_t *b;
+
+        if (cds_list_empty(head)) {
+            continue;
+        }
+        b = malloc(sizeof(*b));
+        if (unlikely(b == NULL)) {
+            break;
+        }
+        b->task.fn = timer_batch_run;
+        b->w = w;
+        b->pool = w->pool;
+        b->slot_time = s;
+        b->late_ns = (uint64_t)(now - s) * w->tick_ns;
+        b->start_ns = start;
+        b->first = head->next;
+        head->prev->next = NULL;
+        CDS_INIT_LIST_HEAD(head);
+        wheel_pool_submit(w->pool, &b->task);
     }
+
+    w->current = s < m ? s : now;
+
+    if (w->pool_wait) {
+        wheel_pool_wait(w->pool);
+        cnt = timer_wheel_take_back(w);
+    }
+
+    if (unlikely(metrics != NULL)) {
+        wheel_metrics_count(metrics, WHEEL_METRIC_TICK, 1);
+        wheel_metrics_record(metrics, WHEEL_HIST_TICK, wheel_clock_ns() - start, 1);
+    }
+
+    return cnt;
 }
 
 /**
@@ -273,15 +768,14 @@ static uint32_t get_expire_at(const timer_entry_t *n, uint32_t now)
  * @n: Pointer to the timer entry
  * @now: The current time value
  *
- * Calculates how much time has elapsed since the timer was started.
- * This is computed as the difference between the current time and when
- * the timer would have been inserted (expiration time minus timeout).
+ * Calculates how much time has elapsed since the timer was last started,
+ * refreshed or touched; for periodic timers, since the last scheduled expiry.
  *
- * Return: The number of time units the timer has been active
+ * Return: The number of time units the timer has been idle
  */
 uint16_t timer_wheel_entry_get_idle(const timer_entry_t *n, uint32_t now)
 {
-    return (uint16_t)(now - (get_expire_at(n, now) - n->timeout));
+    return (uint16_t)(now - n->last_seen);
 }
 
 /**
@@ -289,14 +783,14 @@ uint16_t timer_wheel_entry_get_idle(const timer_entry_t *n, uint32_t now)
  * @n: Pointer to the timer entry
  * @now: The current time value
  *
- * Calculates how much time remains until the timer expires. This is the
- * difference between the timer's absolute expiration time and the current
- * time.
+ * Calculates how much time remains until the timer expires, that is until
+ * (last activity + timeout). For a touched timer this is later than the slot
+ * it is currently linked in.
  *
  * Return: The number of time units remaining until expiration
  */
 uint16_t timer_wheel_entry_get_life(const timer_entry_t *n, uint32_t now)
 {
-    return (uint16_t)(get_expire_at(n, now) - now);
+    return (uint16_t)(n->last_seen + n->timeout - now);
 }
 
@@ -4,6 +4,9 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "urcu/list.h"
+#include "wheel_metrics.h"
+#include "wheel_pool.h"
+#include "wheel_mem.h"
 
 #ifndef unlikely
 #define unlikely(x) __builtin_expect(!!(x), 0)
@@ -13,17 +16,46 @@
 #define likely(x) __builtin_expect(!!(x), 1)
 #endif
 
+// Default number of slots, rounded up to a power of two (4096) like any size
+// given to timer_wheel_init_attr()
 #define MAX_TIMER_SLOTS 3600
+// Timer times are kept in 16 bits (last_seen, expire_slot); two revolutions
+// must fit in a signed 16-bit difference
+#define TIMER_WHEEL_MAX_SLOTS 16384
+
+typedef struct timer_wheel_attr_ {
+    uint32_t slots;             // 0: MAX_TIMER_SLOTS; rounded up to a power of two
+    unsigned mem_flags;         // WHEEL_MEM_HUGEPAGE to back the slot array with huge pages
+    int numa_node;              // node for the slot array, -1 for no placement
+} timer_wheel_attr_t;
 
 typedef struct timer_wheel_ {
-    struct cds_list_head slots[MAX_TIMER_SLOTS];
+    struct cds_list_head *slots;
+    uint32_t mask;              // number of slots - 1
+    int mem_kind;               // how slots was allocated, see wheel_mem.h
 	uint32_t count;
     uint32_t current;
+    wheel_metrics_t *metrics;   // NULL unless timer_wheel_set_metrics() was called
+    uint64_t tick_ns;           // length of one time unit, to report lateness in ns
+    wheel_pool_t *pool;         // NULL: callbacks run inside timer_wheel_roll()
+    bool pool_wait;             // roll waits for the pool before returning
+    uint32_t retired;           // expired by pool workers, not yet taken off count
+    struct cds_list_head *returned; // timers workers hand back for relinking
 } timer_wheel_t;
 
-void timer_wheel_init(timer_wheel_t *w);
+int timer_wheel_init(timer_wheel_t *w);
+int timer_wheel_init_attr(timer_wheel_t *w, const timer_wheel_attr_t *attr);
+void timer_wheel_destroy(timer_wheel_t *w);
+void timer_wheel_set_metrics(timer_wheel_t *w, wheel_metrics_t *m, uint64_t tick_ns);
+void timer_wheel_set_pool(timer_wheel_t *w, wheel_pool_t *pool, bool wait);
 void timer_wheel_start(timer_wheel_t *w, uint32_t now);
 uint32_t timer_wheel_roll(timer_wheel_t *w, uint32_t now);
+uint32_t timer_wheel_next_roll(timer_wheel_t *w);
+
+static inline uint32_t timer_wheel_slots(const timer_wheel_t *w)
+{
+    return w->mask + 1;
+}
 
 static inline uint32_t timer_wheel_current(timer_wheel_t *w)
 {
@@ -32,7 +64,7 @@ static inline uint32_t timer_wheel_current(timer_wheel_t *w)
 
 static inline uint32_t timer_wheel_count(timer_wheel_t *w)
 {
-    return w->count;
+    return w->count - __atomic_load_n(&w->retired, __ATOMIC_RELAXED);
 }
 
 static inline bool timer_wheel_started(timer_wheel_t *w)
@@ -43,6 +75,12 @@ static inline bool timer_wheel_started(timer_wheel_t *w)
 struct timer_entry_;
 typedef void (*timer_wheel_expire_fct)(struct timer_entry_ *n);
 
+// Return codes of periodic timer callbacks
+#define DTIMER_OK   0   // keep the timer, it fires again one period later
+#define DTIMER_STOP 1   // remove the timer from the wheel
+
+typedef int (*timer_wheel_periodic_fct)(struct timer_entry_ *n);
+
 #ifdef DEBUG_TIMER_WHEEL
 typedef struct debug_entry_ {
     void *caller[4];
@@ -53,9 +91,16 @@ typedef struct debug_entry_ {
 
 typedef struct timer_entry_ {
     struct cds_list_head link;
-	timer_wheel_expire_fct callback;
+    // Which one is valid depends on period; either is non-NULL while the timer is armed
+    union {
+        timer_wheel_expire_fct callback;
+        timer_wheel_periodic_fct periodic;
+    };
     uint16_t expire_slot;
     uint16_t timeout;
+    uint16_t period;            // 0 for one-shot timers
+    uint16_t last_seen;         // low 16 bits of the last insert/refresh/touch time
+    uint16_t slack;             // expiry may be delayed this much to share a slot
 #ifdef DEBUG_TIMER_WHEEL
     debug_entry_t history[16];
     int debugs;
@@ -68,6 +113,8 @@ void timer_wheel_entry_refresh(timer_wheel_t *w, timer_entry_t *n, uint32_t now)
 void timer_wheel_entry_remove(timer_wheel_t *w, timer_entry_t *n);
 void timer_wheel_entry_start(timer_wheel_t *w, timer_entry_t *n,
                              timer_wheel_expire_fct cb, uint16_t timeout, uint32_t now);
+void timer_wheel_entry_start_periodic(timer_wheel_t *w, timer_entry_t *n,
+                                      timer_wheel_periodic_fct cb, uint16_t period, uint32_t now);
 
 static inline void timer_wheel_entry_set_callback(timer_entry_t *n, timer_wheel_expire_fct cb)
 {
@@ -79,18 +126,56 @@ static inline uint16_t timer_wheel_entry_get_timeout(timer_entry_t *n)
 	return n->timeout;
 }
 
+// Timeouts are limited to the slot count of the wheel when the timer is
+// started; only the absolute limit can be checked here
 static inline void timer_wheel_entry_set_timeout(timer_entry_t *n, uint16_t timeout)
 {
-    if (unlikely(timeout >= MAX_TIMER_SLOTS)) {
+    if (unlikely(timeout >= TIMER_WHEEL_MAX_SLOTS)) {
         return;
     }
 
     n->timeout = timeout;
 }
 
+/*
+ * Timer slack: allow the expiry of a one-shot timer to be delayed by up to
+ * @slack time units, so that timers with nearby deadlines are put into the
+ * same slot and a tickless caller (see timer_wheel_next_roll()) wakes up
+ * less often. Applies from the next start, refresh or touch; ignored by
+ * periodic timers. Kept after the timer expires, 0 (exact) after
+ * timer_wheel_entry_init().
+ */
+static inline void timer_wheel_entry_set_slack(timer_entry_t *n, uint16_t slack)
+{
+    n->slack = slack;
+}
+
+static inline uint16_t timer_wheel_entry_get_slack(const timer_entry_t *n)
+{
+    return n->slack;
+}
+
 uint16_t timer_wheel_entry_get_idle(const timer_entry_t *n, uint32_t now);
 uint16_t timer_wheel_entry_get_life(const timer_entry_t *n, uint32_t now);
 
+/*
+ * Lazy refresh: only record the time of the last activity, without touching
+ * the wheel. When the entry's slot comes due, timer_wheel_roll() moves it to
+ * (last_seen + timeout) instead of expiring it, so a busy one-shot timer is
+ * relinked once per timeout rather than on every refresh. Has no effect on
+ * periodic timers. Requires the wheel to be rolled at least once per
+ * revolution, as 16 bits of the time are kept.
+ */
+static inline void timer_wheel_entry_touch(timer_entry_t *n, uint32_t now)
+{
+    n->last_seen = (uint16_t)now;
+}
+
+static inline bool timer_wheel_entry_is_periodic(const timer_entry_t *n)
+{
+    return n->period != 0;
+}
+
 static inline bool timer_wheel_entry_is_active(const timer_entry_t *n)
 {
     //return (n->expire_slot == (uint16_t)(-1)) ? false : true;
@@ -0,0 +1,179 @@
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "wheel_clock.h"
+
+struct wheel_clock_tsc_ wheel_clock_tsc;
+int wheel_clock_src = -1;
+uint64_t wheel_clock_cached;
+
+static uint64_t tsc_hz;
+static pthread_once_t clock_once = PTHREAD_ONCE_INIT;
+static pthread_t clock_thread;
+static int clock_thread_running;
+static volatile int clock_thread_stop;
+static uint32_t clock_thread_period_us;
+
+static uint64_t timespec_ns(const struct timespec *ts)
+{
+    return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+uint64_t wheel_clock_mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return timespec_ns(&ts);
+}
+
+uint64_t wheel_clock_coarse_ns(void)
+{
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return timespec_ns(&ts);
+}
+
+int wheel_clock_tsc_invariant(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) {
+        return 0;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx >> 8) & 1;
+#else
+    return 0;
+#endif
+}
+
+// Read CLOCK_MONOTONIC between two TSC reads; retry a few times and keep the
+// tightest bracket so a preemption in between does not skew the sample
+static void tsc_sample(uint64_t *tsc, uint64_t *ns)
+{
+    uint64_t t0 = wheel_clock_rdtsc();
+    uint64_t n = wheel_clock_mono_ns();
+    uint64_t t1 = wheel_clock_rdtsc();
+    uint64_t best = t1 - t0;
+    int i;
+
+    *tsc = t0 + best / 2;
+    *ns = n;
+    for (i = 1; i < 8; i ++) {
+        t0 = wheel_clock_rdtsc();
+        n = wheel_clock_mono_ns();
+        t1 = wheel_clock_rdtsc();
+        if (t1 - t0 < best) {
+            best = t1 - t0;
+            *tsc = t0 + (t1 - t0) / 2;
+            *ns = n;
+        }
+    }
+}
+
+static int tsc_calibrate(uint32_t calibrate_ms)
+{
+    struct timespec req = { calibrate_ms / 1000, (long)(calibrate_ms % 1000) * 1000000L };
+    uint64_t tsc0, ns0, tsc1, ns1;
+
+    tsc_sample(&tsc0, &ns0);
+    while (nanosleep(&req, &req) != 0 && errno == EINTR)
+        ;
+    tsc_sample(&tsc1, &ns1);
+
+    if (tsc1 <= tsc0 || ns1 <= ns0) {
+        return -1;
+    }
+
+    tsc_hz = (uint64_t)((__uint128_t)(tsc1 - tsc0) * 1000000000ULL / (ns1 - ns0));
+    wheel_clock_tsc.mult = (uint64_t)(((__uint128_t)(ns1 - ns0) << 32) / (tsc1 - tsc0));
+    wheel_clock_tsc.base_tsc = tsc1;
+    wheel_clock_tsc.base_ns = ns1;
+    return 0;
+}
+
+int wheel_clock_init(int prefer_tsc, uint32_t calibrate_ms)
+{
+    int src = WHEEL_CLOCK_MONOTONIC;
+
+    tsc_hz = 0;
+    if (prefer_tsc && wheel_clock_tsc_invariant() &&
+        tsc_calibrate(calibrate_ms ? calibrate_ms : 20) == 0) {
+        src = WHEEL_CLOCK_TSC;
+    }
+
+    __atomic_store_n(&wheel_clock_src, src, __ATOMIC_RELEASE);
+    wheel_clock_update();
+    return src;
+}
+
+static void clock_init_default(void)
+{
+    // An explicit wheel_clock_init() at startup already chose the source
+    if (__atomic_load_n(&wheel_clock_src, __ATOMIC_ACQUIRE) < 0) {
+        wheel_clock_init(1, 0);
+    }
+}
+
+int wheel_clock_source(void)
+{
+    if (__builtin_expect(__atomic_load_n(&wheel_clock_src, __ATOMIC_ACQUIRE) < 0, 0)) {
+        pthread_once(&clock_once, clock_init_default);
+    }
+    return wheel_clock_src;
+}
+
+uint64_t wheel_clock_tsc_hz(void)
+{
+    return tsc_hz;
+}
+
+static void *clock_thread_run(void *arg)
+{
+    struct timespec req;
+    (void)arg;
+
+    req.tv_sec = clock_thread_period_us / 1000000;
+    req.tv_nsec = (long)(clock_thread_period_us % 1000000) * 1000L;
+    while (!clock_thread_stop) {
+        wheel_clock_update();
+        nanosleep(&req, NULL);
+    }
+    return NULL;
+}
+
+int wheel_clock_start_thread(uint32_t period_us)
+{
+    if (clock_thread_running) {
+        return 0;
+    }
+
+    wheel_clock_source();
+    clock_thread_period_us = period_us ? period_us : 1000;
+    clock_thread_stop = 0;
+    wheel_clock_update();
+    if (pthread_create(&clock_thread, NULL, clock_thread_run, NULL) != 0) {
+        return -1;
+    }
+    clock_thread_running = 1;
+    return 0;
+}
+
+void wheel_clock_stop_thread(void)
+{
+    if (!clock_thread_running) {
+        return;
+    }
+    clock_thread_stop = 1;
+    pthread_join(clock_thread, NULL);
+    clock_thread_running = 0;
+}
@@ -0,0 +1,126 @@
+#ifndef __WHEEL_CLOCK_H__
+#define __WHEEL_CLOCK_H__
+
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Timestamp sources shared by the timer wheels.
+//
+// wheel_clock_ns()         precise monotonic nanoseconds: calibrated TSC when
+//                          the CPU has an invariant TSC, CLOCK_MONOTONIC otherwise
+// wheel_clock_cached_ns()  the value stored by the last wheel_clock_update(),
+//                          refreshed once per poll iteration or by the clock thread;
+//                          a plain load on the hot path
+// wheel_clock_coarse_ns()  CLOCK_MONOTONIC_COARSE (jiffy resolution)
+//
+// wheel_clock_ns() and wheel_clock_cached_ns() are one timeline; use them for
+// durations and for wheels that only compare against themselves. The TSC is
+// calibrated against CLOCK_MONOTONIC once, and NTP keeps slewing the latter,
+// so the two drift apart by microseconds within seconds. Deadlines handed to
+// the kernel (timerfd, pthread_cond_timedwait on CLOCK_MONOTONIC) and the
+// "now" compared with them must come from wheel_clock_mono_ns().
+
+#define WHEEL_CLOCK_MONOTONIC 0
+#define WHEEL_CLOCK_TSC       1
+
+// Pick the source and calibrate the TSC (takes calibrate_ms, 0 for the default
+// 20ms). prefer_tsc = 0 forces CLOCK_MONOTONIC. Returns the source in use.
+// Not thread-safe: call it at startup, before other threads read the clock,
+// to choose the source or to keep the calibration off the first wheel's
+// constructor. Until then CLOCK_MONOTONIC is used.
+int wheel_clock_init(int prefer_tsc, uint32_t calibrate_ms);
+// Source in use. The first call without a prior wheel_clock_init() runs
+// wheel_clock_init(1, 0) exactly once (pthread_once); concurrent callers wait
+// for that calibration. The wheels call this from their constructors.
+int wheel_clock_source(void);
+// Whether cpuid reports an invariant (constant rate, non-stop) TSC
+int wheel_clock_tsc_invariant(void);
+// Calibrated TSC frequency, 0 when the TSC is not used
+uint64_t wheel_clock_tsc_hz(void);
+
+uint64_t wheel_clock_mono_ns(void);
+uint64_t wheel_clock_coarse_ns(void);
+
+static inline uint64_t wheel_clock_rdtsc(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// TSC to nanoseconds: ns = base_ns + ((tsc - base_tsc) * mult) >> 32
+struct wheel_clock_tsc_ {
+    uint64_t base_tsc;
+    uint64_t base_ns;
+    uint64_t mult;
+};
+extern struct wheel_clock_tsc_ wheel_clock_tsc;
+extern int wheel_clock_src;
+extern uint64_t wheel_clock_cached;
+
+static inline uint64_t wheel_clock_tsc_to_ns(uint64_t tsc)
+{
+    __uint128_t d = (__uint128_t)(tsc - wheel_clock_tsc.base_tsc) * wheel_clock_tsc.mult;
+    return wheel_clock_tsc.base_ns + (uint64_t)(d >> 32);
+}
+
+static inline uint64_t wheel_clock_ns(void)
+{
+    if (__builtin_expect(wheel_clock_src == WHEEL_CLOCK_TSC, 1)) {
+        return wheel_clock_tsc_to_ns(wheel_clock_rdtsc());
+    }
+    return wheel_clock_mono_ns();
+}
+
+static inline uint64_t wheel_clock_cached_ns(void)
+{
+    return __atomic_load_n(&wheel_clock_cached, __ATOMIC_RELAXED);
+}
+
+// Refresh the cached time from wheel_clock_ns() and return it
+static inline uint64_t wheel_clock_update(void)
+{
+    uint64_t now = wheel_clock_ns();
+    __atomic_store_n(&wheel_clock_cached, now, __ATOMIC_RELAXED);
+    return now;
+}
+
+// Background thread calling wheel_clock_update() every period_us
+int wheel_clock_start_thread(uint32_t period_us);
+void wheel_clock_stop_thread(void);
+
+// Wheel ticks: tick n covers [origin + n * tick_ns, origin + (n + 1) * tick_ns)
+typedef struct wheel_ticks_ {
+    uint64_t origin_ns;
+    uint64_t tick_ns;
+} wheel_ticks_t;
+
+static inline void wheel_ticks_init(wheel_ticks_t *t, uint64_t origin_ns, uint64_t tick_ns)
+{
+    t->origin_ns = origin_ns;
+    t->tick_ns = tick_ns ? tick_ns : 1;
+}
+
+static inline uint32_t wheel_ticks_from_ns(const wheel_ticks_t *t, uint64_t ns)
+{
+    return ns <= t->origin_ns ? 0 : (uint32_t)((ns - t->origin_ns) / t->tick_ns);
+}
+
+static inline uint64_t wheel_ticks_to_ns(const wheel_ticks_t *t, uint32_t tick)
+{
+    return t->origin_ns + (uint64_t)tick * t->tick_ns;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,138 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "wheel_mem.h"
+#include "helper.h"
+
+/*
+ * Prefer @node for every page of [p, p + size). Raw syscall, so that libnuma
+ * is not needed; a failure (no NUMA support, no such node) leaves the default
+ * first-touch policy in place.
+ */
+static void wheel_mem_bind(void *p, size_t size, int node)
+{
+    unsigned long mask[4] = { 0 };
+
+    if (node < 0 || node >= (int)(sizeof(mask) * 8)) {
+        return;
+    }
+    mask[node / 64] = 1UL << (node % 64);
+    syscall(SYS_mbind, p, size, MPOL_PREFERRED, mask, sizeof(mask) * 8, 0);
+}
+
+static void *wheel_mem_map(size_t size, int extra)
+{
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra, -1, 0);
+
+    return p == MAP_FAILED ? NULL : p;
+}
+
+/*
+ * A 2 MB aligned anonymous mapping for transparent huge pages: map one huge
+ * page more than needed and trim both ends.
+ */
+static void *wheel_mem_map_thp(size_t size)
+{
+    uint8_t *p = wheel_mem_map(size + WHEEL_MEM_HUGE_SIZE, 0), *aligned;
+    size_t head;
+
+    if (p == NULL) {
+        return NULL;
+    }
+    aligned = (uint8_t *)ALIGN_UP((uintptr_t)p, WHEEL_MEM_HUGE_SIZE);
+    head = aligned - p;
+    if (head) {
+        munmap(p, head);
+    }
+    munmap(aligned + size, WHEEL_MEM_HUGE_SIZE - head);
+    madvise(aligned, size, MADV_HUGEPAGE);
+    return aligned;
+}
+
+/**
+ * wheel_mem_alloc - Allocate zeroed memory for a wheel or an entry pool
+ * @size: Bytes needed
+ * @flags: WHEEL_MEM_HUGEPAGE or 0
+ * @numa_node: Node to place the memory on, negative for no placement
+ * @kind: Returns how the memory was obtained, to pass to wheel_mem_free()
+ *
+ * Huge page requests round @size up to a multiple of 2 MB. When no
+ * hugetlbfs page is free, transparent huge pages are used instead; whether
+ * the kernel really backs the range with huge pages then depends on
+ * /sys/kernel/mm/transparent_hugepage/enabled.
+ *
+ * Return: The memory, or NULL when out of memory
+ */
+void *wheel_mem_alloc(size_t size, unsigned flags, int numa_node, int *kind)
+{
+    void *p = NULL;
+
+    if (!(flags & WHEEL_MEM_HUGEPAGE) && numa_node < 0) {
+        *kind = WHEEL_MEM_MALLOC;
+        return calloc(1, size);
+    }
+
+    if (flags & WHEEL_MEM_HUGEPAGE) {
+        size = ALIGN_UP(size, WHEEL_MEM_HUGE_SIZE);
+        // hugetlbfs pages are only faulted in on first touch too, so the
+        // binding below still applies
+        if ((p = wheel_mem_map(size, MAP_HUGETLB)) != NULL) {
+            *kind = WHEEL_MEM_HUGETLB;
+        } else if ((p = wheel_mem_map_thp(size)) != NULL) {
+            *kind = WHEEL_MEM_THP;
+        }
+    } else {
+        size = ALIGN_UP(size, (size_t)sysconf(_SC_PAGESIZE));
+        if ((p = wheel_mem_map(size, 0)) != NULL) {
+            *kind = WHEEL_MEM_PAGES;
+        }
+    }
+    if (p == NULL) {
+        return NULL;
+    }
+    wheel_mem_bind(p, size, numa_node);
+    // Fault everything in now, on the bound node
+    memset(p, 0, size);
+    return p;
+}
+
+/**
+ * wheel_mem_free - Free memory from wheel_mem_alloc()
+ * @p: The memory, may be NULL
+ * @size: The size passed to wheel_mem_alloc()
+ * @kind: The kind returned by wheel_mem_alloc()
+ */
+void wheel_mem_free(void *p, size_t size, int kind)
+{
+    if (p == NULL) {
+        return;
+    }
+    switch (kind) {
+    case WHEEL_MEM_MALLOC:
+        free(p);
+        break;
+    case WHEEL_MEM_PAGES:
+        munmap(p, ALIGN_UP(size, (size_t)sysconf(_SC_PAGESIZE)));
+        break;
+    default:
+        munmap(p, ALIGN_UP(size, WHEEL_MEM_HUGE_SIZE));
+        break;
+    }
+}
+
+const char *wheel_mem_kind_name(int kind)
+{
+    switch (kind) {
+    case WHEEL_MEM_MALLOC:  return "malloc";
+    case WHEEL_MEM_PAGES:   return "4k";
+    case WHEEL_MEM_HUGETLB: return "hugetlb";
+    case WHEEL_MEM_THP:     return "thp";
+    default:                return "?";
+    }
+}
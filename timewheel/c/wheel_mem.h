@@ -0,0 +1,45 @@
+#ifndef __WHEEL_MEM_H__
+#define __WHEEL_MEM_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Backing memory for timer wheel slot arrays and timer entry pools.
+//
+// A wheel with many slots, or a pool of millions of entries, is touched at
+// random; with 4 KB pages nearly every access also misses the TLB. With
+// WHEEL_MEM_HUGEPAGE the memory is mapped from 2 MB huge pages: explicit
+// hugetlbfs pages (MAP_HUGETLB) when the administrator reserved some
+// (vm.nr_hugepages), otherwise a 2 MB aligned anonymous mapping that is
+// madvise()d for transparent huge pages. With a NUMA node the mapping is
+// bound to that node (preferred, falls back to other nodes when it is full)
+// before it is first touched.
+//
+// The memory is returned zeroed and already faulted in, so that the first
+// timer operations do not pay for page faults.
+
+#define WHEEL_MEM_HUGEPAGE  0x1
+
+#define WHEEL_MEM_HUGE_SIZE (2UL << 20)
+
+// How wheel_mem_alloc() obtained the memory, needed to free it
+#define WHEEL_MEM_MALLOC    0           // no flags and no node: calloc
+#define WHEEL_MEM_PAGES     1           // mmap with 4 KB pages
+#define WHEEL_MEM_HUGETLB   2           // mmap(MAP_HUGETLB)
+#define WHEEL_MEM_THP       3           // mmap + madvise(MADV_HUGEPAGE)
+
+// numa_node < 0: no placement. Returns NULL when out of memory; *kind is set
+// to one of the WHEEL_MEM_* kinds above.
+void *wheel_mem_alloc(size_t size, unsigned flags, int numa_node, int *kind);
+void wheel_mem_free(void *p, size_t size, int kind);
+
+const char *wheel_mem_kind_name(int kind);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,298 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wheel_metrics.h"
+
+__thread wheel_metrics_tls_entry_t *wheel_metrics_tls;
+__thread uint32_t wheel_metrics_tls_cap;
+
+// Ids of destroyed objects are handed out again so the per-thread tables stay
+// as large as the most wheel_metrics_t alive at once, not the most ever
+// created. Every object gets a fresh nonzero gen, so a thread's entry left
+// over from an earlier owner of the id never matches.
+static pthread_mutex_t wheel_metrics_id_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t *wheel_metrics_free_ids;
+static uint32_t wheel_metrics_free_count;
+static uint32_t wheel_metrics_free_cap;
+static uint32_t wheel_metrics_next_id;
+static uint32_t wheel_metrics_next_gen;
+
+static const char *counter_names[WHEEL_METRIC_COUNTERS] = {
+    "inserts", "refreshes", "cancels", "expires", "ticks",
+};
+
+static const char *hist_names[WHEEL_HISTS] = {
+    "tick_ns", "lateness_ns", "lock_wait_ns",
+};
+
+const char *wheel_metrics_counter_name(int counter)
+{
+    return counter >= 0 && counter < WHEEL_METRIC_COUNTERS ? counter_names[counter] : "?";
+}
+
+const char *wheel_metrics_hist_name(int hist)
+{
+    return hist >= 0 && hist < WHEEL_HISTS ? hist_names[hist] : "?";
+}
+
+/**
+ * wheel_metrics_create - Allocate a metrics object
+ * @name: Label used by the dumps, truncated to 31 characters
+ *
+ * Return: The metrics object, or NULL when out of memory
+ */
+wheel_metrics_t *wheel_metrics_create(const char *name)
+{
+    wheel_metrics_t *m = calloc(1, sizeof(*m));
+    if (m == NULL) {
+        return NULL;
+    }
+
+    strncpy(m->name, name ? name : "wheel", sizeof(m->name) - 1);
+    pthread_mutex_lock(&wheel_metrics_id_lock);
+    m->id = wheel_metrics_free_count ? wheel_metrics_free_ids[--wheel_metrics_free_count]
+                                     : wheel_metrics_next_id++;
+    if (++wheel_metrics_next_gen == 0) {
+        wheel_metrics_next_gen = 1;
+    }
+    m->gen = wheel_metrics_next_gen;
+    pthread_mutex_unlock(&wheel_metrics_id_lock);
+    return m;
+}
+
+/**
+ * wheel_metrics_destroy - Free a metrics object and all of its shards
+ * @m: Metrics to free, may be NULL
+ *
+ * Returns @m->id to the free list. The calling threads' table entries for it
+ * are left as they are; the next owner of the id has a different gen.
+ */
+void wheel_metrics_destroy(wheel_metrics_t *m)
+{
+    wheel_metrics_shard_t *s, *next;
+
+    if (m == NULL) {
+        return;
+    }
+    for (s = m->shards; s; s = next) {
+        next = s->next;
+        free(s);
+    }
+
+    pthread_mutex_lock(&wheel_metrics_id_lock);
+    if (wheel_metrics_free_count == wheel_metrics_free_cap) {
+        uint32_t cap = wheel_metrics_free_cap ? wheel_metrics_free_cap * 2 : 8;
+        uint32_t *ids = realloc(wheel_metrics_free_ids, cap * sizeof(*ids));
+        if (ids != NULL) {
+            wheel_metrics_free_ids = ids;
+            wheel_metrics_free_cap = cap;
+        }
+    }
+    // Out of memory: the id is lost, which is what used to happen to all of them
+    if (wheel_metrics_free_count < wheel_metrics_free_cap) {
+        wheel_metrics_free_ids[wheel_metrics_free_count++] = m->id;
+    }
+    pthread_mutex_unlock(&wheel_metrics_id_lock);
+    free(m);
+}
+
+/**
+ * wheel_metrics_shard_slow - Find or create the calling thread's shard
+ * @m: Metrics being updated
+ *
+ * Grows the thread's shard table to cover @m->id and links a new shard into
+ * @m->shards with a lock-free push. An entry left by an earlier owner of the
+ * id is overwritten. Shard tables are never freed; they are a few entries per
+ * thread, bounded by the most metrics objects alive at once.
+ *
+ * Return: The shard; aborts when out of memory, like the rest of the hot path
+ * has no way to report it
+ */
+wheel_metrics_shard_t *wheel_metrics_shard_slow(wheel_metrics_t *m)
+{
+    wheel_metrics_shard_t *s;
+
+    if (m->id >= wheel_metrics_tls_cap) {
+        uint32_t cap = wheel_metrics_tls_cap ? wheel_metrics_tls_cap : 8;
+        while (cap <= m->id) {
+            cap *= 2;
+        }
+        wheel_metrics_tls_entry_t *tls = realloc(wheel_metrics_tls, cap * sizeof(*tls));
+        if (tls == NULL) {
+            abort();
+        }
+        memset(tls + wheel_metrics_tls_cap, 0, (cap - wheel_metrics_tls_cap) * sizeof(*tls));
+        wheel_metrics_tls = tls;
+        wheel_metrics_tls_cap = cap;
+    }
+
+    s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        abort();
+    }
+    s->next = __atomic_load_n(&m->shards, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&m->shards, &s->next, s, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+
+    wheel_metrics_tls[m->id].shard = s;
+    wheel_metrics_tls[m->id].gen = m->gen;
+    return s;
+}
+
+static uint64_t load(const uint64_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+void wheel_hist_merge(wheel_hist_t *dst, const wheel_hist_t *src)
+{
+    unsigned i;
+    uint64_t max = load(&src->max);
+
+    dst->count += load(&src->count);
+    dst->sum += load(&src->sum);
+    if (max > dst->max) {
+        dst->max = max;
+    }
+    for (i = 0; i < WHEEL_HIST_BUCKETS; i++) {
+        dst->buckets[i] += load(&src->buckets[i]);
+    }
+}
+
+uint64_t wheel_hist_bucket_lower(unsigned idx)
+{
+    if (idx < WHEEL_HIST_SUB) {
+        return idx;
+    }
+    if (idx >= WHEEL_HIST_BUCKETS) {
+        return UINT64_MAX;
+    }
+    unsigned k = (idx >> WHEEL_HIST_SUB_BITS) + WHEEL_HIST_SUB_BITS - 1;
+    return (1ULL << k) + ((uint64_t)(idx & (WHEEL_HIST_SUB - 1)) << (k - WHEEL_HIST_SUB_BITS));
+}
+
+uint64_t wheel_hist_percentile(const wheel_hist_t *h, double p)
+{
+    unsigned i;
+    uint64_t seen = 0, rank;
+
+    if (h->count == 0) {
+        return 0;
+    }
+    rank = (uint64_t)(p / 100.0 * (double)h->count);
+    if (rank >= h->count) {
+        return h->max;
+    }
+    for (i = 0; i < WHEEL_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen > rank) {
+            uint64_t upper = wheel_hist_bucket_lower(i + 1) - 1;
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+/**
+ * wheel_metrics_snapshot - Merge all per-thread shards
+ * @m: Metrics to read, may be updated concurrently; NULL gives an empty snapshot
+ * @s: Output; about 12KB, better not placed on a small stack
+ */
+void wheel_metrics_snapshot(const wheel_metrics_t *m, wheel_metrics_snapshot_t *s)
+{
+    const wheel_metrics_shard_t *sh;
+    int i;
+
+    memset(s, 0, sizeof(*s));
+    if (m == NULL) {
+        return;
+    }
+    memcpy(s->name, m->name, sizeof(s->name));
+
+    for (sh = __atomic_load_n(&m->shards, __ATOMIC_ACQUIRE); sh; sh = sh->next) {
+        uint64_t max_slot = load(&sh->max_slot);
+
+        for (i = 0; i < WHEEL_METRIC_COUNTERS; i++) {
+            s->counters[i] += load(&sh->counters[i]);
+        }
+        if (max_slot > s->max_slot) {
+            s->max_slot = max_slot;
+        }
+        for (i = 0; i < WHEEL_HISTS; i++) {
+            wheel_hist_merge(&s->hists[i], &sh->hists[i]);
+        }
+        s->shards++;
+    }
+
+    uint64_t gone = s->counters[WHEEL_METRIC_CANCEL] + s->counters[WHEEL_METRIC_EXPIRE];
+    s->active = s->counters[WHEEL_METRIC_INSERT] > gone ? s->counters[WHEEL_METRIC_INSERT] - gone : 0;
+}
+
+static void dump_hist_text(FILE *fp, const char *name, const wheel_hist_t *h)
+{
+    fprintf(fp, "  %-13s count=%llu mean=%.0f p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu\n",
+            name, (unsigned long long)h->count, h->count ? (double)h->sum / h->count : 0.0,
+            (unsigned long long)wheel_hist_percentile(h, 50),
+            (unsigned long long)wheel_hist_percentile(h, 90),
+            (unsigned long long)wheel_hist_percentile(h, 99),
+            (unsigned long long)wheel_hist_percentile(h, 99.9),
+            (unsigned long long)h->max);
+}
+
+void wheel_metrics_dump_text(FILE *fp, const wheel_metrics_snapshot_t *s)
+{
+    int i;
+
+    fprintf(fp, "wheel %s: active=%llu max_slot=%llu threads=%u\n", s->name,
+            (unsigned long long)s->active, (unsigned long long)s->max_slot, s->shards);
+    fprintf(fp, " ");
+    for (i = 0; i < WHEEL_METRIC_COUNTERS; i++) {
+        fprintf(fp, " %s=%llu", counter_names[i], (unsigned long long)s->counters[i]);
+    }
+    fprintf(fp, "\n");
+    for (i = 0; i < WHEEL_HISTS; i++) {
+        dump_hist_text(fp, hist_names[i], &s->hists[i]);
+    }
+}
+
+static void dump_hist_json(FILE *fp, const wheel_hist_t *h)
+{
+    unsigned i;
+    int first = 1;
+
+    fprintf(fp, "{\"count\": %llu, \"sum\": %llu, \"max\": %llu, "
+            "\"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"buckets\": [",
+            (unsigned long long)h->count, (unsigned long long)h->sum, (unsigned long long)h->max,
+            (unsigned long long)wheel_hist_percentile(h, 50),
+            (unsigned long long)wheel_hist_percentile(h, 90),
+            (unsigned long long)wheel_hist_percentile(h, 99),
+            (unsigned long long)wheel_hist_percentile(h, 99.9));
+    // Only non-empty buckets, as [lower bound, count]
+    for (i = 0; i < WHEEL_HIST_BUCKETS; i++) {
+        if (h->buckets[i]) {
+            fprintf(fp, "%s[%llu, %llu]", first ? "" : ", ",
+                    (unsigned long long)wheel_hist_bucket_lower(i), (unsigned long long)h->buckets[i]);
+            first = 0;
+        }
+    }
+    fprintf(fp, "]}");
+}
+
+void wheel_metrics_dump_json(FILE *fp, const wheel_metrics_snapshot_t *s)
+{
+    int i;
+
+    // Names are set by the wheels themselves, no escaping needed
+    fprintf(fp, "{\"name\": \"%s\", \"active\": %llu, \"max_slot\": %llu, \"threads\": %u",
+            s->name, (unsigned long long)s->active, (unsigned long long)s->max_slot, s->shards);
+    for (i = 0; i < WHEEL_METRIC_COUNTERS; i++) {
+        fprintf(fp, ", \"%s\": %llu", counter_names[i], (unsigned long long)s->counters[i]);
+    }
+    for (i = 0; i < WHEEL_HISTS; i++) {
+        fprintf(fp, ", \"%s\": ", hist_names[i]);
+        dump_hist_json(fp, &s->hists[i]);
+    }
+    fprintf(fp, "}\n");
+}
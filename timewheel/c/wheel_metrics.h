@@ -0,0 +1,169 @@
+#ifndef __WHEEL_METRICS_H__
+#define __WHEEL_METRICS_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Runtime metrics shared by the timer wheels.
+//
+// Every thread that updates a wheel_metrics_t gets its own shard, so the hot
+// path is a thread-local lookup plus plain stores (relaxed atomics, no lock
+// prefix) and never contends. Readers walk the shard list and merge them into
+// a wheel_metrics_snapshot_t; a snapshot taken while writers are running is
+// consistent per counter but not across counters.
+//
+// Histograms are HDR-style log-linear: values below WHEEL_HIST_SUB are exact,
+// every power of two above is split into WHEEL_HIST_SUB linear sub-buckets,
+// so any recorded value is off by at most 1/WHEEL_HIST_SUB (12.5%).
+
+enum {
+    WHEEL_METRIC_INSERT,        // timers/sessions added
+    WHEEL_METRIC_REFRESH,       // existing timers re-armed
+    WHEEL_METRIC_CANCEL,        // removed before expiry
+    WHEEL_METRIC_EXPIRE,        // expired (callback run / session timed out)
+    WHEEL_METRIC_TICK,          // ticks (or roll calls) processed
+    WHEEL_METRIC_COUNTERS
+};
+
+enum {
+    WHEEL_HIST_TICK,            // ns spent processing one tick
+    WHEEL_HIST_LATENESS,        // ns between scheduled and actual expiry, per timer
+    WHEEL_HIST_LOCK_WAIT,       // ns waited for the wheel lock, 0 when uncontended
+    WHEEL_HISTS
+};
+
+#define WHEEL_HIST_SUB_BITS 3
+#define WHEEL_HIST_SUB      (1u << WHEEL_HIST_SUB_BITS)
+#define WHEEL_HIST_BUCKETS  ((64 - WHEEL_HIST_SUB_BITS + 1) * WHEEL_HIST_SUB)
+
+typedef struct wheel_hist_ {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[WHEEL_HIST_BUCKETS];
+} wheel_hist_t;
+
+typedef struct wheel_metrics_shard_ {
+    uint64_t counters[WHEEL_METRIC_COUNTERS];
+    uint64_t max_slot;                  // most timers found in one slot when it came due
+    wheel_hist_t hists[WHEEL_HISTS];
+    struct wheel_metrics_shard_ *next;
+} wheel_metrics_shard_t;
+
+typedef struct wheel_metrics_ {
+    char name[32];
+    uint32_t id;                        // index into the per-thread shard table, reused after destroy
+    uint32_t gen;                       // tells this object apart from earlier owners of id
+    wheel_metrics_shard_t *shards;      // one per writer thread, freed by destroy
+} wheel_metrics_t;
+
+typedef struct wheel_metrics_snapshot_ {
+    char name[32];
+    uint64_t counters[WHEEL_METRIC_COUNTERS];
+    uint64_t active;                    // insert - cancel - expire
+    uint64_t max_slot;
+    uint32_t shards;                    // threads that have updated the metrics
+    wheel_hist_t hists[WHEEL_HISTS];
+} wheel_metrics_snapshot_t;
+
+wheel_metrics_t *wheel_metrics_create(const char *name);
+// Not safe while other threads are still updating the metrics
+void wheel_metrics_destroy(wheel_metrics_t *m);
+
+void wheel_metrics_snapshot(const wheel_metrics_t *m, wheel_metrics_snapshot_t *s);
+void wheel_metrics_dump_text(FILE *fp, const wheel_metrics_snapshot_t *s);
+void wheel_metrics_dump_json(FILE *fp, const wheel_metrics_snapshot_t *s);
+
+const char *wheel_metrics_counter_name(int counter);
+const char *wheel_metrics_hist_name(int hist);
+
+// Histogram helpers, also usable on their own
+void wheel_hist_merge(wheel_hist_t *dst, const wheel_hist_t *src);
+// Upper bound of the bucket holding the p-th percentile (0 < p <= 100), clamped to max
+uint64_t wheel_hist_percentile(const wheel_hist_t *h, double p);
+// Smallest value that falls into bucket idx
+uint64_t wheel_hist_bucket_lower(unsigned idx);
+
+static inline unsigned wheel_hist_index(uint64_t v)
+{
+    if (v < WHEEL_HIST_SUB) {
+        return (unsigned)v;
+    }
+    unsigned k = 63 - (unsigned)__builtin_clzll(v);
+    return ((k - WHEEL_HIST_SUB_BITS + 1) << WHEEL_HIST_SUB_BITS) +
+           (unsigned)((v >> (k - WHEEL_HIST_SUB_BITS)) & (WHEEL_HIST_SUB - 1));
+}
+
+// Single-writer update: the loads are plain, the stores relaxed so that readers
+// never see torn values
+static inline void wheel_metrics_store_add(uint64_t *p, uint64_t v)
+{
+    __atomic_store_n(p, *p + v, __ATOMIC_RELAXED);
+}
+
+static inline void wheel_hist_record_n(wheel_hist_t *h, uint64_t v, uint64_t n)
+{
+    wheel_metrics_store_add(&h->buckets[wheel_hist_index(v)], n);
+    wheel_metrics_store_add(&h->count, n);
+    wheel_metrics_store_add(&h->sum, v * n);
+    if (v > h->max) {
+        __atomic_store_n(&h->max, v, __ATOMIC_RELAXED);
+    }
+}
+
+// Per-thread shard table indexed by wheel_metrics_t.id. An entry whose gen
+// differs from the object's belongs to a destroyed wheel_metrics_t that had
+// the same id; its shard pointer is dangling and must not be touched.
+typedef struct wheel_metrics_tls_entry_ {
+    wheel_metrics_shard_t *shard;
+    uint32_t gen;
+} wheel_metrics_tls_entry_t;
+
+extern __thread wheel_metrics_tls_entry_t *wheel_metrics_tls;
+extern __thread uint32_t wheel_metrics_tls_cap;
+
+wheel_metrics_shard_t *wheel_metrics_shard_slow(wheel_metrics_t *m);
+
+static inline wheel_metrics_shard_t *wheel_metrics_local(wheel_metrics_t *m)
+{
+    if (__builtin_expect(m->id < wheel_metrics_tls_cap && wheel_metrics_tls[m->id].gen == m->gen, 1)) {
+        return wheel_metrics_tls[m->id].shard;
+    }
+    return wheel_metrics_shard_slow(m);
+}
+
+// All updaters accept m == NULL (metrics disabled) and then cost one branch
+
+static inline void wheel_metrics_count(wheel_metrics_t *m, int counter, uint64_t n)
+{
+    if (m) {
+        wheel_metrics_store_add(&wheel_metrics_local(m)->counters[counter], n);
+    }
+}
+
+static inline void wheel_metrics_record(wheel_metrics_t *m, int hist, uint64_t v, uint64_t n)
+{
+    if (m && n) {
+        wheel_hist_record_n(&wheel_metrics_local(m)->hists[hist], v, n);
+    }
+}
+
+static inline void wheel_metrics_slot(wheel_metrics_t *m, uint64_t occupancy)
+{
+    if (m) {
+        wheel_metrics_shard_t *s = wheel_metrics_local(m);
+        if (occupancy > s->max_slot) {
+            __atomic_store_n(&s->max_slot, occupancy, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,357 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "wheel_pool.h"
+
+// Per-worker deque capacity; a full deque spills into the shared FIFO
+#define WHEEL_DEQUE_SIZE 1024
+
+/*
+ * Chase-Lev deque ("Correct and Efficient Work-Stealing for Weak Memory
+ * Models", Le et al., PPoPP 2013) on a fixed ring. Only the owner pushes and
+ * pops at the bottom; any thread steals at the top.
+ */
+typedef struct wheel_deque_ {
+    int64_t top __attribute__((aligned(64)));
+    int64_t bottom __attribute__((aligned(64)));
+    wheel_task_t *buf[WHEEL_DEQUE_SIZE];
+} wheel_deque_t;
+
+typedef struct wheel_worker_ {
+    wheel_deque_t deque;
+    wheel_pool_t *pool;
+    pthread_t thread;
+    unsigned index;
+    unsigned seed;
+} wheel_worker_t;
+
+struct wheel_pool_ {
+    wheel_worker_t *workers;
+    unsigned nworkers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;       // idle workers wait here
+    pthread_cond_t idle_cond;       // wheel_pool_wait() waits here
+    wheel_task_t *head, *tail;      // shared FIFO, under lock
+    unsigned sleepers;              // written under lock, read lock-free by submitters
+    bool stopping;
+
+    uint64_t pending;               // submitted and not finished
+};
+
+// The worker the calling thread is, so that submit() from a task pushes to
+// its own deque
+static __thread wheel_worker_t *wheel_pool_self;
+
+static bool deque_push(wheel_deque_t *d, wheel_task_t *t)
+{
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+
+    if (b - top >= WHEEL_DEQUE_SIZE) {
+        return false;
+    }
+    __atomic_store_n(&d->buf[b & (WHEEL_DEQUE_SIZE - 1)], t, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+static wheel_task_t *deque_pop(wheel_deque_t *d)
+{
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    wheel_task_t *t = NULL;
+
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t top = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+    if (top <= b) {
+        t = __atomic_load_n(&d->buf[b & (WHEEL_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+        if (top == b) {
+            // Last item: race the thieves for it
+            if (!__atomic_compare_exchange_n(&d->top, &top, top + 1, false,
+                                             __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+                t = NULL;
+            }
+            __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return t;
+}
+
+static wheel_task_t *deque_steal(wheel_deque_t *d)
+{
+    int64_t top = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+
+    if (top >= b) {
+        return NULL;
+    }
+    wheel_task_t *t = __atomic_load_n(&d->buf[top & (WHEEL_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&d->top, &top, top + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    return t;
+}
+
+static bool deque_empty(wheel_deque_t *d)
+{
+    return __atomic_load_n(&d->top, __ATOMIC_ACQUIRE) >= __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+}
+
+static wheel_task_t *fifo_pop_locked(wheel_pool_t *p)
+{
+    wheel_task_t *t = p->head;
+
+    if (t != NULL) {
+        p->head = t->next;
+        if (p->head == NULL) {
+            p->tail = NULL;
+        }
+    }
+    return t;
+}
+
+static wheel_task_t *steal_any(wheel_worker_t *self)
+{
+    wheel_pool_t *p = self->pool;
+    unsigned i, start;
+
+    if (p->nworkers < 2) {
+        return NULL;
+    }
+    start = (unsigned)rand_r(&self->seed) % p->nworkers;
+    for (i = 0; i < p->nworkers; i++) {
+        wheel_worker_t *victim = &p->workers[(start + i) % p->nworkers];
+        if (victim != self) {
+            wheel_task_t *t = deque_steal(&victim->deque);
+            if (t != NULL) {
+                return t;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Whether any work is visible; called under lock before going to sleep
+static bool work_available(wheel_pool_t *p)
+{
+    unsigned i;
+
+    if (p->head != NULL) {
+        return true;
+    }
+    for (i = 0; i < p->nworkers; i++) {
+        if (!deque_empty(&p->workers[i].deque)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void task_done(wheel_pool_t *p)
+{
+    if (__atomic_sub_fetch(&p->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+        pthread_mutex_lock(&p->lock);
+        pthread_cond_broadcast(&p->idle_cond);
+        pthread_mutex_unlock(&p->lock);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    wheel_worker_t *self = arg;
+    wheel_pool_t *p = self->pool;
+
+    wheel_pool_self = self;
+    // Wait for wheel_pool_create() to publish the final nworkers
+    pthread_mutex_lock(&p->lock);
+    pthread_mutex_unlock(&p->lock);
+
+    for (;;) {
+        wheel_task_t *t = deque_pop(&self->deque);
+        if (t == NULL) {
+            t = steal_any(self);
+        }
+        if (t == NULL) {
+            pthread_mutex_lock(&p->lock);
+            t = fifo_pop_locked(p);
+            if (t == NULL) {
+                if (p->stopping) {
+                    pthread_mutex_unlock(&p->lock);
+                    break;
+                }
+                // Publish the sleeper before the last look, see wheel_pool_submit()
+                __atomic_store_n(&p->sleepers, p->sleepers + 1, __ATOMIC_SEQ_CST);
+                if (!work_available(p)) {
+                    pthread_cond_wait(&p->work_cond, &p->lock);
+                }
+                __atomic_store_n(&p->sleepers, p->sleepers - 1, __ATOMIC_RELAXED);
+            }
+            pthread_mutex_unlock(&p->lock);
+            if (t == NULL) {
+                continue;
+            }
+        }
+
+        t->fn(t);
+        task_done(p);
+    }
+    return NULL;
+}
+
+/**
+ * wheel_pool_create - Start a worker pool
+ * @nworkers: Number of worker threads, 0 is treated as 1
+ *
+ * Return: The pool, or NULL when out of memory or when no worker thread could
+ * be started. If only some threads start, the pool runs with those.
+ */
+wheel_pool_t *wheel_pool_create(unsigned nworkers)
+{
+    wheel_pool_t *p;
+    unsigned i;
+
+    if (nworkers == 0) {
+        nworkers = 1;
+    }
+    p = calloc(1, sizeof(*p));
+    if (p == NULL) {
+        return NULL;
+    }
+    if (posix_memalign((void **)&p->workers, 64, nworkers * sizeof(*p->workers)) != 0) {
+        free(p);
+        return NULL;
+    }
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->work_cond, NULL);
+    pthread_cond_init(&p->idle_cond, NULL);
+
+    pthread_mutex_lock(&p->lock);
+    for (i = 0; i < nworkers; i++) {
+        wheel_worker_t *wk = &p->workers[i];
+        wk->deque.top = wk->deque.bottom = 0;
+        wk->pool = p;
+        wk->index = i;
+        wk->seed = i * 2654435761u + 1;
+        if (pthread_create(&wk->thread, NULL, worker_main, wk) != 0) {
+            break;
+        }
+        // Only started workers are visible to stealers and to destroy
+        p->nworkers = i + 1;
+    }
+    pthread_mutex_unlock(&p->lock);
+    if (p->nworkers == 0) {
+        wheel_pool_destroy(p);
+        return NULL;
+    }
+    return p;
+}
+
+/**
+ * wheel_pool_destroy - Drain and stop a worker pool
+ * @p: Pool to stop, may be NULL
+ *
+ * Runs every queued task to completion before the workers exit.
+ */
+void wheel_pool_destroy(wheel_pool_t *p)
+{
+    unsigned i;
+
+    if (p == NULL) {
+        return;
+    }
+    if (p->nworkers) {
+        wheel_pool_wait(p);
+    }
+    pthread_mutex_lock(&p->lock);
+    p->stopping = true;
+    pthread_cond_broadcast(&p->work_cond);
+    pthread_mutex_unlock(&p->lock);
+
+    for (i = 0; i < p->nworkers; i++) {
+        pthread_join(p->workers[i].thread, NULL);
+    }
+    pthread_cond_destroy(&p->idle_cond);
+    pthread_cond_destroy(&p->work_cond);
+    pthread_mutex_destroy(&p->lock);
+    free(p->workers);
+    free(p);
+}
+
+unsigned wheel_pool_workers(const wheel_pool_t *p)
+{
+    return p->nworkers;
+}
+
+uint64_t wheel_pool_pending(const wheel_pool_t *p)
+{
+    return __atomic_load_n(&p->pending, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * wheel_pool_submit - Queue a task
+ * @p: Pool to run the task
+ * @t: Task, with fn set; owned by the pool until fn is called
+ *
+ * From a worker of @p the task goes to that worker's own deque, where it is
+ * popped LIFO by the worker or stolen FIFO by the others; from any other
+ * thread, or when the deque is full, it goes to the shared FIFO.
+ */
+void wheel_pool_submit(wheel_pool_t *p, wheel_task_t *t)
+{
+    wheel_worker_t *self = wheel_pool_self;
+
+    __atomic_add_fetch(&p->pending, 1, __ATOMIC_RELAXED);
+
+    if (self != NULL && self->pool == p && deque_push(&self->deque, t)) {
+        // Pairs with the sleeper count published before the last look in
+        // worker_main(): either the sleeper sees the task or we see it
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&p->sleepers, __ATOMIC_RELAXED) != 0) {
+            pthread_mutex_lock(&p->lock);
+            pthread_cond_signal(&p->work_cond);
+            pthread_mutex_unlock(&p->lock);
+        }
+        return;
+    }
+
+    t->next = NULL;
+    pthread_mutex_lock(&p->lock);
+    if (p->tail != NULL) {
+        p->tail->next = t;
+    } else {
+        p->head = t;
+    }
+    p->tail = t;
+    if (p->sleepers) {
+        pthread_cond_signal(&p->work_cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+}
+
+/**
+ * wheel_pool_wait - Completion barrier
+ * @p: Pool to wait for
+ *
+ * Returns once no task is queued or running, including tasks submitted by
+ * tasks. Tasks submitted concurrently by other threads may or may not be
+ * waited for.
+ */
+void wheel_pool_wait(wheel_pool_t *p)
+{
+    if (__atomic_load_n(&p->pending, __ATOMIC_ACQUIRE) == 0) {
+        return;
+    }
+    pthread_mutex_lock(&p->lock);
+    while (__atomic_load_n(&p->pending, __ATOMIC_ACQUIRE) != 0) {
+        pthread_cond_wait(&p->idle_cond, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+}
@@ -0,0 +1,53 @@
+#ifndef __WHEEL_POOL_H__
+#define __WHEEL_POOL_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Worker pool used to run expired timer callbacks off the ticking thread.
+//
+// Each worker owns a Chase-Lev work-stealing deque: tasks a worker submits
+// (e.g. the remainder of a list it split) go to the bottom of its own deque,
+// idle workers steal from the top of the others. Tasks submitted from outside
+// the pool go to a shared FIFO protected by a mutex. Idle workers sleep on a
+// condition variable, so an idle pool costs nothing.
+//
+// Tasks are caller-allocated and embed a wheel_task_t; the pool never copies
+// or frees them. A task's fn may free the task itself.
+
+struct wheel_task_;
+typedef void (*wheel_task_fct)(struct wheel_task_ *t);
+
+typedef struct wheel_task_ {
+    wheel_task_fct fn;
+    struct wheel_task_ *next;   // shared FIFO link, owned by the pool while queued
+} wheel_task_t;
+
+typedef struct wheel_pool_ wheel_pool_t;
+
+// Start nworkers threads (at least 1). Returns NULL when out of memory or
+// when no thread could be created.
+wheel_pool_t *wheel_pool_create(unsigned nworkers);
+// Wait for all tasks, then stop and join the workers
+void wheel_pool_destroy(wheel_pool_t *p);
+
+unsigned wheel_pool_workers(const wheel_pool_t *p);
+
+// Queue a task. Safe from any thread, including from inside a running task.
+void wheel_pool_submit(wheel_pool_t *p, wheel_task_t *t);
+
+// Completion barrier: block until every task submitted so far, and every
+// task those tasks submitted, has returned. Must not be called from a worker.
+void wheel_pool_wait(wheel_pool_t *p);
+
+// Tasks submitted and not finished yet
+uint64_t wheel_pool_pending(const wheel_pool_t *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
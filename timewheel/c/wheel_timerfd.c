@@ -0,0 +1,53 @@
+#include <string.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "wheel_timerfd.h"
+
+int wheel_timerfd_create(void)
+{
+    return timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+}
+
+/**
+ * wheel_timerfd_arm - Make the timerfd fire once at an absolute time
+ * @fd: Timerfd from wheel_timerfd_create()
+ * @deadline_ns: CLOCK_MONOTONIC time in nanoseconds
+ *
+ * Replaces any earlier deadline, including one that already fired but was
+ * not acknowledged yet.
+ *
+ * Return: 0, or -1 with errno set
+ */
+int wheel_timerfd_arm(int fd, uint64_t deadline_ns)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    // An all-zero it_value would disarm the timer
+    if (deadline_ns == 0) {
+        deadline_ns = 1;
+    }
+    its.it_value.tv_sec = deadline_ns / 1000000000ULL;
+    its.it_value.tv_nsec = deadline_ns % 1000000000ULL;
+    return timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+int wheel_timerfd_disarm(int fd)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    return timerfd_settime(fd, 0, &its, NULL);
+}
+
+uint64_t wheel_timerfd_ack(int fd)
+{
+    uint64_t n;
+
+    if (read(fd, &n, sizeof(n)) != sizeof(n)) {
+        // EAGAIN: not fired, or re-armed since
+        return 0;
+    }
+    return n;
+}
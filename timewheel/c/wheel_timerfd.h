@@ -0,0 +1,36 @@
+#ifndef __WHEEL_TIMERFD_H__
+#define __WHEEL_TIMERFD_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A timerfd for driving a timer wheel from an event loop.
+//
+// Instead of a thread per wheel, the wheel keeps one CLOCK_MONOTONIC timerfd
+// armed to the deadline of its next non-empty slot. The loop watches the fd
+// next to its sockets (epoll EPOLLIN, or an io_uring POLL_ADD / READ on it)
+// and, when it becomes readable, lets the wheel process the expired slots and
+// re-arm the fd. Empty slots never wake the loop.
+//
+// Deadlines are absolute CLOCK_MONOTONIC times (wheel_clock_mono_ns()). Do not
+// compute them from wheel_clock_ns(): the TSC is calibrated once and drifts
+// from CLOCK_MONOTONIC, which NTP slews. A deadline in the past makes the fd
+// readable at once.
+
+// Non-blocking and close-on-exec. Returns the fd, or -1 with errno set.
+int wheel_timerfd_create(void);
+// One-shot at deadline_ns. Returns 0, or -1 with errno set.
+int wheel_timerfd_arm(int fd, uint64_t deadline_ns);
+int wheel_timerfd_disarm(int fd);
+// Consume the expiration so that the fd stops being readable. Returns the
+// number of expirations, 0 when it had not fired.
+uint64_t wheel_timerfd_ack(int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif